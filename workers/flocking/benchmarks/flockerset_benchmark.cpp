@@ -0,0 +1,115 @@
+// Authority handover storm: 50k gains and 50k losses arriving in one op list, applied the way
+// Run's OnAuthorityChange handler used to (std::find / erase-remove on a vector) and with FlockerSet.
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "flockerset.h"
+
+using namespace demoteam;
+
+namespace
+{
+	const int g_numOps = 50000;
+
+	struct AuthorityOp
+	{
+		std::int64_t EntityId;
+		bool HasAuthority;
+	};
+	typedef std::vector<AuthorityOp> TOpList;
+
+	//***************************************************************************************************************
+	// gain everything, then lose it all again in a different order, with some of the losses racing ahead
+	TOpList BuildHandoverStorm(int n, unsigned int seed)
+	{
+		std::mt19937 rng(seed);
+
+		std::vector<std::int64_t> ids(n);
+		for (int c0 = 0; c0 < n; ++c0)
+		{
+			ids[c0] = 1000 + c0;
+		}
+
+		TOpList ops;
+		ops.reserve(2 * n);
+		std::shuffle(ids.begin(), ids.end(), rng);
+		for (int c0 = 0; c0 < n; ++c0)
+		{
+			AuthorityOp op = { ids[c0], true };
+			ops.push_back(op);
+		}
+		std::shuffle(ids.begin(), ids.end(), rng);
+		for (int c0 = 0; c0 < n; ++c0)
+		{
+			AuthorityOp op = { ids[c0], false };
+			ops.push_back(op);
+		}
+		std::shuffle(ops.begin() + n / 2, ops.end(), rng);
+		return ops;
+	}
+
+	//***************************************************************************************************************
+	template<class TFunc> double TimeMs(TFunc func)
+	{
+		auto t0 = std::chrono::steady_clock::now();
+		func();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+	}
+}
+
+int main()
+{
+	auto ops = BuildHandoverStorm(g_numOps, 1234);
+
+	size_t maxVector = 0;
+	double vectorMs = TimeMs([&ops, &maxVector]()
+	{
+		std::vector<std::int64_t> flockers;
+		for (auto itOp = ops.begin(); itOp != ops.end(); ++itOp)
+		{
+			if (itOp->HasAuthority)
+			{
+				if (std::find(flockers.begin(), flockers.end(), itOp->EntityId) == flockers.end())
+				{
+					flockers.push_back(itOp->EntityId);
+				}
+			}
+			else
+			{
+				flockers.erase(std::remove(flockers.begin(), flockers.end(), itOp->EntityId), flockers.end());
+			}
+			maxVector = std::max(maxVector, flockers.size());
+		}
+	});
+
+	int maxSet = 0;
+	double setMs = TimeMs([&ops, &maxSet]()
+	{
+		FlockerSet flockers;
+		for (auto itOp = ops.begin(); itOp != ops.end(); ++itOp)
+		{
+			if (itOp->HasAuthority)
+			{
+				flockers.Add(itOp->EntityId);
+			}
+			else
+			{
+				flockers.Remove(itOp->EntityId);
+			}
+			maxSet = std::max(maxSet, flockers.Size());
+		}
+	});
+
+	printf("ops,%d\n", static_cast<int>(ops.size()));
+	printf("vector_ms,%.3f,peak,%d\n", vectorMs, static_cast<int>(maxVector));
+	printf("flockerset_ms,%.3f,peak,%d\n", setMs, maxSet);
+	printf("speedup,%.1f\n", setMs > 0.0 ? vectorMs / setMs : 0.0);
+
+	return maxSet == static_cast<int>(maxVector) ? 0 : 1;
+}
@@ -0,0 +1,389 @@
+// Kernel microbenchmarks: grid build, radius query, cube/sphere test, steering, bounds and a whole UpdateFlocking pass,
+// over a range of flock sizes and spatial distributions. The *_compact rows repeat the query and the pass over the
+// grid's packed, quantised cells; the *_farfield_<range> rows add the far field out to that range, and the
+// update_flocking_lists* rows step from per-bird neighbour lists, on the step that rebuilds one and on the
+// g_listPolicy.RebuildFrames - 1 steps after that just filter it.
+//   FlockingBenchmark [maxBirds] [distribution]
+// Prints one CSV row per kernel/distribution/size. Per-bird kernels are timed over growing batches until
+// g_minMeasureMs has passed, so "samples" can be less than "birds" for the slow cases.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "confinementfield.h"
+#include "farfield.h"
+#include "flocking.h"
+#include "flockerset.h"
+#include "framebudget.h"
+#include "localworld.h"
+#include "neighbourlists.h"
+#include "scheduler.h"
+#include "spatialgrid.h"
+#include "steering.h"
+
+using namespace demoteam;
+
+namespace
+{
+	const int g_birdCounts[] = { 1000, 10000, 100000, 1000000 };
+	const double g_minMeasureMs = 200.0;
+	const float g_spawnExtent = 192.0f;	// KeepNearOrigin's radius
+	const float g_farFieldRanges[] = { 32.0f, 64.0f, 128.0f };
+	const float g_farFieldTheta = 0.5f;
+	const NeighbourListPolicy g_listPolicy = { 6.0f, 4.0f };
+	const int g_numObstacles = 8;	// baked into the bounds_field row's field
+	const int g_numClusters = 16;
+	const float g_clusterSigma = 6.0f;
+
+	enum Distribution
+	{
+		Uniform = 0,
+		Clustered,
+		SingleCell,	// everything in one grid bucket, the degenerate case for the partitioning
+		BirdCells,	// what the respawner does with num_bird_cells
+		NumDistributions
+	};
+
+	const char* g_distributionNames[NumDistributions] = { "uniform", "clustered", "single_cell", "bird_cells" };
+
+	volatile float g_sink;
+
+	//***************************************************************************************************************
+	Float4 RandomDirection(std::mt19937& rng)
+	{
+		std::normal_distribution<float> gauss(0.0f, 1.0f);
+		Float4 dir(gauss(rng), gauss(rng), gauss(rng));
+		return sqrMag(dir) > epsilon ? normalize(dir) : unitZ3<Float4>();
+	}
+
+	//***************************************************************************************************************
+	void BuildWorld(Distribution distribution, int numBirds, unsigned int seed, WorldSnapshot& world)
+	{
+		world.Clear();
+		world.Reserve(numBirds);
+
+		if (distribution == BirdCells)
+		{
+			LocalWorldParams params = DefaultLocalWorldParams();
+			params.NumBirds = numBirds;
+			params.Seed = seed;
+			LocalWorld localWorld(params);
+			localWorld.SpawnBirds();
+			localWorld.ReadWorld(world);
+			return;
+		}
+
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> horizontal(-g_spawnExtent, g_spawnExtent);
+		std::uniform_real_distribution<float> vertical(10.0f, 30.0f);
+		std::uniform_real_distribution<float> inCell(0.5f, 7.5f);
+		std::normal_distribution<float> cluster(0.0f, g_clusterSigma);
+
+		std::vector<Coordinates> centres;
+		for (int c0 = 0; c0 < g_numClusters; ++c0)
+		{
+			centres.push_back(Coordinates(horizontal(rng), vertical(rng), horizontal(rng)));
+		}
+
+		auto params = BirdFlockParams(5.0f);
+		for (int ibird = 0; ibird < numBirds; ++ibird)
+		{
+			Coordinates pos(0, 0, 0);
+			switch (distribution)
+			{
+			case Uniform:
+				pos = Coordinates(horizontal(rng), vertical(rng), horizontal(rng));
+				break;
+			case Clustered:
+				pos = centres[ibird % g_numClusters] + Float4(cluster(rng), cluster(rng), cluster(rng));
+				break;
+			default:
+				// cell boundaries are at multiples of the 8m grid size
+				pos = Coordinates(inCell(rng), 16.0f + inCell(rng), inCell(rng));
+				break;
+			}
+
+			auto fwd = RandomDirection(rng);
+			world.Add(ibird + 1, FlockTransform(pos, fwd, fwd*params.Speed), &params);
+		}
+	}
+
+	//***************************************************************************************************************
+	// calls func(ibegin, iend) over doubling batches of [0, n) until enough time has passed; returns the ns per item
+	double MeasurePerItem(int n, std::function<void(int, int)> func, int& samples)
+	{
+		auto t0 = std::chrono::steady_clock::now();
+		double elapsedMs = 0.0;
+		int batch = 16;
+		samples = 0;
+		while (samples < n && elapsedMs < g_minMeasureMs)
+		{
+			int iend = std::min(samples + batch, n);
+			func(samples, iend);
+			samples = iend;
+			batch *= 2;
+			elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+		}
+		return samples > 0 ? elapsedMs * 1e6 / samples : 0.0;
+	}
+
+	//***************************************************************************************************************
+	void Report(const char* kernel, Distribution distribution, int numBirds, int numBuckets, int samples, double nsPerOp)
+	{
+		printf("%s,%s,%d,%d,%d,%.1f\n", kernel, g_distributionNames[distribution], numBirds, numBuckets, samples, nsPerOp);
+		fflush(stdout);
+	}
+
+	//***************************************************************************************************************
+	void RunKernels(Distribution distribution, int numBirds)
+	{
+		WorldSnapshot world;
+		BuildWorld(distribution, numBirds, 1234, world);
+
+		// build
+		TBuckets grid;
+		ScratchArena gridArena;
+		int buildSamples = 0;
+		double buildNs = MeasurePerItem(1, [&grid, &gridArena, &world](int, int)
+		{
+			grid.clear();
+			gridArena.Reset();
+			BuildSpatialGrid(grid, world, gridArena);
+		}, buildSamples);
+		int numBuckets = grid.size();
+		Report("grid_build", distribution, numBirds, numBuckets, numBirds, buildNs / numBirds);
+
+		// query points are the birds themselves, shuffled so the batches aren't all from one cluster
+		std::vector<int> order(numBirds);
+		for (int c0 = 0; c0 < numBirds; ++c0)
+		{
+			order[c0] = c0;
+		}
+		std::shuffle(order.begin(), order.end(), std::mt19937(99));
+
+		const float searchRange = BirdFlockParams(5.0f).SearchRange;
+		int samples = 0;
+		double ns = MeasurePerItem(numBirds, [&world, &grid, &order, searchRange](int ibegin, int iend)
+		{
+			int ncandidates = 0;
+			for (int c0 = ibegin; c0 < iend; ++c0)
+			{
+				Sphere sphere(ToFloat4(world.Transforms[order[c0]].Position), searchRange);
+				forAllEntitiesWithinRadius(grid, world, sphere, [&ncandidates](TEntityId, const FlockTransform&)
+				{
+					++ncandidates;
+					return true;
+				});
+			}
+			g_sink = static_cast<float>(ncandidates);
+		}, samples);
+		Report("radius_query", distribution, numBirds, numBuckets, samples, ns);
+
+		// one op = one bucket tested against one point
+		ns = MeasurePerItem(numBirds, [&world, &grid, &order](int ibegin, int iend)
+		{
+			int nhits = 0;
+			for (int c0 = ibegin; c0 < iend; ++c0)
+			{
+				auto pos = ToFloat4(world.Transforms[order[c0]].Position);
+				for (auto itBuck = grid.begin(); itBuck != grid.end(); ++itBuck)
+				{
+					nhits += (*itBuck)->IntersectionHelper.IntersectionAt(pos) ? 1 : 0;
+				}
+			}
+			g_sink = static_cast<float>(nhits);
+		}, samples);
+		Report("intersection_at", distribution, numBirds, numBuckets, samples, numBuckets > 0 ? ns / numBuckets : 0.0);
+
+		// steering on its own, with a fixed set of neighbours so only the maths is timed
+		const int numberToConsider = BirdFlockParams(5.0f).NumberToConsider;
+		ns = MeasurePerItem(numBirds, [&world, &order, numberToConsider, numBirds](int ibegin, int iend)
+		{
+			NeighbourData neighbours[g_maxNeighbours];
+			float sum = 0.0f;
+			for (int c0 = ibegin; c0 < iend; ++c0)
+			{
+				int ient = order[c0];
+				for (int ineighbour = 0; ineighbour < numberToConsider; ++ineighbour)
+				{
+					int jent = order[(c0 + ineighbour + 1) % numBirds];
+					neighbours[ineighbour] = NeighbourData(world.Ids[jent], world.Transforms[jent], 0.0f);
+				}
+				sum += CalculateSteeringVector(world.Transforms[ient], world.Params[ient], neighbours, numberToConsider).X();
+			}
+			g_sink = sum;
+		}, samples);
+		Report("steering", distribution, numBirds, numBuckets, samples, ns);
+
+		// keeping birds in bounds: the built in pair, then the same bounds with a few obstacles, worked out per bird and
+		// looked up in a baked field
+		ns = MeasurePerItem(numBirds, [&world, &order](int ibegin, int iend)
+		{
+			float sum = 0.0f;
+			for (int c0 = ibegin; c0 < iend; ++c0)
+			{
+				auto& transform = world.Transforms[order[c0]];
+				sum += KeepAtGoodHeight(transform, KeepNearOrigin(transform, transform.Forward)).X();
+			}
+			g_sink = sum;
+		}, samples);
+		Report("bounds_builtin", distribution, numBirds, numBuckets, samples, ns);
+
+		auto confinementDesc = DefaultConfinementFieldDesc();
+		for (int iobstacle = 0; iobstacle < g_numObstacles; ++iobstacle)
+		{
+			float angle = iobstacle * 6.2831853f / g_numObstacles;
+			confinementDesc.Obstacles.push_back(ConfinementObstacle(Float4(cosf(angle) * 96.0f, 20.0f, sinf(angle) * 96.0f), 12.0f, 8.0f, 20.0f));
+		}
+		ns = MeasurePerItem(numBirds, [&world, &order, &confinementDesc](int ibegin, int iend)
+		{
+			float sum = 0.0f;
+			for (int c0 = ibegin; c0 < iend; ++c0)
+			{
+				auto& transform = world.Transforms[order[c0]];
+				sum += (transform.Forward + EvaluateConfinement(confinementDesc, ToFloat4(transform.Position))).X();
+			}
+			g_sink = sum;
+		}, samples);
+		Report("bounds_analytic", distribution, numBirds, numBuckets, samples, ns);
+
+		ConfinementField confinement;
+		confinement.Bake(confinementDesc);
+		ns = MeasurePerItem(numBirds, [&world, &order, &confinement](int ibegin, int iend)
+		{
+			float sum = 0.0f;
+			for (int c0 = ibegin; c0 < iend; ++c0)
+			{
+				auto& transform = world.Transforms[order[c0]];
+				sum += (transform.Forward + confinement.Sample(ToFloat4(transform.Position))).X();
+			}
+			g_sink = sum;
+		}, samples);
+		Report("bounds_field", distribution, numBirds, numBuckets, samples, ns);
+
+		// the whole per-bird step, single threaded at full quality
+		FlockerSet flockers;
+		flockers.Reserve(numBirds);
+		TScheduledFlockers work(numBirds);
+		for (int c0 = 0; c0 < numBirds; ++c0)
+		{
+			flockers.Add(world.Ids[order[c0]]);
+			work[c0].FlockerIndex = c0;
+			work[c0].TimeScale = 1.0f;
+		}
+		TFlockersUpdate flockersUpdate(flockers.SlotCapacity());
+		FlockingLimits limits = { 0, 1.0f, 0, false };
+		ScratchArena scratch;
+		ns = MeasurePerItem(numBirds, [&flockers, &flockersUpdate, &work, &world, &grid, &limits, &scratch](int ibegin, int iend)
+		{
+			scratch.Reset();
+			UpdateFlocking(flockers, flockersUpdate, work, world, grid, ibegin, iend, limits, 0.125f, scratch);
+		}, samples);
+		Report("update_flocking", distribution, numBirds, numBuckets, samples, ns);
+
+		// neighbour lists: a bird's first step builds its list, then the next few just filter it. The birds don't
+		// move, so the second pass is over the same birds, all of whose lists are still fresh
+		NeighbourLists lists(g_listPolicy);
+		lists.Resize(flockers.SlotCapacity());
+		int listSamples = 0;
+		ns = MeasurePerItem(numBirds, [&flockers, &flockersUpdate, &work, &world, &grid, &limits, &scratch, &lists](int ibegin, int iend)
+		{
+			scratch.Reset();
+			UpdateFlocking(flockers, flockersUpdate, work, world, grid, ibegin, iend, limits, 0.125f, scratch, nullptr, &lists);
+		}, listSamples);
+		Report("update_flocking_lists_rebuild", distribution, numBirds, numBuckets, listSamples, ns);
+
+		ns = MeasurePerItem(listSamples, [&flockers, &flockersUpdate, &work, &world, &grid, &limits, &scratch, &lists](int ibegin, int iend)
+		{
+			scratch.Reset();
+			UpdateFlocking(flockers, flockersUpdate, work, world, grid, ibegin, iend, limits, 0.125f, scratch, nullptr, &lists);
+		}, samples);
+		Report("update_flocking_lists", distribution, numBirds, numBuckets, samples, ns);
+
+		// the same pass with the far field; the build is per frame, so it's reported per bird like the grid's
+		for (auto range : g_farFieldRanges)
+		{
+			FarFieldPolicy policy = { range, g_farFieldTheta };
+			FarFieldTree farField;
+			ScratchArena farFieldArena;
+			buildNs = MeasurePerItem(1, [&grid, &world, &policy, &farField, &farFieldArena](int, int)
+			{
+				farFieldArena.Reset();
+				farField.Build(grid, world, policy, farFieldArena);
+			}, buildSamples);
+			char kernel[64];
+			snprintf(kernel, sizeof(kernel), "farfield_build_%d", static_cast<int>(range));
+			Report(kernel, distribution, numBirds, numBuckets, numBirds, buildNs / numBirds);
+
+			ns = MeasurePerItem(numBirds, [&flockers, &flockersUpdate, &work, &world, &grid, &limits, &scratch, &farField](int ibegin, int iend)
+			{
+				scratch.Reset();
+				UpdateFlocking(flockers, flockersUpdate, work, world, grid, ibegin, iend, limits, 0.125f, scratch, &farField);
+			}, samples);
+			snprintf(kernel, sizeof(kernel), "update_flocking_farfield_%d", static_cast<int>(range));
+			Report(kernel, distribution, numBirds, numBuckets, samples, ns);
+		}
+
+		// everything from here on sees the compact cells
+		buildNs = MeasurePerItem(1, [&grid, &gridArena, &world](int, int)
+		{
+			BuildCompactCells(grid, world, gridArena);
+		}, buildSamples);
+		Report("compact_build", distribution, numBirds, numBuckets, numBirds, buildNs / numBirds);
+
+		ns = MeasurePerItem(numBirds, [&world, &grid, &order, searchRange](int ibegin, int iend)
+		{
+			int ncandidates = 0;
+			for (int c0 = ibegin; c0 < iend; ++c0)
+			{
+				Sphere sphere(ToFloat4(world.Transforms[order[c0]].Position), searchRange);
+				forAllCompactWithinRadius(grid, sphere, [&ncandidates](const SpatialBucket&, const CompactFlocker&, TFloat4Arg)
+				{
+					++ncandidates;
+					return true;
+				});
+			}
+			g_sink = static_cast<float>(ncandidates);
+		}, samples);
+		Report("radius_query_compact", distribution, numBirds, numBuckets, samples, ns);
+
+		ns = MeasurePerItem(numBirds, [&flockers, &flockersUpdate, &work, &world, &grid, &limits, &scratch](int ibegin, int iend)
+		{
+			scratch.Reset();
+			UpdateFlocking(flockers, flockersUpdate, work, world, grid, ibegin, iend, limits, 0.125f, scratch);
+		}, samples);
+		Report("update_flocking_compact", distribution, numBirds, numBuckets, samples, ns);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int maxBirds = argc > 1 ? atoi(argv[1]) : 1000000;
+	const char* only = argc > 2 ? argv[2] : nullptr;
+
+	printf("kernel,distribution,birds,buckets,samples,ns_per_op\n");
+	for (int idist = 0; idist < NumDistributions; ++idist)
+	{
+		if (only != nullptr && strcmp(only, g_distributionNames[idist]) != 0)
+		{
+			continue;
+		}
+		for (auto numBirds : g_birdCounts)
+		{
+			if (numBirds <= maxBirds)
+			{
+				RunKernels(static_cast<Distribution>(idist), numBirds);
+			}
+		}
+	}
+	return 0;
+}
@@ -97,7 +97,7 @@ namespace improbable
 			return pointOnUnitSphere(randomFloat());
 		}
 
-		bool testQuat(float ep)
+		bool testQuat(float /*ep*/)
 		{
 			// quat test
 			auto rot = Quat::axisAngle(unitY3<Vector3f>(), pi / 4);
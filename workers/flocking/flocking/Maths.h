@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <random>
 
 #define _USE_MATH_DEFINES
@@ -8,6 +9,11 @@
 #include <improbable/math/vector3f.h>
 #include <improbable/math/coordinates.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FLOCKING_SSE
+#include <emmintrin.h>
+#endif //SSE2
+
 namespace improbable {
 	namespace math {
 
@@ -60,11 +66,6 @@ namespace improbable {
 			return Coordinates(a.X() + b.X(), a.Y() + b.Y(), a.Z() + b.Z());
 		}
 
-		inline Vector3f operator-(const Coordinates& a, const Coordinates& b)
-		{
-			return Vector3f(static_cast<float>(a.X() - b.X()), static_cast<float>(a.Y() - b.Y()), static_cast<float>(a.Z() - b.Z()));
-		}
-
 		inline Coordinates operator+(const Coordinates& a, TVector3fArg b)
 		{
 			return Coordinates(a.X() + b.X(), a.Y() + b.Y(), a.Z() + b.Z());
@@ -89,6 +90,139 @@ namespace improbable {
 			return Vector3f(a.X() / b.X(), a.Y() / b.Y(), a.Z() / b.Z());
 		}
 
+		class Float4;
+		typedef const Float4 TFloat4Ret;
+		typedef const Float4& TFloat4Arg;
+
+		//---------------------------
+		// What the simulation does its sums in. The SDK's Vector3f hides its floats behind accessors, which stops
+		// the compiler vectorising anything; this is one SSE register (an array without SSE), and only meets
+		// Vector3f where transforms come in from the view and updates go out. W rides along and is never read
+		// by the 3D functions below, so it can hold anything
+		class alignas(16) Float4
+		{
+		public:
+			Float4() : Float4(0.0f, 0.0f, 0.0f, 0.0f) {}
+			Float4(float x, float y, float z, float w = 0.0f);
+			// the SDK's vectors convert in implicitly, but only out with ToVector3f
+			Float4(TVector3fArg v) : Float4(v.X(), v.Y(), v.Z()) {}
+
+			float X() const;
+			float Y() const;
+			float Z() const;
+			float W() const;
+
+#ifdef FLOCKING_SSE
+			explicit Float4(__m128 v) : V(v) {}
+			__m128 V;
+#else
+			float V[4];
+#endif //FLOCKING_SSE
+		};
+
+#ifdef FLOCKING_SSE
+		inline Float4::Float4(float x, float y, float z, float w) : V(_mm_set_ps(w, z, y, x)) {}
+		inline float Float4::X() const { return _mm_cvtss_f32(V); }
+		inline float Float4::Y() const { return _mm_cvtss_f32(_mm_shuffle_ps(V, V, _MM_SHUFFLE(1, 1, 1, 1))); }
+		inline float Float4::Z() const { return _mm_cvtss_f32(_mm_shuffle_ps(V, V, _MM_SHUFFLE(2, 2, 2, 2))); }
+		inline float Float4::W() const { return _mm_cvtss_f32(_mm_shuffle_ps(V, V, _MM_SHUFFLE(3, 3, 3, 3))); }
+
+		inline Float4 operator+(TFloat4Arg a, TFloat4Arg b) { return Float4(_mm_add_ps(a.V, b.V)); }
+		inline Float4 operator-(TFloat4Arg a, TFloat4Arg b) { return Float4(_mm_sub_ps(a.V, b.V)); }
+		inline Float4 operator*(TFloat4Arg a, TFloat4Arg b) { return Float4(_mm_mul_ps(a.V, b.V)); }
+		inline Float4 operator/(TFloat4Arg a, TFloat4Arg b) { return Float4(_mm_div_ps(a.V, b.V)); }
+		inline Float4 operator*(TFloat4Arg a, float b) { return Float4(_mm_mul_ps(a.V, _mm_set1_ps(b))); }
+		inline Float4 min(TFloat4Arg a, TFloat4Arg b) { return Float4(_mm_min_ps(a.V, b.V)); }
+		inline Float4 max(TFloat4Arg a, TFloat4Arg b) { return Float4(_mm_max_ps(a.V, b.V)); }
+
+		inline Float4 cross(TFloat4Arg a, TFloat4Arg b)
+		{
+			__m128 ayzx = _mm_shuffle_ps(a.V, a.V, _MM_SHUFFLE(3, 0, 2, 1));
+			__m128 byzx = _mm_shuffle_ps(b.V, b.V, _MM_SHUFFLE(3, 0, 2, 1));
+			__m128 azxy = _mm_shuffle_ps(a.V, a.V, _MM_SHUFFLE(3, 1, 0, 2));
+			__m128 bzxy = _mm_shuffle_ps(b.V, b.V, _MM_SHUFFLE(3, 1, 0, 2));
+			return Float4(_mm_sub_ps(_mm_mul_ps(ayzx, bzxy), _mm_mul_ps(azxy, byzx)));
+		}
+#else
+		inline Float4::Float4(float x, float y, float z, float w) { V[0] = x; V[1] = y; V[2] = z; V[3] = w; }
+		inline float Float4::X() const { return V[0]; }
+		inline float Float4::Y() const { return V[1]; }
+		inline float Float4::Z() const { return V[2]; }
+		inline float Float4::W() const { return V[3]; }
+
+		inline Float4 operator+(TFloat4Arg a, TFloat4Arg b) { return Float4(a.V[0] + b.V[0], a.V[1] + b.V[1], a.V[2] + b.V[2], a.V[3] + b.V[3]); }
+		inline Float4 operator-(TFloat4Arg a, TFloat4Arg b) { return Float4(a.V[0] - b.V[0], a.V[1] - b.V[1], a.V[2] - b.V[2], a.V[3] - b.V[3]); }
+		inline Float4 operator*(TFloat4Arg a, TFloat4Arg b) { return Float4(a.V[0] * b.V[0], a.V[1] * b.V[1], a.V[2] * b.V[2], a.V[3] * b.V[3]); }
+		inline Float4 operator/(TFloat4Arg a, TFloat4Arg b) { return Float4(a.V[0] / b.V[0], a.V[1] / b.V[1], a.V[2] / b.V[2], a.V[3] / b.V[3]); }
+		inline Float4 operator*(TFloat4Arg a, float b) { return Float4(a.V[0] * b, a.V[1] * b, a.V[2] * b, a.V[3] * b); }
+		inline Float4 min(TFloat4Arg a, TFloat4Arg b) { return Float4(std::min(a.V[0], b.V[0]), std::min(a.V[1], b.V[1]), std::min(a.V[2], b.V[2]), std::min(a.V[3], b.V[3])); }
+		inline Float4 max(TFloat4Arg a, TFloat4Arg b) { return Float4(std::max(a.V[0], b.V[0]), std::max(a.V[1], b.V[1]), std::max(a.V[2], b.V[2]), std::max(a.V[3], b.V[3])); }
+
+		inline Float4 cross(TFloat4Arg a, TFloat4Arg b)
+		{
+			return Float4(a.V[1] * b.V[2] - a.V[2] * b.V[1], a.V[2] * b.V[0] - a.V[0] * b.V[2], a.V[0] * b.V[1] - a.V[1] * b.V[0]);
+		}
+#endif //FLOCKING_SSE
+
+		inline Float4 operator*(float a, TFloat4Arg b)
+		{
+			return b*a;
+		}
+
+		// times the reciprocal, as the Vector3f version does, so the two agree to the bit
+		inline Float4 operator/(TFloat4Arg a, float b)
+		{
+			return a*(1.0f / b);
+		}
+
+		// summed x, then y, then z, like the Vector3f functions, so swapping one for the other doesn't move a bird
+		inline float dot(TFloat4Arg a, TFloat4Arg b)
+		{
+			auto products = a*b;
+			return products.X() + products.Y() + products.Z();
+		}
+
+		inline float sqrMag(TFloat4Arg v)
+		{
+			return dot(v, v);
+		}
+
+		inline float mag(TFloat4Arg v)
+		{
+			return sqrtf(sqrMag(v));
+		}
+
+		inline Float4 normalize(TFloat4Arg v)
+		{
+			return v*(1.0f / sqrtf(sqrMag(v)));
+		}
+
+		inline bool isZero(TFloat4Arg a, float ep)
+		{
+			return a.X() < ep && a.X() > -ep && a.Y() < ep && a.Y() > -ep && a.Z() < ep && a.Z() > -ep;
+		}
+
+		inline Vector3f ToVector3f(TFloat4Arg v)
+		{
+			return Vector3f(v.X(), v.Y(), v.Z());
+		}
+
+		inline Float4 ToFloat4(const Coordinates& c)
+		{
+			return Float4(static_cast<float>(c.X()), static_cast<float>(c.Y()), static_cast<float>(c.Z()));
+		}
+
+		// the difference is taken in doubles, so it's as good far from the origin as near it
+		inline Float4 operator-(const Coordinates& a, const Coordinates& b)
+		{
+			return Float4(static_cast<float>(a.X() - b.X()), static_cast<float>(a.Y() - b.Y()), static_cast<float>(a.Z() - b.Z()));
+		}
+
+		inline Coordinates operator+(const Coordinates& a, TFloat4Arg b)
+		{
+			return Coordinates(a.X() + b.X(), a.Y() + b.Y(), a.Z() + b.Z());
+		}
+
 		template <class T> T sqr(T v)
 		{
 			return v*v;
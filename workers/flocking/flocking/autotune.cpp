@@ -0,0 +1,208 @@
+#include "autotune.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <thread>
+
+#include "localworld.h"
+#include "logging.h"
+
+namespace demoteam
+{
+	namespace
+	{
+		const AutotuneParams g_defaultAutotuneParams =
+		{
+			2048,	// NumBirds
+			4,		// NumBirdCells
+			4,		// WarmupFrames
+			8,		// MeasuredFrames
+			0,		// MaxThreads
+			0.05f	// MinGain
+		};
+
+		// the default cell first, so it's what the others have to beat
+		const float g_candidateCellSizes[] = { g_gridCellSize, 6.0f, 12.0f, 16.0f };
+		// what NeighbourLists' exactness argument is made for, if the config doesn't have a skin of its own
+		const float g_listKernelSkin = 6.0f;
+
+		const char* const g_kernelNames[NumNeighbourKernels] = { "grid", "lists", "compact" };
+
+		//***************************************************************************************************************
+		double TimeTrial(const SimulationConfig& config, const AutotuneParams& params)
+		{
+			LocalWorldParams worldParams = DefaultLocalWorldParams();
+			worldParams.NumBirds = params.NumBirds;
+			worldParams.NumBirdCells = params.NumBirdCells;
+			LocalWorld world(worldParams);
+			world.SpawnBirds();
+
+			FlockingSimulation sim(config);
+			world.DelegateAll(sim);
+
+			const double secondsPerSubTick = 1.0 / config.TargetFPS / sim.NumPhases();
+			int subTick = 0;
+			auto tickFrames = [&](int numFrames)
+			{
+				for (int isub = 0; isub < numFrames * sim.NumPhases(); ++isub, ++subTick)
+				{
+					sim.Tick(world, subTick * secondsPerSubTick);
+				}
+			};
+
+			tickFrames(params.WarmupFrames);
+			auto startTime = std::chrono::steady_clock::now();
+			tickFrames(params.MeasuredFrames);
+			double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+			// the trial's own frame logs aren't anyone's business
+			logging::Drain([](logging::LogLevel, const std::string&, const std::string&) {});
+			return elapsedMs / std::max(params.MeasuredFrames, 1);
+		}
+
+		//***************************************************************************************************************
+		AutotuneTrial RunTrial(SimulationConfig config, int numThreads, float cellSize, NeighbourKernel kernel, const AutotuneParams& params)
+		{
+			config.NumThreads = numThreads;
+			config.Grid.CellSize = cellSize;
+			UseKernel(config, kernel);
+			// the same work every frame, however slow the machine
+			config.FrameBudget.Enabled = false;
+
+			AutotuneTrial trial;
+			trial.NumThreads = numThreads;
+			trial.CellSize = cellSize;
+			trial.Kernel = kernel;
+			trial.MsPerFrame = TimeTrial(config, params);
+			return trial;
+		}
+
+		//***************************************************************************************************************
+		// trials come in simplest first, and later ones have to earn their place
+		bool Beats(const AutotuneTrial& trial, const AutotuneTrial& best, const AutotuneParams& params)
+		{
+			return trial.MsPerFrame < best.MsPerFrame * (1.0 - params.MinGain);
+		}
+	}
+
+	//***************************************************************************************************************
+	const char* NeighbourKernelName(NeighbourKernel kernel)
+	{
+		return g_kernelNames[kernel];
+	}
+
+	//***************************************************************************************************************
+	NeighbourKernel KernelOf(const SimulationConfig& config)
+	{
+		// lists take precedence in UpdateFlocking
+		return config.NeighbourLists.Skin > 0.0f ? ListKernel : config.CompactNeighbours ? CompactKernel : GridKernel;
+	}
+
+	//***************************************************************************************************************
+	void UseKernel(SimulationConfig& config, NeighbourKernel kernel)
+	{
+		if (kernel == ListKernel && config.NeighbourLists.Skin <= 0.0f)
+		{
+			config.NeighbourLists.Skin = g_listKernelSkin;
+		}
+		else if (kernel != ListKernel)
+		{
+			config.NeighbourLists.Skin = 0.0f;
+		}
+		config.CompactNeighbours = kernel == CompactKernel;
+	}
+
+	//***************************************************************************************************************
+	AutotuneParams DefaultAutotuneParams()
+	{
+		return g_defaultAutotuneParams;
+	}
+
+	//***************************************************************************************************************
+	AutotuneResult Autotune(const SimulationConfig& base, const AutotuneParams& params)
+	{
+		int maxThreads = params.MaxThreads > 0 ? params.MaxThreads : static_cast<int>(std::thread::hardware_concurrency());
+		maxThreads = std::min(std::max(maxThreads, 1), g_maxSimulationThreads);
+
+		AutotuneResult result;
+		result.Config = base;
+
+		// kernels and cell sizes on the thread count we were given
+		int numThreads = std::min(std::max(base.NumThreads, 1), maxThreads);
+		int numKernels = base.CompactNeighbours ? NumNeighbourKernels : CompactKernel;
+		for (int kernel = GridKernel; kernel < numKernels; ++kernel)
+		{
+			for (auto itCell = std::begin(g_candidateCellSizes); itCell != std::end(g_candidateCellSizes); ++itCell)
+			{
+				GridLayout layout = { *itCell, base.Grid.HalfExtent };
+				if (!IsValidGridLayout(layout))
+				{
+					continue;
+				}
+				auto trial = RunTrial(base, numThreads, *itCell, static_cast<NeighbourKernel>(kernel), params);
+				if (result.Trials.empty() || Beats(trial, result.Chosen, params))
+				{
+					result.Chosen = trial;
+				}
+				result.Trials.push_back(trial);
+			}
+		}
+		if (result.Trials.empty())
+		{
+			// nothing fits the grid; leave the config be
+			return result;
+		}
+
+		// then how many threads those are worth, fewest first
+		std::vector<int> threadCounts;
+		for (int threads = 1; threads < maxThreads; threads *= 2)
+		{
+			threadCounts.push_back(threads);
+		}
+		threadCounts.push_back(maxThreads);
+
+		auto layoutWinner = result.Chosen;
+		for (auto itThreads = threadCounts.begin(); itThreads != threadCounts.end(); ++itThreads)
+		{
+			bool alreadyTimed = *itThreads == layoutWinner.NumThreads;
+			auto trial = alreadyTimed ? layoutWinner : RunTrial(base, *itThreads, layoutWinner.CellSize, layoutWinner.Kernel, params);
+			if (itThreads == threadCounts.begin() || Beats(trial, result.Chosen, params))
+			{
+				result.Chosen = trial;
+			}
+			if (!alreadyTimed)
+			{
+				result.Trials.push_back(trial);
+			}
+		}
+
+		result.Config.NumThreads = result.Chosen.NumThreads;
+		result.Config.Grid.CellSize = result.Chosen.CellSize;
+		UseKernel(result.Config, result.Chosen.Kernel);
+		return result;
+	}
+
+	//***************************************************************************************************************
+	std::string DescribeAutotune(const AutotuneResult& result)
+	{
+		char buf[256];
+		if (result.Trials.empty())
+		{
+			return "autotune had nothing to try; the config is as it was\n";
+		}
+
+		snprintf(buf, sizeof(buf), "autotune chose threads %d, grid_cell_size %g, kernel %s: %.3f ms/frame\n",
+			result.Chosen.NumThreads, result.Chosen.CellSize, NeighbourKernelName(result.Chosen.Kernel), result.Chosen.MsPerFrame);
+		std::string out = buf;
+		for (auto itTrial = result.Trials.begin(); itTrial != result.Trials.end(); ++itTrial)
+		{
+			snprintf(buf, sizeof(buf), "  threads %d, grid_cell_size %g, kernel %s: %.3f ms/frame\n",
+				itTrial->NumThreads, itTrial->CellSize, NeighbourKernelName(itTrial->Kernel), itTrial->MsPerFrame);
+			out += buf;
+		}
+		return out;
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+
+namespace demoteam
+{
+	// how each step finds its candidates
+	enum NeighbourKernel
+	{
+		GridKernel = 0,		// a grid query every step
+		ListKernel,			// per-bird neighbour lists, rebuilt from the grid every few frames
+		CompactKernel,		// a grid query over the compact cells; approximate, so only tried if the config already has them
+		NumNeighbourKernels
+	};
+
+	const char* NeighbourKernelName(NeighbourKernel kernel);
+	NeighbourKernel KernelOf(const SimulationConfig& config);
+	void UseKernel(SimulationConfig& config, NeighbourKernel kernel);
+
+	//------------------------------------------
+	struct AutotuneParams
+	{
+		int NumBirds;			// in a LocalWorld, laid out the usual way
+		int NumBirdCells;
+		int WarmupFrames;		// per trial, to let the flock and the arena settle
+		int MeasuredFrames;
+		int MaxThreads;			// 0 = however many the hardware has
+		float MinGain;			// the fraction of a frame anything past the simplest setting has to save to be picked
+	};
+
+	AutotuneParams DefaultAutotuneParams();
+
+	//------------------------------------------
+	struct AutotuneTrial
+	{
+		int NumThreads;
+		float CellSize;
+		NeighbourKernel Kernel;
+		double MsPerFrame;
+	};
+
+	//------------------------------------------
+	struct AutotuneResult
+	{
+		SimulationConfig Config;	// what it was given, with the chosen trial's settings
+		AutotuneTrial Chosen;
+		std::vector<AutotuneTrial> Trials;
+	};
+
+	// Times short, unpaced runs of a synthetic flock: first every kernel at every candidate cell size on the configured
+	// thread count, then the winner of those on 1, 2, 4... threads. Takes a few seconds, so it's for startup. Nothing
+	// it tries changes what the flock does, compact cells aside
+	AutotuneResult Autotune(const SimulationConfig& base, const AutotuneParams& params);
+
+	// a line for the choice, then one per trial
+	std::string DescribeAutotune(const AutotuneResult& result);
+}
@@ -0,0 +1,38 @@
+#include "birdstats.h"
+
+namespace demoteam
+{
+	//***************************************************************************************************************
+	BirdStats::BirdStats(const BirdStatsPolicy& policy) : Policy(policy)
+	{
+	}
+
+	//***************************************************************************************************************
+	void BirdStats::Resize(int numSlots)
+	{
+		if (Enabled())
+		{
+			Totals unused = { 0, 0.0, 0, 0, 0, false };
+			Slots.resize(numSlots, unused);
+		}
+	}
+
+	//***************************************************************************************************************
+	void BirdStats::Reset(int slot, TEntityId entityId, double time)
+	{
+		if (Enabled())
+		{
+			Totals fresh = { entityId, time, 0, 0, 0, true };
+			Slots[slot] = fresh;
+		}
+	}
+
+	//***************************************************************************************************************
+	void BirdStats::Forget(int slot)
+	{
+		if (Enabled() && slot >= 0 && slot < static_cast<int>(Slots.size()))
+		{
+			Slots[slot].InUse = false;
+		}
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+
+#include "flocking.h"
+
+namespace demoteam
+{
+	//------------------------------------------
+	struct BirdStatsPolicy
+	{
+		float PeriodSeconds;	// each bird's summary covers this long (0 = no stats, and no per bird timing)
+	};
+
+	//------------------------------------------
+	// one bird's totals over its last sample period; what goes in its FlockStats
+	struct BirdStatsSummary
+	{
+		double PeriodStart;		// in the time Tick is given
+		double PeriodSeconds;
+		int Steps;
+		long long Candidates;	// neighbour candidates looked at, over all the steps
+		double ComputeSeconds;	// in UpdateFlocking, over all the steps
+	};
+
+	//------------------------------------------
+	// Per bird neighbour candidate counts and compute time, summed over a sample period: only the running totals are
+	// kept, never a history. By slot, like FlockersUpdate. Each bird's summary falls due once a period, in the sub
+	// tick its slot comes round in, so they go out spread across the period rather than all at once.
+	class BirdStats
+	{
+	public:
+		explicit BirdStats(const BirdStatsPolicy& policy);
+
+		bool Enabled() const { return Policy.PeriodSeconds > 0.0f; }
+
+		void Resize(int numSlots);
+		// a bird has just been given slot; its first period starts at time
+		void Reset(int slot, TEntityId entityId, double time);
+		void Forget(int slot);
+
+		void Add(int slot, int numCandidates, int stepNanoseconds)
+		{
+			auto& totals = Slots[slot];
+			++totals.Steps;
+			totals.Candidates += numCandidates;
+			totals.Nanoseconds += stepNanoseconds;
+		}
+
+		// hands send(entityId, summary) the summaries due in subTick, for periods subTicksPerPeriod long, and starts
+		// those birds' next period at time. A bird that's only just arrived waits for its slot to come round again,
+		// rather than sending a scrap of a period; birds that weren't stepped at all in theirs are skipped
+		template<class TSend>
+		void SendDue(long long subTick, int subTicksPerPeriod, double time, TSend&& send)
+		{
+			const double minSeconds = Policy.PeriodSeconds * 0.5;
+			int numSlots = Slots.size();
+			for (int islot = static_cast<int>(subTick % subTicksPerPeriod); islot < numSlots; islot += subTicksPerPeriod)
+			{
+				auto& totals = Slots[islot];
+				if (!totals.InUse || time - totals.PeriodStart < minSeconds)
+				{
+					continue;
+				}
+				if (totals.Steps > 0)
+				{
+					BirdStatsSummary summary = { totals.PeriodStart, time - totals.PeriodStart, totals.Steps, totals.Candidates, totals.Nanoseconds * 1e-9 };
+					send(totals.EntityId, summary);
+				}
+				totals.PeriodStart = time;
+				totals.Steps = 0;
+				totals.Candidates = 0;
+				totals.Nanoseconds = 0;
+			}
+		}
+
+	private:
+		//------------------------------------------
+		struct Totals
+		{
+			TEntityId EntityId;
+			double PeriodStart;
+			int Steps;
+			long long Candidates;
+			long long Nanoseconds;
+			bool InUse;
+		};
+
+		BirdStatsPolicy Policy;
+		std::vector<Totals> Slots;
+	};
+}
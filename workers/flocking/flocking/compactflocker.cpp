@@ -0,0 +1,100 @@
+#include "compactflocker.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace demoteam
+{
+	namespace
+	{
+		const float g_speedScale = 256.0f;
+
+		//***************************************************************************************************************
+		float SignNotZero(float v)
+		{
+			return v < 0.0f ? -1.0f : 1.0f;
+		}
+
+		//***************************************************************************************************************
+		std::uint8_t ToUnorm8(float v)
+		{
+			return static_cast<std::uint8_t>(floorf((std::min(std::max(v, -1.0f), 1.0f) * 0.5f + 0.5f) * 255.0f + 0.5f));
+		}
+
+		//***************************************************************************************************************
+		std::uint16_t ToUnorm16(float v)
+		{
+			return static_cast<std::uint16_t>(floorf(std::min(std::max(v, 0.0f), 1.0f) * 65535.0f + 0.5f));
+		}
+	}
+
+	//***************************************************************************************************************
+	void EncodeOctahedral(TFloat4Arg direction, std::uint8_t* encoded)
+	{
+		// project onto the octahedron |x|+|y|+|z| = 1, then fold the bottom half out over the corners
+		float l1 = fabsf(direction.X()) + fabsf(direction.Y()) + fabsf(direction.Z());
+		if (l1 < epsilon)
+		{
+			encoded[0] = ToUnorm8(0.0f);
+			encoded[1] = ToUnorm8(0.0f);
+			return;
+		}
+		float x = direction.X() / l1;
+		float y = direction.Y() / l1;
+		if (direction.Z() < 0.0f)
+		{
+			float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+			float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+			x = foldedX;
+			y = foldedY;
+		}
+		encoded[0] = ToUnorm8(x);
+		encoded[1] = ToUnorm8(y);
+	}
+
+	//***************************************************************************************************************
+	Float4 DecodeOctahedral(const std::uint8_t* encoded)
+	{
+		float x = encoded[0] / 255.0f * 2.0f - 1.0f;
+		float y = encoded[1] / 255.0f * 2.0f - 1.0f;
+		float z = 1.0f - fabsf(x) - fabsf(y);
+		if (z < 0.0f)
+		{
+			float unfoldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+			float unfoldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+			x = unfoldedX;
+			y = unfoldedY;
+		}
+		return normalize(Float4(x, y, z));
+	}
+
+	//***************************************************************************************************************
+	CompactFlocker EncodeCompactFlocker(const geometry::Aabb3& cell, const FlockTransform& transform, int entityIndex)
+	{
+		auto& lbb = cell.LeftBottomBack;
+		auto size = cell.RightTopFront - lbb;
+		auto relative = transform.Local - lbb;
+
+		CompactFlocker compact;
+		compact.Position[0] = ToUnorm16(relative.X() / size.X());
+		compact.Position[1] = ToUnorm16(relative.Y() / size.Y());
+		compact.Position[2] = ToUnorm16(relative.Z() / size.Z());
+
+		float speed = sqrtf(sqrMag(transform.Velocity));
+		compact.Speed = static_cast<std::uint16_t>(std::min(floorf(speed * g_speedScale + 0.5f), 65535.0f));
+		EncodeOctahedral(transform.Forward, compact.Forward);
+		EncodeOctahedral(transform.Velocity, compact.VelocityDirection);
+		compact.EntityIndex = entityIndex;
+		return compact;
+	}
+
+	//***************************************************************************************************************
+	FlockTransform DecodeCompactFlocker(const geometry::Aabb3& cell, const CompactFlocker& compact, const Coordinates& origin)
+	{
+		auto pos = DecodeCompactPosition(cell, compact);
+		auto velocity = compact.Speed > 0 ? DecodeOctahedral(compact.VelocityDirection) * (compact.Speed / g_speedScale) : zero3<Float4>();
+		FlockTransform transform(origin + pos, DecodeOctahedral(compact.Forward), velocity);
+		transform.Local = pos;
+		return transform;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+#include "flocking.h"
+#include "geometry.h"
+
+namespace demoteam
+{
+	//------------------------------------------
+	// What a neighbour search needs to know about an entity, in 16 bytes rather than the 56 of an id plus a
+	// FlockTransform, so a dense cell's worth of candidates stays in L1. Kept per grid cell, in the order of the
+	// cell's entity list.
+	//
+	// Accuracy, against the full transform:
+	//  - position is relative to the cell, 16 bits an axis: steps of cellSize/65535, so within 0.1mm on the 8m grid,
+	//    and only candidates that close to the search radius can come out differently
+	//  - forward and velocity direction are octahedral, 8 bits a component: under 1 degree out, 0.35 on average
+	//  - speed is in 1/256 m/s steps, clamped at 256 m/s
+	// With 5 m/s birds that puts a neighbour's velocity within about 0.09 m/s, well under what the velocity spring
+	// smooths out each step; replays won't match a full precision run bit for bit, though.
+	struct CompactFlocker
+	{
+		std::uint16_t Position[3];
+		std::uint16_t Speed;
+		std::uint8_t Forward[2];
+		std::uint8_t VelocityDirection[2];
+		std::int32_t EntityIndex;	// into the world snapshot
+	};
+
+	void EncodeOctahedral(TFloat4Arg direction, std::uint8_t* encoded);
+	Float4 DecodeOctahedral(const std::uint8_t* encoded);
+
+	CompactFlocker EncodeCompactFlocker(const geometry::Aabb3& cell, const FlockTransform& transform, int entityIndex);
+
+	FORCEINLINE Float4 DecodeCompactPosition(const geometry::Aabb3& cell, const CompactFlocker& compact)
+	{
+		const float scale = 1.0f / 65535.0f;
+		auto& lbb = cell.LeftBottomBack;
+		auto size = cell.RightTopFront - lbb;
+		return Float4(
+			lbb.X() + compact.Position[0] * scale * size.X(),
+			lbb.Y() + compact.Position[1] * scale * size.Y(),
+			lbb.Z() + compact.Position[2] * scale * size.Z());
+	}
+
+	// cells are laid out around the snapshot's origin, so that's where the position is put back relative to;
+	// directions come back renormalised
+	FlockTransform DecodeCompactFlocker(const geometry::Aabb3& cell, const CompactFlocker& compact, const Coordinates& origin);
+}
@@ -0,0 +1,367 @@
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <math.h>
+
+namespace demoteam
+{
+	namespace
+	{
+		//------------------------------------------
+		// a setting of type T somewhere in SimulationConfig, and the range it's allowed
+		template<typename T>
+		struct ConfigOption
+		{
+			const char* Key;
+			T& (*Field)(SimulationConfig& config);
+			T Min;
+			T Max;
+			const char* Help;
+		};
+
+		const ConfigOption<int> g_intOptions[] =
+		{
+			{ "target_fps", [](SimulationConfig& c) -> int& { return c.TargetFPS; }, 1, 240, "frames simulated a second" },
+			{ "threads", [](SimulationConfig& c) -> int& { return c.NumThreads; }, 1, g_maxSimulationThreads, "threads in the flocking pool" },
+			{ "phases", [](SimulationConfig& c) -> int& { return c.Schedule.NumPhases; }, 1, 64, "sub ticks per frame" },
+			{ "max_tier", [](SimulationConfig& c) -> int& { return c.Schedule.MaxTier; }, 0, 8, "a tier t bird is stepped every 2^t frames" },
+			{ "sparse_candidate_count", [](SimulationConfig& c) -> int& { return c.Schedule.SparseCandidateCount; }, 0, 1000000, "fewer candidates than this puts a bird up a tier (0 = off)" },
+			{ "budget_overruns_to_raise", [](SimulationConfig& c) -> int& { return c.FrameBudget.OverrunsToRaise; }, 0, 1000000, "ticks in a row over budget that degrade a level whatever the smoothed load (0 = never)" },
+			{ "budget_ticks_to_lower", [](SimulationConfig& c) -> int& { return c.FrameBudget.TicksToLower; }, 1, 1000000, "calm ticks before recovering a degradation level" },
+			{ "budget_candidate_cap", [](SimulationConfig& c) -> int& { return c.FrameBudget.CandidateCap; }, 0, 1000000, "candidates per bird once degraded (0 = no cap)" },
+			{ "max_neighbours", [](SimulationConfig& c) -> int& { return c.MaxNeighbours; }, 1, g_maxNeighbours, "caps every bird's number_to_consider" },
+			{ "warm_start_grace_frames", [](SimulationConfig& c) -> int& { return c.WarmStart.GraceFrames; }, 0, 1000000, "frames a snapshot stands in for the view after a restart" },
+		};
+
+		const ConfigOption<float> g_floatOptions[] =
+		{
+			{ "far_from_player_distance", [](SimulationConfig& c) -> float& { return c.Schedule.FarFromPlayerDistance; }, 0.0f, 1e6f, "further than this from every player puts a bird up a tier (0 = off)" },
+			{ "budget_smoothing", [](SimulationConfig& c) -> float& { return c.FrameBudget.Smoothing; }, 0.0f, 1.0f, "weight of the latest tick in the smoothed load" },
+			{ "budget_raise_at_load", [](SimulationConfig& c) -> float& { return c.FrameBudget.RaiseAtLoad; }, 0.0f, 1e30f, "smoothed load above which to degrade a level" },
+			{ "budget_lower_at_load", [](SimulationConfig& c) -> float& { return c.FrameBudget.LowerAtLoad; }, 0.0f, 1e30f, "smoothed load below which to recover one" },
+			{ "budget_neighbour_scale", [](SimulationConfig& c) -> float& { return c.FrameBudget.NeighbourScale; }, 0.0f, 1.0f, "number_to_consider is scaled by this once degraded" },
+			{ "budget_skip_fraction", [](SimulationConfig& c) -> float& { return c.FrameBudget.SkipFraction; }, 0.0f, 1.0f, "share of each tick's birds left for later at the last level" },
+			{ "update_position", [](SimulationConfig& c) -> float& { return c.UpdateThresholds.Position; }, 0.0f, 1e6f, "metres moved before a position is resent" },
+			{ "update_forward", [](SimulationConfig& c) -> float& { return c.UpdateThresholds.Forward; }, 0.0f, 2.0f, "per component change before a facing is resent" },
+			{ "update_velocity", [](SimulationConfig& c) -> float& { return c.UpdateThresholds.Velocity; }, 0.0f, 1e6f, "per component change, m/s, before a velocity is resent" },
+			{ "update_dead_reckoning_drift", [](SimulationConfig& c) -> float& { return c.UpdateThresholds.DeadReckoningDrift; }, 0.0f, 1e6f, "metres an extrapolated position can be out" },
+			{ "update_position_quantum", [](SimulationConfig& c) -> float& { return c.UpdateThresholds.PositionQuantum; }, 0.0f, 1e6f, "positions are sent rounded to this (0 = off)" },
+			{ "update_vector_quantum", [](SimulationConfig& c) -> float& { return c.UpdateThresholds.VectorQuantum; }, 0.0f, 1.0f, "facings and velocities are sent rounded to this (0 = off)" },
+			{ "update_max_silence_seconds", [](SimulationConfig& c) -> float& { return c.UpdateThresholds.MaxSilenceSeconds; }, 0.0f, 1e6f, "everything gets resent at least this often" },
+			{ "update_steering_seconds", [](SimulationConfig& c) -> float& { return c.UpdateThresholds.SteeringSeconds; }, 0.0f, 1e6f, "least time between a bird's target velocities, with update_mode=steering" },
+			{ "far_field_range", [](SimulationConfig& c) -> float& { return c.FarField.Range; }, 0.0f, 1e6f, "attraction and follow reach this far over cell aggregates, at extra cost per bird (0 = off)" },
+			{ "far_field_theta", [](SimulationConfig& c) -> float& { return c.FarField.Theta; }, 0.0f, 4.0f, "cell size over distance below which a cell is taken whole" },
+			{ "neighbour_skin", [](SimulationConfig& c) -> float& { return c.NeighbourLists.Skin; }, 0.0f, 1000.0f, "per-bird lists reach this far past SearchRange (0 = off)" },
+			{ "neighbour_rebuild_frames", [](SimulationConfig& c) -> float& { return c.NeighbourLists.RebuildFrames; }, 1.0f, 1000.0f, "lists are rebuilt at least this often" },
+			{ "grid_cell_size", [](SimulationConfig& c) -> float& { return c.Grid.CellSize; }, 0.5f, 1000.0f, "metres across a grid cell" },
+			{ "grid_half_extent", [](SimulationConfig& c) -> float& { return c.Grid.HalfExtent; }, 1.0f, 1e6f, "the grid covers this far from the origin on every axis" },
+			{ "snapshot_seconds", [](SimulationConfig& c) -> float& { return c.WarmStart.SaveEverySeconds; }, 0.0f, 1e6f, "the worker writes a snapshot this often (0 = never)" },
+			{ "stats_seconds", [](SimulationConfig& c) -> float& { return c.BirdStats.PeriodSeconds; }, 0.0f, 1e6f, "each bird's FlockStats summary covers this long (0 = off)" },
+		};
+
+		const ConfigOption<bool> g_boolOptions[] =
+		{
+			{ "budget_enabled", [](SimulationConfig& c) -> bool& { return c.FrameBudget.Enabled; }, false, true, "degrade when ticks run long (off keeps every run doing the same work)" },
+			{ "compact_neighbours", [](SimulationConfig& c) -> bool& { return c.CompactNeighbours; }, false, true, "search packed, quantised copies of the cells" },
+			{ "local_origin", [](SimulationConfig& c) -> bool& { return c.LocalOrigin; }, false, true, "search and steer in floats about an origin that follows the flock" },
+		};
+
+		//------------------------------------------
+		// a file to read or write; any text will do, and empty means none
+		struct PathOption
+		{
+			const char* Key;
+			std::string& (*Field)(SimulationConfig& config);
+			const char* Help;
+		};
+
+		const PathOption g_pathOptions[] =
+		{
+			{ "confinement", [](SimulationConfig& c) -> std::string& { return c.ConfinementPath; }, "a baked confinement field in place of the built in bounds" },
+			{ "snapshot", [](SimulationConfig& c) -> std::string& { return c.SnapshotPath; }, "a flock snapshot the worker warm starts from and keeps up to date" },
+		};
+
+		const char* const g_updateModeKey = "update_mode";
+		const char* const g_updateModeNames[] = { "full", "threshold", "dead_reckoning", "steering" };
+
+		//***************************************************************************************************************
+		bool ParseValue(const std::string& text, int& value)
+		{
+			char* end = nullptr;
+			long parsed = strtol(text.c_str(), &end, 10);
+			value = static_cast<int>(parsed);
+			return !text.empty() && *end == 0 && parsed == value;
+		}
+
+		//***************************************************************************************************************
+		bool ParseValue(const std::string& text, float& value)
+		{
+			char* end = nullptr;
+			value = strtof(text.c_str(), &end);
+			return !text.empty() && *end == 0 && !isnan(value);
+		}
+
+		//***************************************************************************************************************
+		bool ParseValue(const std::string& text, bool& value)
+		{
+			value = text == "true" || text == "on" || text == "1";
+			return value || text == "false" || text == "off" || text == "0";
+		}
+
+		//***************************************************************************************************************
+		std::string FormatValue(int value)
+		{
+			return std::to_string(value);
+		}
+
+		//***************************************************************************************************************
+		std::string FormatValue(float value)
+		{
+			char buf[32];
+			snprintf(buf, sizeof(buf), "%g", value);
+			return buf;
+		}
+
+		//***************************************************************************************************************
+		std::string FormatValue(bool value)
+		{
+			return value ? "true" : "false";
+		}
+
+		//***************************************************************************************************************
+		template<typename TOption, size_t N>
+		const TOption* FindOption(const TOption (&options)[N], const std::string& key)
+		{
+			for (size_t c0 = 0; c0 < N; ++c0)
+			{
+				if (key == options[c0].Key)
+				{
+					return &options[c0];
+				}
+			}
+			return nullptr;
+		}
+
+		//***************************************************************************************************************
+		template<typename T>
+		bool SetOption(const ConfigOption<T>& option, SimulationConfig& config, const std::string& value)
+		{
+			T parsed;
+			if (!ParseValue(value, parsed))
+			{
+				printf("%s: can't read '%s'\n", option.Key, value.c_str());
+				return false;
+			}
+			if (!(parsed >= option.Min && parsed <= option.Max))
+			{
+				printf("%s: %s is outside %s to %s\n", option.Key, value.c_str(), FormatValue(option.Min).c_str(), FormatValue(option.Max).c_str());
+				return false;
+			}
+			option.Field(config) = parsed;
+			return true;
+		}
+
+		//***************************************************************************************************************
+		template<typename T, size_t N>
+		void DescribeOptions(const ConfigOption<T> (&options)[N], SimulationConfig& config, std::string& out)
+		{
+			for (size_t c0 = 0; c0 < N; ++c0)
+			{
+				out += std::string(options[c0].Key) + " = " + FormatValue(options[c0].Field(config)) + "\n";
+			}
+		}
+
+		//***************************************************************************************************************
+		template<typename T, size_t N>
+		void PrintOptions(const ConfigOption<T> (&options)[N], SimulationConfig& config)
+		{
+			for (size_t c0 = 0; c0 < N; ++c0)
+			{
+				std::string flag = std::string("--") + options[c0].Key + "=" + FormatValue(options[c0].Field(config));
+				printf("  %-40s %s\n", flag.c_str(), options[c0].Help);
+			}
+		}
+
+		//***************************************************************************************************************
+		std::string Trim(const std::string& text)
+		{
+			const char* space = " \t\r\n";
+			size_t first = text.find_first_not_of(space);
+			if (first == std::string::npos)
+			{
+				return std::string();
+			}
+			return text.substr(first, text.find_last_not_of(space) - first + 1);
+		}
+	}
+
+	//***************************************************************************************************************
+	bool SetConfigOption(SimulationConfig& config, const std::string& key, const std::string& value)
+	{
+		if (auto option = FindOption(g_intOptions, key))
+		{
+			return SetOption(*option, config, value);
+		}
+		if (auto option = FindOption(g_floatOptions, key))
+		{
+			return SetOption(*option, config, value);
+		}
+		if (auto option = FindOption(g_boolOptions, key))
+		{
+			return SetOption(*option, config, value);
+		}
+
+		if (key == g_updateModeKey)
+		{
+			for (int mode = FullUpdates; mode <= SteeringUpdates; ++mode)
+			{
+				if (value == g_updateModeNames[mode])
+				{
+					config.UpdateMode = static_cast<TransformUpdateMode>(mode);
+					return true;
+				}
+			}
+			printf("%s: '%s' isn't full, threshold, dead_reckoning or steering\n", g_updateModeKey, value.c_str());
+			return false;
+		}
+		if (auto option = FindOption(g_pathOptions, key))
+		{
+			option->Field(config) = value;
+			return true;
+		}
+
+		printf("there's no setting called '%s'\n", key.c_str());
+		return false;
+	}
+
+	//***************************************************************************************************************
+	bool LoadConfigFile(SimulationConfig& config, const std::string& path)
+	{
+		std::ifstream file(path.c_str());
+		if (!file)
+		{
+			printf("couldn't open config file %s\n", path.c_str());
+			return false;
+		}
+
+		std::string line;
+		for (int lineNumber = 1; std::getline(file, line); ++lineNumber)
+		{
+			line = Trim(line);
+			if (line.empty() || line[0] == '#')
+			{
+				continue;
+			}
+
+			size_t equals = line.find('=');
+			if (equals == std::string::npos)
+			{
+				printf("%s:%d: expected key = value\n", path.c_str(), lineNumber);
+				return false;
+			}
+			if (!SetConfigOption(config, Trim(line.substr(0, equals)), Trim(line.substr(equals + 1))))
+			{
+				printf("%s:%d: setting not applied\n", path.c_str(), lineNumber);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//***************************************************************************************************************
+	bool ValidateConfig(const SimulationConfig& config)
+	{
+		bool ok = true;
+		if (!IsValidGridLayout(config.Grid))
+		{
+			printf("grid_cell_size %g over grid_half_extent %g is more cells across than the grid can index\n", config.Grid.CellSize, config.Grid.HalfExtent);
+			ok = false;
+		}
+		if (config.FrameBudget.Enabled && !(config.FrameBudget.LowerAtLoad < config.FrameBudget.RaiseAtLoad))
+		{
+			printf("budget_lower_at_load has to be below budget_raise_at_load\n");
+			ok = false;
+		}
+		return ok;
+	}
+
+	//***************************************************************************************************************
+	std::string DescribeConfig(const SimulationConfig& config)
+	{
+		// the options' accessors hand out references, so they need something they can write to
+		SimulationConfig copy = config;
+		std::string out;
+		DescribeOptions(g_intOptions, copy, out);
+		DescribeOptions(g_floatOptions, copy, out);
+		DescribeOptions(g_boolOptions, copy, out);
+		out += std::string(g_updateModeKey) + " = " + g_updateModeNames[config.UpdateMode] + "\n";
+		for (size_t c0 = 0; c0 < sizeof(g_pathOptions) / sizeof(g_pathOptions[0]); ++c0)
+		{
+			out += std::string(g_pathOptions[c0].Key) + " = " + g_pathOptions[c0].Field(copy) + "\n";
+		}
+		return out;
+	}
+
+	//***************************************************************************************************************
+	void PrintConfigOptions(const SimulationConfig& config)
+	{
+		SimulationConfig copy = config;
+		PrintOptions(g_intOptions, copy);
+		PrintOptions(g_floatOptions, copy);
+		PrintOptions(g_boolOptions, copy);
+		printf("  %-40s %s\n", (std::string("--") + g_updateModeKey + "=" + g_updateModeNames[config.UpdateMode]).c_str(), "full, threshold, dead_reckoning or steering");
+		for (size_t c0 = 0; c0 < sizeof(g_pathOptions) / sizeof(g_pathOptions[0]); ++c0)
+		{
+			printf("  %-40s %s\n", (std::string("--") + g_pathOptions[c0].Key + "=" + g_pathOptions[c0].Field(copy)).c_str(), g_pathOptions[c0].Help);
+		}
+		printf("  %-40s %s\n", "--config=<path>", "key = value lines, applied where they come on the command line");
+	}
+
+	//***************************************************************************************************************
+	bool ParseCommandLine(int argc, char** argv, SimulationConfig& config, CommandLine& commandLine)
+	{
+		for (int iarg = 1; iarg < argc; ++iarg)
+		{
+			std::string arg = argv[iarg];
+			if (arg.compare(0, 2, "--") != 0)
+			{
+				commandLine.Positional.push_back(arg);
+				continue;
+			}
+
+			size_t equals = arg.find('=');
+			std::string key = arg.substr(2, equals == std::string::npos ? std::string::npos : equals - 2);
+			bool hasValue = equals != std::string::npos;
+			std::string value = hasValue ? arg.substr(equals + 1) : std::string();
+
+			if (key == "autotune" && !hasValue)
+			{
+				commandLine.Autotune = true;
+			}
+			else if (key == "help" && !hasValue)
+			{
+				commandLine.Help = true;
+			}
+			else if (key == "config")
+			{
+				if (!LoadConfigFile(config, value))
+				{
+					return false;
+				}
+			}
+			else if (!hasValue && FindOption(g_boolOptions, key) == nullptr)
+			{
+				printf("--%s needs a value\n", key.c_str());
+				return false;
+			}
+			else if (!SetConfigOption(config, key, hasValue ? value : "true"))
+			{
+				return false;
+			}
+		}
+		return ValidateConfig(config);
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "simulation.h"
+
+namespace demoteam
+{
+	// Every SimulationConfig setting has a name, like "threads" or "far_field_range", and can be set from a config
+	// file or the command line. Anything wrong is printed, and the call returns false.
+
+	// one setting, checked against its own range
+	bool SetConfigOption(SimulationConfig& config, const std::string& key, const std::string& value);
+
+	// key = value lines; blank lines and ones starting with # are skipped. Stops at the first bad line. Doesn't
+	// ValidateConfig, since settings applied after it might put things right
+	bool LoadConfigFile(SimulationConfig& config, const std::string& path);
+
+	// the settings that only make sense together
+	bool ValidateConfig(const SimulationConfig& config);
+
+	// every setting, a key = value line each, that LoadConfigFile reads back to the same config
+	std::string DescribeConfig(const SimulationConfig& config);
+
+	// every setting as a flag, with config's value and what it's for
+	void PrintConfigOptions(const SimulationConfig& config);
+
+	//------------------------------------------
+	// what's left of the command line for the host
+	struct CommandLine
+	{
+		CommandLine() : Autotune(false), Help(false) {}
+		std::vector<std::string> Positional;
+		bool Autotune;
+		bool Help;
+	};
+
+	// --config=<path> loads a file and --<key>=<value> sets one setting, in the order given so later ones win; a bare
+	// --<key> turns a switch on. --autotune and --help are only noted, and anything not starting -- is positional.
+	// Validates what it ends up with
+	bool ParseCommandLine(int argc, char** argv, SimulationConfig& config, CommandLine& commandLine);
+}
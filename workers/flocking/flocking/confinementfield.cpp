@@ -0,0 +1,249 @@
+#include "confinementfield.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <math.h>
+
+namespace demoteam
+{
+	namespace
+	{
+		const char g_fieldMagic[8] = { 'F', 'L', 'O', 'C', 'K', 'C', 'F', 'D' };
+		const std::uint32_t g_fieldVersion = 1;
+		const int g_maxSamplesPerAxis = 4096;
+
+		//***************************************************************************************************************
+		template<class T> bool Read(FILE* file, T& value)
+		{
+			return fread(&value, sizeof(T), 1, file) == 1;
+		}
+	}
+
+	//***************************************************************************************************************
+	ConfinementFieldDesc DefaultConfinementFieldDesc()
+	{
+		ConfinementFieldDesc desc;
+		desc.LeftBottomBack = Float4(-256.0f, -32.0f, -256.0f);
+		desc.RightTopFront = Float4(256.0f, 96.0f, 256.0f);
+		desc.CellSize = 8.0f;
+		desc.OriginRadius = 192.0f;
+		desc.MinHeight = 10.0f;
+		desc.MaxHeight = 30.0f;
+		desc.HeightStrength = 5.0f;
+		return desc;
+	}
+
+	//***************************************************************************************************************
+	Float4 EvaluateConfinement(const ConfinementFieldDesc& desc, TFloat4Arg pos)
+	{
+		Float4 push = zero3<Float4>();
+
+		if (desc.OriginRadius > 0.0f)
+		{
+			// KeepNearOrigin's
+			auto toOrigin = zero3<Float4>() - pos;
+			auto sqrDist = sqrMag(toOrigin);
+			push = push + (sqrDist > epsilon ? normalize(toOrigin)*powf(sqrDist / sqr(desc.OriginRadius), 16.0f) : zero3<Float4>());
+		}
+
+		float height = pos.Y();
+		if (height < desc.MinHeight)
+		{
+			push = push + unitY3<Float4>()*((desc.MinHeight - height)*desc.HeightStrength);
+		}
+		else if (height > desc.MaxHeight)
+		{
+			push = push - unitY3<Float4>()*((height - desc.MaxHeight)*desc.HeightStrength);
+		}
+
+		for (auto itObstacle = desc.Obstacles.begin(); itObstacle != desc.Obstacles.end(); ++itObstacle)
+		{
+			auto away = pos - itObstacle->Centre;
+			float dist = sqrtf(sqrMag(away));
+			float intoMargin = itObstacle->Radius + itObstacle->Margin - dist;
+			if (intoMargin > 0.0f && dist > epsilon)
+			{
+				float scale = itObstacle->Margin > 0.0f ? std::min(intoMargin / itObstacle->Margin, 1.0f) : 1.0f;
+				push = push + away*(itObstacle->Strength*scale / dist);
+			}
+		}
+		return push;
+	}
+
+	//***************************************************************************************************************
+	ConfinementField::ConfinementField() : Origin(zero3<Float4>()), CellSize(1.0f), OneOnCellSize(1.0f)
+	{
+		Dims[0] = Dims[1] = Dims[2] = 0;
+	}
+
+	//***************************************************************************************************************
+	void ConfinementField::Clear()
+	{
+		Dims[0] = Dims[1] = Dims[2] = 0;
+		Samples.clear();
+	}
+
+	//***************************************************************************************************************
+	void ConfinementField::Bake(const ConfinementFieldDesc& desc)
+	{
+		Origin = desc.LeftBottomBack;
+		CellSize = desc.CellSize;
+		OneOnCellSize = 1.0f / desc.CellSize;
+		auto extent = desc.RightTopFront - desc.LeftBottomBack;
+		Dims[0] = std::max(static_cast<int>(ceilf(extent.X() * OneOnCellSize)), 1) + 1;
+		Dims[1] = std::max(static_cast<int>(ceilf(extent.Y() * OneOnCellSize)), 1) + 1;
+		Dims[2] = std::max(static_cast<int>(ceilf(extent.Z() * OneOnCellSize)), 1) + 1;
+
+		Samples.resize(3 * Dims[0] * Dims[1] * Dims[2]);
+		auto sample = Samples.begin();
+		for (int iz = 0; iz < Dims[2]; ++iz)
+		{
+			for (int iy = 0; iy < Dims[1]; ++iy)
+			{
+				for (int ix = 0; ix < Dims[0]; ++ix)
+				{
+					auto push = EvaluateConfinement(desc, Origin + Float4(ix * CellSize, iy * CellSize, iz * CellSize));
+					*sample++ = push.X();
+					*sample++ = push.Y();
+					*sample++ = push.Z();
+				}
+			}
+		}
+	}
+
+	//***************************************************************************************************************
+	bool ConfinementField::Save(const std::string& path) const
+	{
+		FILE* file = fopen(path.c_str(), "wb");
+		if (file == nullptr)
+		{
+			printf("couldn't open %s to write the confinement field\n", path.c_str());
+			return false;
+		}
+
+		std::int32_t dims[3] = { Dims[0], Dims[1], Dims[2] };
+		float origin[3] = { Origin.X(), Origin.Y(), Origin.Z() };
+		bool ok = fwrite(g_fieldMagic, sizeof(g_fieldMagic), 1, file) == 1 &&
+			fwrite(&g_fieldVersion, sizeof(g_fieldVersion), 1, file) == 1 &&
+			fwrite(dims, sizeof(dims), 1, file) == 1 &&
+			fwrite(origin, sizeof(origin), 1, file) == 1 &&
+			fwrite(&CellSize, sizeof(CellSize), 1, file) == 1 &&
+			(Samples.empty() || fwrite(&Samples[0], sizeof(float), Samples.size(), file) == Samples.size());
+		fclose(file);
+		if (!ok)
+		{
+			printf("couldn't write the confinement field to %s\n", path.c_str());
+		}
+		return ok;
+	}
+
+	//***************************************************************************************************************
+	bool ConfinementField::Load(const std::string& path)
+	{
+		Clear();
+		FILE* file = fopen(path.c_str(), "rb");
+		if (file == nullptr)
+		{
+			printf("couldn't open confinement field %s\n", path.c_str());
+			return false;
+		}
+
+		char magic[sizeof(g_fieldMagic)];
+		std::uint32_t version = 0;
+		std::int32_t dims[3] = { 0, 0, 0 };
+		float origin[3];
+		float cellSize = 0.0f;
+		bool ok = fread(magic, sizeof(magic), 1, file) == 1 && memcmp(magic, g_fieldMagic, sizeof(magic)) == 0 &&
+			Read(file, version) && version == g_fieldVersion &&
+			Read(file, dims) && Read(file, origin) && Read(file, cellSize);
+
+		// nothing in the header gets trusted with an allocation until it looks sane
+		for (int c0 = 0; c0 < 3 && ok; ++c0)
+		{
+			ok = dims[c0] > 1 && dims[c0] <= g_maxSamplesPerAxis;
+		}
+		ok = ok && cellSize > 0.0f;
+
+		// nor until the file is exactly the size it says
+		if (ok)
+		{
+			long long headerBytes = ftell(file);
+			fseek(file, 0, SEEK_END);
+			long long fileBytes = ftell(file);
+			fseek(file, headerBytes, SEEK_SET);
+			ok = fileBytes == headerBytes + 3LL * dims[0] * dims[1] * dims[2] * static_cast<long long>(sizeof(float));
+		}
+
+		if (ok)
+		{
+			Samples.resize(3 * static_cast<size_t>(dims[0]) * dims[1] * dims[2]);
+			ok = fread(&Samples[0], sizeof(float), Samples.size(), file) == Samples.size();
+		}
+		fclose(file);
+
+		if (!ok)
+		{
+			printf("%s isn't a confinement field this build can read\n", path.c_str());
+			Clear();
+			return false;
+		}
+
+		Dims[0] = dims[0];
+		Dims[1] = dims[1];
+		Dims[2] = dims[2];
+		Origin = Float4(origin[0], origin[1], origin[2]);
+		CellSize = cellSize;
+		OneOnCellSize = 1.0f / cellSize;
+		return true;
+	}
+
+	//***************************************************************************************************************
+	Float4 ConfinementField::Sample(TFloat4Arg pos) const
+	{
+		if (Samples.empty())
+		{
+			return zero3<Float4>();
+		}
+
+		// the cell, and how far across it, clamped so the edge cells cover everything outside
+		auto local = (pos - Origin) * OneOnCellSize;
+		auto axis = [](float coord, int dim, int& cell)
+		{
+			float clamped = std::min(std::max(coord, 0.0f), static_cast<float>(dim - 1));
+			cell = std::min(static_cast<int>(clamped), dim - 2);
+			return clamped - cell;
+		};
+		int ix, iy, iz;
+		float fx = axis(local.X(), Dims[0], ix);
+		float fy = axis(local.Y(), Dims[1], iy);
+		float fz = axis(local.Z(), Dims[2], iz);
+
+		const int strideY = 3 * Dims[0];
+		const int strideZ = strideY * Dims[1];
+		const float* s000 = &Samples[3 * ix + strideY * iy + strideZ * iz];
+		const float* s010 = s000 + strideY;
+		const float* s001 = s000 + strideZ;
+		const float* s011 = s001 + strideY;
+
+		// the eight corner weights once, then the same sum for each component
+		float w000 = (1.0f - fx) * (1.0f - fy) * (1.0f - fz);
+		float w100 = fx * (1.0f - fy) * (1.0f - fz);
+		float w010 = (1.0f - fx) * fy * (1.0f - fz);
+		float w110 = fx * fy * (1.0f - fz);
+		float w001 = (1.0f - fx) * (1.0f - fy) * fz;
+		float w101 = fx * (1.0f - fy) * fz;
+		float w011 = (1.0f - fx) * fy * fz;
+		float w111 = fx * fy * fz;
+
+		float result[3];
+		for (int c0 = 0; c0 < 3; ++c0)
+		{
+			result[c0] = w000 * s000[c0] + w100 * s000[c0 + 3] + w010 * s010[c0] + w110 * s010[c0 + 3] +
+				w001 * s001[c0] + w101 * s001[c0 + 3] + w011 * s011[c0] + w111 * s011[c0 + 3];
+		}
+		return Float4(result[0], result[1], result[2]);
+	}
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "flocking.h"
+
+namespace demoteam
+{
+	//------------------------------------------
+	// a sphere to keep out of, pushing harder the further into its margin a bird gets
+	struct ConfinementObstacle
+	{
+		ConfinementObstacle(TFloat4Arg centre, float radius, float margin, float strength) : Centre(centre), Radius(radius), Margin(margin), Strength(strength) {}
+		Float4 Centre;
+		float Radius;
+		float Margin;
+		float Strength;		// at the surface and inside
+	};
+
+	//------------------------------------------
+	// what ConfinementField::Bake samples
+	struct ConfinementFieldDesc
+	{
+		ConfinementFieldDesc() : LeftBottomBack(zero3<Float4>()), RightTopFront(zero3<Float4>()), CellSize(1.0f), OriginRadius(0.0f), MinHeight(0.0f), MaxHeight(0.0f), HeightStrength(0.0f) {}
+		Float4 LeftBottomBack;
+		Float4 RightTopFront;
+		float CellSize;
+		float OriginRadius;		// KeepNearOrigin's pull, exact at the samples; 0 leaves it out
+		float MinHeight;		// a vertical push of HeightStrength per metre outside [MinHeight, MaxHeight]; stands in
+		float MaxHeight;		// for KeepAtGoodHeight, which flips the bird's own vertical steering and so can't be baked
+		float HeightStrength;
+		std::vector<ConfinementObstacle> Obstacles;
+	};
+
+	// today's bounds, over where the birds can get to, at the grid's cell size
+	ConfinementFieldDesc DefaultConfinementFieldDesc();
+
+	//------------------------------------------
+	// A steering offset sampled on a regular grid: however many bounds and obstacles went into it, a bird pays for
+	// one trilinear lookup. Outside the grid it clamps to the nearest edge; anything sharper than a cell, like the edge
+	// of the height band, comes out softened over one.
+	// On disk: magic, version, dimensions, origin and cell size, then x-fastest float triples. Host byte order, like
+	// recordings.
+	class ConfinementField
+	{
+	public:
+		ConfinementField();
+
+		bool IsLoaded() const { return !Samples.empty(); }
+		void Clear();
+
+		bool Load(const std::string& path);
+		bool Save(const std::string& path) const;
+		void Bake(const ConfinementFieldDesc& desc);
+
+		Float4 Sample(TFloat4Arg pos) const;
+
+		int NumSamples() const { return Samples.size() / 3; }
+		long long Bytes() const { return Samples.size() * sizeof(float); }
+
+	private:
+		int Dims[3];
+		Float4 Origin;
+		float CellSize;
+		float OneOnCellSize;
+		std::vector<float> Samples;
+	};
+
+	// what the field holds at pos, from the description rather than the samples
+	Float4 EvaluateConfinement(const ConfinementFieldDesc& desc, TFloat4Arg pos);
+}
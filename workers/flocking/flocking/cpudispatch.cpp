@@ -0,0 +1,97 @@
+#include "cpudispatch.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace demoteam
+{
+	namespace
+	{
+		const char* const g_isaLevelNames[NumIsaLevels] = { "generic", "sse4.2", "avx2", "avx512" };
+
+		//***************************************************************************************************************
+		IsaLevel ChooseKernelIsaLevel()
+		{
+			IsaLevel level = std::min(DetectIsaLevel(), BuiltIsaLevel());
+
+			// for comparing the kernels on one machine, or ruling one out
+			const char* cap = getenv("FLOCKING_ISA");
+			if (cap != nullptr && cap[0] != 0)
+			{
+				IsaLevel capLevel;
+				if (ParseIsaLevel(cap, capLevel))
+				{
+					level = std::min(level, capLevel);
+				}
+				else
+				{
+					printf("FLOCKING_ISA: '%s' isn't one of generic, sse4.2, avx2 or avx512; ignoring it\n", cap);
+				}
+			}
+			return level;
+		}
+	}
+
+	//***************************************************************************************************************
+	const char* IsaLevelName(IsaLevel level)
+	{
+		return level >= 0 && level < NumIsaLevels ? g_isaLevelNames[level] : "unknown";
+	}
+
+	//***************************************************************************************************************
+	bool ParseIsaLevel(const char* name, IsaLevel& level)
+	{
+		for (int ilevel = 0; ilevel < NumIsaLevels; ++ilevel)
+		{
+			if (strcmp(name, g_isaLevelNames[ilevel]) == 0)
+			{
+				level = static_cast<IsaLevel>(ilevel);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//***************************************************************************************************************
+	IsaLevel DetectIsaLevel()
+	{
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+		// these check the OS saves the wider registers too, not just that the CPU has them
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl") &&
+			__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq"))
+		{
+			return Avx512Isa;
+		}
+		if (__builtin_cpu_supports("avx2"))
+		{
+			return Avx2Isa;
+		}
+		if (__builtin_cpu_supports("sse4.2"))
+		{
+			return Sse42Isa;
+		}
+#endif
+		return GenericIsa;
+	}
+
+	//***************************************************************************************************************
+	IsaLevel BuiltIsaLevel()
+	{
+#ifdef FLOCKING_ISA_CLONES
+		return Avx512Isa;
+#else
+		return GenericIsa;
+#endif
+	}
+
+	//***************************************************************************************************************
+	IsaLevel KernelIsaLevel()
+	{
+		static const IsaLevel level = ChooseKernelIsaLevel();
+		return level;
+	}
+}
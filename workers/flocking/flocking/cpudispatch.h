@@ -0,0 +1,32 @@
+#pragma once
+
+// FLOCKING_ISA_DISPATCH comes from the build (cmake -DFLOCKING_ISA_DISPATCH=ON); only GCC and Clang on x86 can build
+// a function for an ISA the rest of the binary doesn't assume, so elsewhere there's just the one kernel
+#if defined(FLOCKING_ISA_DISPATCH) && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define FLOCKING_ISA_CLONES
+#endif
+
+namespace demoteam
+{
+	// in order: each level has everything the one before it has
+	enum IsaLevel
+	{
+		GenericIsa,		// whatever the compiler targets by default; SSE2 on x86-64
+		Sse42Isa,
+		Avx2Isa,
+		Avx512Isa,		// F, VL, BW and DQ
+		NumIsaLevels
+	};
+
+	const char* IsaLevelName(IsaLevel level);
+	// the names IsaLevelName gives; false if it isn't one
+	bool ParseIsaLevel(const char* name, IsaLevel& level);
+
+	// the best level both the CPU and the OS support
+	IsaLevel DetectIsaLevel();
+	// the best level this build has a steering kernel for
+	IsaLevel BuiltIsaLevel();
+	// what UpdateFlocking runs: the lower of those two, and no higher than FLOCKING_ISA=<name> if that's set.
+	// Decided once, on the first call
+	IsaLevel KernelIsaLevel();
+}
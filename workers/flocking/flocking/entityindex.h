@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace demoteam
+{
+	//------------------------------------------
+	// Entity id -> index, open addressed. Clear keeps the table, so refilling it every frame with about as many
+	// entities as last time doesn't allocate; an unordered_map frees and reallocates every node.
+	class EntityIndex
+	{
+	public:
+		typedef std::int64_t TEntityId;
+
+		EntityIndex() : Count(0) {}
+
+		void Clear()
+		{
+			std::fill(Slots.begin(), Slots.end(), Slot());
+			Count = 0;
+		}
+
+		void Reserve(int n)
+		{
+			if (n * 2 > static_cast<int>(Slots.size()))
+			{
+				Rehash(n * 2);
+			}
+		}
+
+		// overwrites the index if it's already there
+		void Set(TEntityId entityId, int index)
+		{
+			Reserve(Count + 1);
+			auto& slot = Find(entityId);
+			if (slot.Index < 0)
+			{
+				slot.EntityId = entityId;
+				++Count;
+			}
+			slot.Index = index;
+		}
+
+		// -1 if it isn't there
+		int Get(TEntityId entityId) const
+		{
+			return Slots.empty() ? -1 : const_cast<EntityIndex*>(this)->Find(entityId).Index;
+		}
+
+	private:
+		struct Slot
+		{
+			Slot() : EntityId(0), Index(-1) {}
+			TEntityId EntityId;
+			int Index;	// -1 when empty
+		};
+
+		Slot& Find(TEntityId entityId)
+		{
+			// ids tend to be sequential, so mix them up before masking
+			std::size_t mask = Slots.size() - 1;
+			std::size_t islot = static_cast<std::size_t>((static_cast<std::uint64_t>(entityId) * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+			while (Slots[islot].Index >= 0 && Slots[islot].EntityId != entityId)
+			{
+				islot = (islot + 1) & mask;
+			}
+			return Slots[islot];
+		}
+
+		void Rehash(int minSlots)
+		{
+			std::size_t nslots = 16;
+			while (nslots < static_cast<std::size_t>(minSlots))
+			{
+				nslots *= 2;
+			}
+
+			std::vector<Slot> old(nslots);
+			old.swap(Slots);
+			for (auto itSlot = old.begin(); itSlot != old.end(); ++itSlot)
+			{
+				if (itSlot->Index >= 0)
+				{
+					Find(itSlot->EntityId) = *itSlot;
+				}
+			}
+		}
+
+		std::vector<Slot> Slots;
+		int Count;
+	};
+}
@@ -0,0 +1,225 @@
+#include "farfield.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace demoteam
+{
+	namespace
+	{
+		//***************************************************************************************************************
+		unsigned long long ParentKey(const FarFieldNode& node)
+		{
+			return (static_cast<unsigned long long>(node.Cell[0] >> 1) << 42) |
+				(static_cast<unsigned long long>(node.Cell[1] >> 1) << 21) |
+				static_cast<unsigned long long>(node.Cell[2] >> 1);
+		}
+
+		//***************************************************************************************************************
+		float SqrDistanceToFarCorner(const Aabb3& box, TFloat4Arg pos)
+		{
+			auto toMin = pos - box.LeftBottomBack;
+			auto toMax = box.RightTopFront - pos;
+			return sqr(std::max(fabsf(toMin.X()), fabsf(toMax.X()))) +
+				sqr(std::max(fabsf(toMin.Y()), fabsf(toMax.Y()))) +
+				sqr(std::max(fabsf(toMin.Z()), fabsf(toMax.Z())));
+		}
+
+		//***************************************************************************************************************
+		void AddToSums(FarFieldSums& sums, int count, TFloat4Arg position, TFloat4Arg velocity)
+		{
+			sums.Count += count;
+			sums.SumPosition = sums.SumPosition + position * static_cast<float>(count);
+			sums.SumVelocity = sums.SumVelocity + velocity * static_cast<float>(count);
+		}
+	}
+
+	//***************************************************************************************************************
+	FarFieldTree::FarFieldTree() : Layout(g_defaultGridLayout), NumLevels(0)
+	{
+		Policy.Range = 0.0f;
+		Policy.Theta = 0.0f;
+		std::fill(Nodes, Nodes + MaxLevels, static_cast<FarFieldNode*>(nullptr));
+		std::fill(LevelSizes, LevelSizes + MaxLevels, 0);
+	}
+
+	//***************************************************************************************************************
+	Aabb3 FarFieldTree::CellBox(int level, const FarFieldNode& node) const
+	{
+		float size = CellSize(level);
+		Float4 lbb(node.Cell[0] * size - Layout.HalfExtent, node.Cell[1] * size - Layout.HalfExtent, node.Cell[2] * size - Layout.HalfExtent);
+		return Aabb3(lbb, lbb + one3<Float4>() * size);
+	}
+
+	//***************************************************************************************************************
+	void FarFieldTree::Build(const TBuckets& buckets, const WorldSnapshot& world, const FarFieldPolicy& policy, ScratchArena& arena, const GridLayout& layout)
+	{
+		Policy = policy;
+		Layout = layout;
+		NumLevels = 0;
+
+		int nbuckets = buckets.size();
+		if (nbuckets == 0)
+		{
+			return;
+		}
+
+		// the grid's own cells; positions are summed relative to the cell, so the floats keep their precision
+		auto leaves = static_cast<FarFieldNode*>(arena.Allocate(sizeof(FarFieldNode) * nbuckets, alignof(FarFieldNode)));
+		for (int ibuck = 0; ibuck < nbuckets; ++ibuck)
+		{
+			auto& buck = *buckets[ibuck];
+			auto& node = leaves[ibuck];
+			auto& lbb = buck.Box.LeftBottomBack;
+			node.Cell[0] = static_cast<unsigned int>(floorf((lbb.X() + Layout.HalfExtent) / Layout.CellSize + 0.5f));
+			node.Cell[1] = static_cast<unsigned int>(floorf((lbb.Y() + Layout.HalfExtent) / Layout.CellSize + 0.5f));
+			node.Cell[2] = static_cast<unsigned int>(floorf((lbb.Z() + Layout.HalfExtent) / Layout.CellSize + 0.5f));
+
+			Float4 sumRelative = zero3<Float4>();
+			Float4 sumVelocity = zero3<Float4>();
+			int count = 0;
+			for (auto itEnt = buck.Entities.begin(); itEnt != buck.Entities.end(); ++itEnt, ++count)
+			{
+				auto& transform = world.Transforms[itEnt->second];
+				sumRelative = sumRelative + (transform.Local - lbb);
+				sumVelocity = sumVelocity + transform.Velocity;
+			}
+			node.Count = count;
+			node.CentreOfMass = lbb + sumRelative * (1.0f / count);
+			node.MeanVelocity = sumVelocity * (1.0f / count);
+			node.FirstChild = 0;
+			node.NumChildren = 0;
+			node.Bucket = &buck;
+		}
+		Nodes[0] = leaves;
+		LevelSizes[0] = nbuckets;
+		NumLevels = 1;
+
+		// each level up merges runs of siblings, which sorting on the parent's cell makes contiguous
+		while (NumLevels < MaxLevels && LevelSizes[NumLevels - 1] > 1)
+		{
+			auto children = Nodes[NumLevels - 1];
+			int nchildren = LevelSizes[NumLevels - 1];
+			std::sort(children, children + nchildren, [](const FarFieldNode& a, const FarFieldNode& b) { return ParentKey(a) < ParentKey(b); });
+
+			int nparents = 1;
+			for (int ichild = 1; ichild < nchildren; ++ichild)
+			{
+				nparents += ParentKey(children[ichild]) != ParentKey(children[ichild - 1]) ? 1 : 0;
+			}
+
+			auto parents = static_cast<FarFieldNode*>(arena.Allocate(sizeof(FarFieldNode) * nparents, alignof(FarFieldNode)));
+			int iparent = -1;
+			for (int ichild = 0; ichild < nchildren; ++ichild)
+			{
+				auto& child = children[ichild];
+				if (ichild == 0 || ParentKey(child) != ParentKey(children[ichild - 1]))
+				{
+					auto& parent = parents[++iparent];
+					parent.Cell[0] = child.Cell[0] >> 1;
+					parent.Cell[1] = child.Cell[1] >> 1;
+					parent.Cell[2] = child.Cell[2] >> 1;
+					parent.Count = 0;
+					parent.CentreOfMass = zero3<Float4>();
+					parent.MeanVelocity = zero3<Float4>();
+					parent.FirstChild = ichild;
+					parent.NumChildren = 0;
+					parent.Bucket = nullptr;
+				}
+
+				// running weighted means, rather than sums of absolute positions
+				auto& parent = parents[iparent];
+				float weight = static_cast<float>(child.Count) / (parent.Count + child.Count);
+				parent.CentreOfMass = parent.CentreOfMass + (child.CentreOfMass - parent.CentreOfMass) * weight;
+				parent.MeanVelocity = parent.MeanVelocity + (child.MeanVelocity - parent.MeanVelocity) * weight;
+				parent.Count += child.Count;
+				++parent.NumChildren;
+			}
+
+			Nodes[NumLevels] = parents;
+			LevelSizes[NumLevels] = nparents;
+			++NumLevels;
+		}
+	}
+
+	//***************************************************************************************************************
+	FarFieldSums FarFieldTree::Query(TFloat4Arg pos, TFloat4Arg forward, float nearRange, const WorldSnapshot& world) const
+	{
+		FarFieldSums sums;
+		if (NumLevels == 0 || Policy.Range <= nearRange)
+		{
+			return sums;
+		}
+
+		const float nearSqr = sqr(nearRange);
+		const float farSqr = sqr(Policy.Range);
+		const float thetaSqr = sqr(Policy.Theta);
+
+		// an opened node pushes at most 8 children, and there are only so many levels
+		struct StackEntry
+		{
+			int Level;
+			int Index;
+		};
+		StackEntry stack[8 * MaxLevels + 1];
+
+		int top = NumLevels - 1;
+		for (int iroot = 0; iroot < LevelSizes[top]; ++iroot)
+		{
+			int nstack = 0;
+			StackEntry root = { top, iroot };
+			stack[nstack++] = root;
+
+			while (nstack > 0)
+			{
+				auto entry = stack[--nstack];
+				auto& node = Nodes[entry.Level][entry.Index];
+
+				auto box = CellBox(entry.Level, node);
+				float boxSqr = sqrDistanceToBox(box, pos);
+				if (boxSqr >= farSqr)
+				{
+					continue;
+				}
+
+				// clear of the near field, which goes up to SearchRange inclusive, and small enough from here: the group as
+				// one. A bigger cell across the edge of the range gets opened, or a centre of mass just outside it would
+				// drop every bird inside; a grid cell goes on its centre of mass
+				auto toCentre = node.CentreOfMass - pos;
+				float centreSqr = sqrMag(toCentre);
+				bool withinRange = entry.Level == 0 ? centreSqr < farSqr : SqrDistanceToFarCorner(box, pos) < farSqr;
+				if (boxSqr > nearSqr && sqr(CellSize(entry.Level)) < thetaSqr * centreSqr && (withinRange || entry.Level == 0))
+				{
+					if (withinRange && dot(toCentre, forward) >= 0.0f)
+					{
+						AddToSums(sums, node.Count, node.CentreOfMass, node.MeanVelocity);
+					}
+					continue;
+				}
+
+				if (entry.Level == 0)
+				{
+					auto& entities = node.Bucket->Entities;
+					for (auto itEnt = entities.begin(); itEnt != entities.end(); ++itEnt)
+					{
+						auto& transform = world.Transforms[itEnt->second];
+						auto lineTo = transform.Local - pos;
+						float distSqr = sqrMag(lineTo);
+						if (distSqr > nearSqr && distSqr < farSqr && dot(lineTo, forward) >= 0.0f)
+						{
+							AddToSums(sums, 1, transform.Local, transform.Velocity);
+						}
+					}
+					continue;
+				}
+
+				for (int ichild = 0; ichild < node.NumChildren; ++ichild)
+				{
+					StackEntry child = { entry.Level - 1, node.FirstChild + ichild };
+					stack[nstack++] = child;
+				}
+			}
+		}
+		return sums;
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "flocking.h"
+#include "framearena.h"
+#include "spatialgrid.h"
+
+namespace demoteam
+{
+	//------------------------------------------
+	struct FarFieldPolicy
+	{
+		float Range;		// attraction and follow reach this far, beyond each bird's SearchRange (0 = off)
+		float Theta;		// a group is taken as a whole once its cell size over its distance is below this
+	};
+
+	//------------------------------------------
+	// what the far field adds to a bird's attraction and follow averages
+	struct FarFieldSums
+	{
+		FarFieldSums() : Count(0), SumPosition(zero3<Float4>()), SumVelocity(zero3<Float4>()) {}
+		int Count;
+		Float4 SumPosition;
+		Float4 SumVelocity;
+	};
+
+	//------------------------------------------
+	// one cell of one level; level 0 is the grid's own buckets, each level up is cells twice the size
+	struct FarFieldNode
+	{
+		unsigned int Cell[3];	// at this level
+		int Count;
+		Float4 CentreOfMass;
+		Float4 MeanVelocity;
+		int FirstChild;			// into the level below, children are contiguous
+		int NumChildren;
+		const SpatialBucket* Bucket;	// level 0 only
+	};
+
+	//------------------------------------------
+	// Barnes-Hut over the grid: per-cell counts, centres of mass and mean velocities, summed up a stack of coarser
+	// levels at build time. A query walks down from the top and takes any cell far enough away, relative to its size,
+	// as one heavy bird; cells that are too close, or that cross the edge of the range, get opened, down to the
+	// individual birds in the grid's buckets. Everything lives in the frame arena alongside the grid.
+	// It widens what a bird reacts to rather than making the neighbour search cheaper: every query is a walk of its own
+	// on top of that search, and the *_farfield_* benchmark rows show what it adds.
+	class FarFieldTree
+	{
+	public:
+		enum { MaxLevels = 9 };	// 8m * 2^8 covers the default grid; finer ones just have more than one top node
+
+		FarFieldTree();
+
+		// layout has to be the one the grid was built with
+		void Build(const TBuckets& buckets, const WorldSnapshot& world, const FarFieldPolicy& policy, ScratchArena& arena, const GridLayout& layout = g_defaultGridLayout);
+		bool IsBuilt() const { return NumLevels > 0; }
+
+		// everything between nearRange (which the exact neighbour search covers) and the policy's Range, that's in
+		// front of forward; an approximation whenever Theta > 0
+		FarFieldSums Query(TFloat4Arg pos, TFloat4Arg forward, float nearRange, const WorldSnapshot& world) const;
+
+		int NumNodes(int level) const { return LevelSizes[level]; }
+		int Levels() const { return NumLevels; }
+
+	private:
+		float CellSize(int level) const { return Layout.CellSize * static_cast<float>(1 << level); }
+		Aabb3 CellBox(int level, const FarFieldNode& node) const;
+
+		FarFieldPolicy Policy;
+		GridLayout Layout;
+		FarFieldNode* Nodes[MaxLevels];
+		int LevelSizes[MaxLevels];
+		int NumLevels;
+	};
+}
@@ -0,0 +1,84 @@
+#include "flockerset.h"
+
+namespace demoteam
+{
+	//***************************************************************************************************************
+	bool FlockerSet::Add(TEntityId entityId)
+	{
+		if (Contains(entityId))
+		{
+			return false;
+		}
+
+		int slot;
+		if (FreeSlots.empty())
+		{
+			slot = SlotToDense.size();
+			SlotToDense.push_back(InvalidSlot);
+		}
+		else
+		{
+			slot = FreeSlots.back();
+			FreeSlots.pop_back();
+		}
+
+		SlotToDense[slot] = DenseIds.size();
+		DenseIds.push_back(entityId);
+		DenseSlots.push_back(slot);
+		IdToSlot.insert(std::make_pair(entityId, slot));
+		return true;
+	}
+
+	//***************************************************************************************************************
+	bool FlockerSet::Remove(TEntityId entityId)
+	{
+		auto itSlot = IdToSlot.find(entityId);
+		if (itSlot == IdToSlot.end())
+		{
+			return false;
+		}
+
+		int slot = itSlot->second;
+		int idense = SlotToDense[slot];
+		int ilast = DenseIds.size() - 1;
+
+		// move the last one into the hole; its slot stays the same, only its dense index changes
+		DenseIds[idense] = DenseIds[ilast];
+		DenseSlots[idense] = DenseSlots[ilast];
+		SlotToDense[DenseSlots[idense]] = idense;
+
+		DenseIds.pop_back();
+		DenseSlots.pop_back();
+
+		SlotToDense[slot] = InvalidSlot;
+		FreeSlots.push_back(slot);
+		IdToSlot.erase(itSlot);
+		return true;
+	}
+
+	//***************************************************************************************************************
+	int FlockerSet::SlotOf(TEntityId entityId) const
+	{
+		auto itSlot = IdToSlot.find(entityId);
+		return itSlot != IdToSlot.end() ? itSlot->second : InvalidSlot;
+	}
+
+	//***************************************************************************************************************
+	void FlockerSet::Reserve(int n)
+	{
+		DenseIds.reserve(n);
+		DenseSlots.reserve(n);
+		SlotToDense.reserve(n);
+		IdToSlot.reserve(n);
+	}
+
+	//***************************************************************************************************************
+	void FlockerSet::Clear()
+	{
+		DenseIds.clear();
+		DenseSlots.clear();
+		SlotToDense.clear();
+		FreeSlots.clear();
+		IdToSlot.clear();
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace demoteam
+{
+	//------------------------------------------
+	// The entities we are authoritative over. Add/Remove are O(1): the dense list (what we iterate)
+	// is kept packed with swap-remove, and each entity also owns a slot that does not move for as
+	// long as it is in the set, for per-flocker storage that must survive other entities leaving.
+	class FlockerSet
+	{
+	public:
+		typedef std::int64_t TEntityId;
+		enum { InvalidSlot = -1 };
+
+		// false if it was already in the set
+		bool Add(TEntityId entityId);
+		// false if it wasn't in the set
+		bool Remove(TEntityId entityId);
+
+		bool Contains(TEntityId entityId) const { return IdToSlot.find(entityId) != IdToSlot.end(); }
+		int SlotOf(TEntityId entityId) const;
+
+		int Size() const { return DenseIds.size(); }
+		TEntityId IdAt(int idense) const { return DenseIds[idense]; }
+		int SlotAt(int idense) const { return DenseSlots[idense]; }
+		const std::vector<TEntityId>& Ids() const { return DenseIds; }
+
+		// per-slot storage needs to be at least this big
+		int SlotCapacity() const { return SlotToDense.size(); }
+
+		void Reserve(int n);
+		void Clear();
+
+	private:
+		std::vector<TEntityId> DenseIds;
+		std::vector<int> DenseSlots;
+		std::vector<int> SlotToDense;
+		std::vector<int> FreeSlots;
+		std::unordered_map<TEntityId, int> IdToSlot;
+	};
+}
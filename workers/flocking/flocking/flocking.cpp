@@ -7,23 +7,28 @@
 #include <iostream>
 #include <string>
 #include <thread>
-#include <list>
 #include <algorithm>
-#define _USE_MATH_DEFINES
-#include <math.h>
+#include <atomic>
 
 #include <improbable/worker.h>
 
 #include "Maths.h"
 
 #include "demoteam/flock.h"
+#include "demoteam/flock_output.h"
+#include "demoteam/flock_stats.h"
+#include "demoteam/player.h"
 #include "demoteam/transform.h"
-#include <atomic>
 
+#include "autotune.h"
+#include "config.h"
 #include "flocking.h"
-#include "Geometry.h"
-
-#define USE_PARTITIONING
+#include "geometry.h"
+#include "frameclock.h"
+#include "logging.h"
+#include "recording.h"
+#include "simulation.h"
+#include "tracing.h"
 
 using namespace improbable::math;
 using namespace demoteam;
@@ -32,12 +37,8 @@ using namespace geometry;
 namespace
 {
 	const std::string kWorkerType = "FlockingWorker";
-	const int g_targetFPS = 8;
-	const float g_secondsPerFrame = 1.0f / g_targetFPS;
-	const long long g_millisecondsPerFrame = 1000LL * g_secondsPerFrame;
 	const long long g_millisecondsBetweenMetrics = 1000LL;
-	const int g_maxNeighbours = 32;
-	const int g_numThreads = 8;
+	const logging::LogLimits g_logLimits = { 1000, 2, 0 };
 
 	enum ExecutionState
 	{
@@ -46,646 +47,392 @@ namespace
 		Quitting
 	};
 	std::atomic_int g_ExecutionState(NotRunning);
-	
-	typedef std::pair<worker::EntityId, int> TEntityStorage;
-	typedef std::list<TEntityStorage> TEntities;
 
-	//------------------------------------------
-	struct SpatialBucket
-	{
-		SpatialBucket(int gridIdx, const Aabb3& box, worker::EntityId entId, int entIdx) : Box(box), GridIndex(gridIdx), IntersectionHelper(box, 18.0f)
-		{
-			Entities.push_back(std::make_pair(entId, entIdx));
-		}
-		TEntities Entities;
-		Aabb3 Box;
-		CubeSphereIntersection IntersectionHelper;
-		int GridIndex;
-	};
-	typedef std::vector<std::shared_ptr<SpatialBucket> > TBuckets;
-	
-	//------------------------------------------
-	struct NeighbourData
-	{
-		NeighbourData() : Transform(zero3<Coordinates>(), unitZ3<Vector3f>(), zero3<Vector3f>()) {}
-		NeighbourData(const worker::EntityId& entityId, const TransformData& tr, float distSqr) : EntityId(entityId), Transform(tr), DistanceSqr(distSqr) {}
-		worker::EntityId EntityId;
-		TransformData Transform;
-		float DistanceSqr;
-	};
-	
 	//***************************************************************************************************************
-	int GetFurthestNeighbour(const NeighbourData* closestBuffer, int nclosest)
-	{
-		int ifurthest = 0;
-
-		for (int c0 = 1; c0 < nclosest; ++c0)
-		{
-			ifurthest = closestBuffer[c0].DistanceSqr > closestBuffer[ifurthest].DistanceSqr ? c0 : ifurthest;
-		}
-
-		return ifurthest;
-	}
-
-	typedef std::vector<worker::EntityId> TFlockers;
-	typedef std::vector<const TransformData*> TTransformCache;
-
-	struct SUpdateUpdate
-	{
-		SUpdateUpdate() : pos(Coordinates(0, 0, 0)), facing(0, 0, 1), velocity(0, 0, 0) {}
-		Coordinates pos;
-		Vector3f facing;
-		Vector3f velocity;
-	};
-	typedef std::vector<worker::EntityId> TFlockers;
-	typedef std::vector<SUpdateUpdate> TFlockersUpdate;
-}
-
-//***************************************************************************************************************
-Vector3f CalculateSteeringVector(
-	const TransformData& transform, 
-	const FlockingData& params, 
-	const NeighbourData* closestBuffer, 
-	int nclosest)
-{
-	Vector3f averagePos = zero3<Vector3f>();
-	Vector3f averageVel = zero3<Vector3f>();
-	Vector3f deltaSepSum = zero3<Vector3f>();
-
-	float oneOnN = nclosest>0 ? (1.0f / nclosest) : 0.0f;
-
-	auto calculateDeltaSep = [params](TVector3fArg lineAway)
+	FlockParams ToFlockParams(const FlockingData& data)
 	{
-		float separationK = ln2 / sqr(params.repel_separation_for_half());
-		float mag = expf(-separationK*sqrMag(lineAway));
-		return normalize(lineAway)*mag;
-	};
-
-	for (int c0 = 0; c0 < nclosest; ++c0)
-	{
-		auto dat = closestBuffer[c0];
-		auto neighbourTransform = dat.Transform;
-		
-		averagePos = averagePos + toVector3f(neighbourTransform.position())*oneOnN;
-		averageVel = averageVel + neighbourTransform.velocity()*oneOnN;
-		
-		Vector3f lineAway = transform.position() - neighbourTransform.position();
-		auto deltaSep = sqrMag(lineAway) > epsilon ? 
-			calculateDeltaSep(lineAway) : 
-			zero3<Vector3f>();
-
-		deltaSepSum = deltaSepSum + deltaSep;
+		FlockParams params;
+		params.AttractCoefficient = data.attract_coefficient();
+		params.FollowCoefficient = data.follow_coefficient();
+		params.RepelCoefficient = data.repel_coefficient();
+		params.RepelSeparationForHalf = data.repel_separation_for_half();
+		params.SearchRange = data.search_range();
+		params.NumberToConsider = data.number_to_consider();
+		params.Speed = data.speed();
+		params.Drag = data.drag();
+		params.VelocitySpring = data.velocity_spring();
+		params.VerticalConfinementCoefficient = data.vertical_confinement_coefficient();
+		params.MaxTurnDegreesPerSecond = data.max_turn_degrees_per_second();
+		return params;
 	}
 
-	auto deltaPos = (averagePos - toVector3f(transform.position()));
-	auto deltaVel = (averageVel - transform.velocity());
-
-	return	deltaPos*params.attract_coefficient() +
-			deltaVel*params.follow_coefficient() +
-			deltaSepSum*params.repel_coefficient();
-}
-
-//***************************************************************************************************************
-TVector3fRet KeepAtGoodHeight(const TransformData& transform, TVector3fArg steeringVector)
-{
-	auto height = dot(toVector3f(transform.position()), unitY3<Vector3f>());
-	
-	auto shouldInvertY = [height, steeringVector]()
-	{
-		const float minHeight = 10.0f;
-		const float maxHeight = 30.0f;
-		return ((height<minHeight && steeringVector.Y() < 0.0f) || (height > maxHeight && steeringVector.Y()>0.0f));
-	};
-	auto invertY = [](TVector3fArg steeringVector)
-	{
-		return steeringVector - 2 * steeringVector*unitY3<Vector3f>();
-	};
-
-	return shouldInvertY() ? invertY(steeringVector) : steeringVector;
-
-}
-
-//***************************************************************************************************************
-TVector3fRet KeepNearOrigin(const TransformData& transform, TVector3fArg steeringVector)
-{
-	const float maxDistance = 192.0f;
-	auto toOrigin = zero3<Vector3f>() - toVector3f(transform.position());
-	auto sqrDist = sqrMag(toOrigin);
-	return steeringVector + (sqrDist > epsilon ? normalize(toOrigin)*powf(sqrDist / sqr(maxDistance), 16.0f) : zero3<Vector3f>());
-}
-
-namespace
-{
-	const unsigned int maxBitsX = 11;
-	const unsigned int maxBitsY = 10;
-	const unsigned int maxBitsZ = 11;
-}
-
-unsigned int calcGridIndex(TVector3fArg pos, const Aabb3& worldExtents, float gridSize)
-{
-	auto maxIndices = (worldExtents.RightTopFront - worldExtents.LeftBottomBack)/gridSize;
-
-	Vector3f gridIndices = (pos - worldExtents.LeftBottomBack)/gridSize;
-
-	unsigned int idX = gridIndices.X();
-	unsigned int idY = gridIndices.Y();
-	unsigned int idZ = gridIndices.Z();
-
-	return idX + (idY << maxBitsX) + (idZ << (maxBitsX + maxBitsY));
-}
-
-Aabb3 gridIndexToBox(unsigned int gridIndex, const Aabb3& worldExtents, float gridSize)
-{
-	unsigned int maskX = (1 << maxBitsX) - 1;
-	unsigned int maskY = (1 << maxBitsY) - 1;
-	unsigned int maskZ = (1 << maxBitsZ) - 1;
-	unsigned int offsetX = 0;
-	unsigned int offsetY = offsetX+maxBitsX;
-	unsigned int offsetZ = offsetY+maxBitsY;
-	unsigned int idX = (gridIndex >> offsetX)&maskX;
-	unsigned int idY = (gridIndex >> offsetY)&maskY;
-	unsigned int idZ = (gridIndex >> offsetZ)&maskZ;
-
-	return Aabb3(worldExtents.LeftBottomBack + Vector3f(idX, idY, idZ)*gridSize, worldExtents.LeftBottomBack + Vector3f(idX + 1, idY + 1, idZ + 1)*gridSize);
-}
-
-void BuildSpatialGrid(TBuckets& buckets, const worker::View& view)
-{
-	float len = 1000.0f;
-	Aabb3 worldExtents(Vector3f(-len,-len,-len), Vector3f(len, len, len));
-	float gridSize = 8.0f;
-
-	auto itBegin = view.Entities.begin();
-	auto itEnd = view.Entities.end();
-
-	int nent = 0;
-	
-	// spatial partitioning test
-	for (auto itEnt = itBegin; itEnt != itEnd; ++itEnt)
+	//***************************************************************************************************************
+	// false if there's nothing in it for Transform
+	bool ToTransformUpdate(const FlockTransformUpdate& update, Transform::Update& updTransform)
 	{
-		auto transform = itEnt->second.Get<Transform>();
-		auto gridIdx = calcGridIndex(toVector3f(transform->position()), worldExtents, gridSize);
-
-		auto itBuck = std::find_if(buckets.begin(), buckets.end(), [gridIdx](const std::shared_ptr<SpatialBucket>& bucket) { return bucket->GridIndex == gridIdx;  });
-		if (itBuck == buckets.end())
+		if (update.HasPosition)
 		{
-			// make a new one
-			auto box = gridIndexToBox(gridIdx, worldExtents, gridSize);
-			if (!boxContains(box, toVector3f(transform->position())))
-			{
-				printf("placed entity in a box that does not well describe its position :(\n");
-			}
-			buckets.push_back(std::shared_ptr<SpatialBucket>(new SpatialBucket(gridIdx, box, itEnt->first, nent)));
+			updTransform.set_position(update.Position);
 		}
-		else
+		if (update.HasForward)
 		{
-			auto& bucketPtr = *itBuck;
-			bucketPtr->Entities.push_back(std::make_pair(itEnt->first, nent));
+			updTransform.set_forward(update.Forward);
 		}
-		++nent;
-	}	
-}
-
-void forAllEntitiesWithinRadius(const TBuckets& spatialGrid, const TransformData*const* transformCache, const worker::View& view, const Sphere& sphere, std::function<void(worker::EntityId, TransformData)> func)
-{
-	int nentsTotal = 0;
-	int nentsBucket = 0;
-	int nentsRange = 0;
-
-	for (auto itGrid = spatialGrid.begin(); itGrid != spatialGrid.end(); ++itGrid)
-	{
-		auto& buck = *itGrid;
-		int nentsThisBucket = buck->Entities.size();
-		nentsTotal += nentsThisBucket;
-
-		if(buck->IntersectionHelper.IntersectionAt(sphere.Origin))
+		if (update.HasVelocity)
 		{
-			nentsBucket += nentsThisBucket;
-
-			auto itEntEnd = buck->Entities.end();
-			for (auto itEnt = buck->Entities.begin(); itEnt != itEntEnd; ++itEnt)
-			{
-				auto& ent = *itEnt;
-				auto transform = transformCache[ent.second];
-
-				if (transform != nullptr && sphereContains(sphere, toVector3f(transform->position())))
-				{
-					++nentsRange;
-					func(ent.first, *transform);
-				}
-			}
+			updTransform.set_velocity(update.Velocity);
 		}
+		return update.HasPosition || update.HasForward || update.HasVelocity;
 	}
-}
-//***************************************************************************************************************
-int CountEntitiesWithinLinearSearch(const worker::View& view, const TransformData*const* transformCache, const worker::EntityId& flockerId, TVector3fArg pos, float r)
-{
-	auto itBegin = view.Entities.begin();
-	auto itEnd = view.Entities.end();
-	int nentitiesLinear = 0;
-
-	int ient = -1;
-	for (auto itEnt = itBegin;
-	itEnt != itEnd;
-		++itEnt)
+
+	//***************************************************************************************************************
+	// false if there's nothing in it for FlockOutput
+	bool ToFlockOutputUpdate(const FlockTransformUpdate& update, FlockOutput::Update& updOutput)
 	{
-		auto neighbourTransform = transformCache[++ient];
-		if (neighbourTransform != nullptr && itEnt->first != flockerId && sqrMag(toVector3f(neighbourTransform->position()) - pos) < sqr(r))
+		if (update.HasTargetVelocity)
 		{
-			++nentitiesLinear;
+			updOutput.set_target_velocity(update.TargetVelocity);
 		}
+		return update.HasTargetVelocity;
 	}
 
-	return nentitiesLinear;
-}
-
-//***************************************************************************************************************
-void UpdateFlocking(
-	TFlockers& flockers, 
-	TFlockersUpdate& flockersUpdate,
-	const TTransformCache& transformCacheStorage,
-	const TBuckets& spatialGrid,
-	int ibegin,
-	int iend,
-	const worker::View& view, 
-	worker::Connection& connection, 
-	const float timeStep)
-{
-	auto updateComponent = [&connection, &view, timeStep](
-			const worker::EntityId& entityId, 
-			const worker::Option<TransformData>& transform, 
-			const worker::Option<FlockingData>& params,
-			const NeighbourData* closestNeighbours,
-			int numClosest,
-			SUpdateUpdate& targetUpdate
-		)
+	//------------------------------------------
+	// hosts the simulation on a SpatialOS connection
+	class WorkerHost : public IFlockingHost
 	{
-		Vector3f steeringVector = CalculateSteeringVector(	*transform,
-															*params, 
-															closestNeighbours, 
-															numClosest);
-
-		steeringVector = KeepNearOrigin(*transform, steeringVector);
-		steeringVector = KeepAtGoodHeight(*transform, steeringVector);
-									
-		// rotate forward
-		auto newFwd = transform->forward();
-		if (sqrMag(steeringVector) > epsilon)
-		{	
-			const float maxAngle = toRadians(params->max_turn_degrees_per_second());
-
-			auto targetFacing = normalize(steeringVector);
-			auto cosAng = dot(newFwd, targetFacing);
-			auto ang = acosf(std::max(std::min(cosAng, 1.0f), -1.0f));
-			auto ey = cross(newFwd, targetFacing);
-			if (!isZero(ey, epsilon))
+	public:
+		// recorder and warmStart are optional; whatever the simulation reads from the view goes to the recorder as
+		// well, and the warm start fills in whatever the view doesn't have yet
+		WorkerHost(worker::Connection& connection, FlockingSimulation& sim, bool trackPlayers, WorldRecorder* recorder, WarmStart* warmStart) :
+			Connection(connection), Sim(sim), Timers(sim.Timers()), TrackPlayers(trackPlayers), Recorder(recorder), Warm(warmStart)
+		{
+			View.OnAuthorityChange<Transform>([&sim, recorder, warmStart](const worker::AuthorityChangeOp& op)
 			{
-				auto ez = newFwd;
-				auto ex = cross(normalize(ey), ez);
-				auto angLimited = std::min(ang, maxAngle);
-				newFwd = normalize(ez*cosf(angLimited) + ex*sinf(angLimited));
-			}
-		}
-
-		Vector3f newVel = newFwd*params->speed();
-		auto newPos = transform->position() + newVel*timeStep;
-		
-		targetUpdate.pos = newPos;
-		targetUpdate.facing = newFwd;
-		targetUpdate.velocity = newVel;
-	};
-			
-	auto itBegin = view.Entities.begin();
-	auto itEnd = view.Entities.end();
-	
-	NeighbourData closestNeighboursStore[g_maxNeighbours];
-	NeighbourData* closestNeighbours = closestNeighboursStore;
-
-	const TransformData*const * transformCache = &transformCacheStorage[0];
-
-	int nNeighbours;
-	int ifurthest = 0;
+				if (op.HasAuthority)
+				{
+					sim.OnAuthorityGained(op.EntityId);
+					if (warmStart != nullptr) warmStart->AuthorityGained(op.EntityId, sim);
+					if (recorder != nullptr) recorder->AuthorityGained(op.EntityId);
+				}
+				else
+				{
+					sim.OnAuthorityLost(op.EntityId);
+					if (warmStart != nullptr) warmStart->AuthorityLost(op.EntityId);
+					if (recorder != nullptr) recorder->AuthorityLost(op.EntityId);
+				}
+			});
 
-	int niters = 0;
+			View.OnRemoveEntity([&sim, recorder, warmStart](const worker::RemoveEntityOp& op)
+			{
+				sim.OnEntityRemoved(op.EntityId);
+				if (warmStart != nullptr) warmStart->EntityRemoved(op.EntityId);
+				if (recorder != nullptr) recorder->EntityRemoved(op.EntityId);
+			});
+		}
 
-	for (int idelegate = ibegin; idelegate < iend; ++idelegate)
-	{
-		auto flockerId = flockers[idelegate];
-		auto itEnt = view.Entities.find(flockerId);
-		if (itEnt == itEnd)
+		// ops that arrive while we wait for the next tick; only applied on frame boundaries, when the world is read
+		void WaitForOps(long long timeoutMilliseconds)
 		{
-			connection.SendLogMessage(worker::LogLevel::WARN, "flockingWorker", "delegation for unknown entity [" + std::to_string(flockerId) + "]");
-			continue;
+			PendingOps.push_back(Connection.GetOpList(static_cast<std::uint32_t>(timeoutMilliseconds), 0));
 		}
-		
-		int nitersLocal = 0;
-
-		auto ent = itEnt->second;
-		auto& paramsOption = ent.Get<Flock>();
-		auto& transformOption = ent.Get<Transform>();
-		nNeighbours = 0;
-		if (!transformOption.empty() && !paramsOption.empty())
+
+		virtual void ReadWorld(WorldSnapshot& world)
 		{
-			const FlockingData& params = *paramsOption;
-			const TransformData& transform = *transformOption;
-
-			auto sqrDist = [transform](const TransformData& neighbourTransform) {
-				return sqrMag(neighbourTransform.position() - transform.position());
-			};
-			auto writeClosestNeighbours = [transform, params, &nNeighbours, closestNeighbours, &ifurthest, sqrDist](const worker::EntityId& neighbourId, const TransformData& neighbourTransform) {
-				if (ShouldConsiderEntity(transform,
-					neighbourTransform,
-					params.search_range()))
+			{
+				ScopedTimer timer(Timers.Phase(OpProcessing));
+				tracing::Scope trace("ProcessOps", PendingOps.size() + 1);
+				PendingOps.push_back(Connection.GetOpList(0, 0));
+				for (auto itOps = PendingOps.begin(); itOps != PendingOps.end(); ++itOps)
 				{
-					if (nNeighbours < params.number_to_consider())
-					{
-						int idx = nNeighbours++;
-
-						closestNeighbours[idx] =
-							NeighbourData(neighbourId, neighbourTransform, sqrDist(neighbourTransform));
-
-						ifurthest =
-							closestNeighbours[idx].DistanceSqr >
-							closestNeighbours[ifurthest].DistanceSqr ?
-							idx :
-							ifurthest;
-					}
-					else if (sqrDist(neighbourTransform)<closestNeighbours[ifurthest].DistanceSqr)
-					{
-						closestNeighbours[ifurthest] =
-							NeighbourData(neighbourId, neighbourTransform, sqrDist(neighbourTransform));
-
-						// recalculate the furthest
-						ifurthest = GetFurthestNeighbour(closestNeighbours, nNeighbours);
-					}
+					View.Process(*itOps);
 				}
-			};
-#ifdef USE_PARTITIONING
-
-#ifdef DEBUG_PARTITIONING
-			int nentitiesLinear = CountEntitiesWithinLinearSearch(view, transformCache, flockerId, toVector3f(transform.position()), params.search_range());
-#endif //DEBUG_PARTITIONING
-			
-			Sphere sphere = { toVector3f(transform.position()), params.search_range() };
-			forAllEntitiesWithinRadius(spatialGrid, transformCache, view, sphere, [flockerId, &nitersLocal, &writeClosestNeighbours](const worker::EntityId& neighbourId, const TransformData& neighbourTransform)
+				PendingOps.clear();
+			}
+
+			// single thread
+			// copy the transforms out once because Entity::Get<Transform> is crazy expensize!
+			ScopedTimer timer(Timers.Phase(CacheRefresh));
+			tracing::Scope trace("ReadView");
+			world.Reserve(View.Entities.size());
+			auto itEnd = View.Entities.end();
+			for (auto itEnt = View.Entities.begin(); itEnt != itEnd; ++itEnt)
 			{
-				if (neighbourId != flockerId)
+				auto& transformOption = itEnt->second.Get<Transform>(); // expensive!
+				if (transformOption.empty())
 				{
-					++nitersLocal;
-					writeClosestNeighbours(neighbourId, neighbourTransform);
+					continue;
 				}
-			});
 
-#ifdef DEBUG_PARTITIONING
-			assert(nentitiesLinear == nitersLocal);
-			if (nentitiesLinear != nitersLocal)
+				FlockTransform transform(transformOption->position(), transformOption->forward(), transformOption->velocity());
+				auto& paramsOption = itEnt->second.Get<Flock>();
+				if (paramsOption.empty())
+				{
+					world.Add(itEnt->first, transform, nullptr);
+				}
+				else
+				{
+					auto params = ToFlockParams(*paramsOption);
+					world.Add(itEnt->first, transform, &params);
+				}
+
+				if (TrackPlayers && !itEnt->second.Get<Player>().empty())
+				{
+					world.Players.push_back(transform.Position);
+				}
+			}
+
+			if (Warm != nullptr)
 			{
-				printf("disparity! Spatial: %d; Actual %d\n", nitersLocal, nentitiesLinear);
+				Warm->FillIn(world, Sim);
 			}
-#endif //DEBUG_PARTITIONING
-#else
-			int ient = -1;
-			for (	auto itEnt = itBegin;
-					itEnt != itEnd;
-					++itEnt)
+			if (Recorder != nullptr)
 			{
-				auto neighbourTransform = transformCache[++ient];
-				if (neighbourTransform!=nullptr && itEnt->first != flockerId)
-				{
-					++nitersLocal;
-					writeClosestNeighbours(itEnt->first, *neighbourTransform);
-				}
+				Recorder->Frame(world);
 			}
-#endif //USE_PARTITIONING
+		}
 
-			niters += nitersLocal;
+		virtual void SendTransformUpdate(TEntityId entityId, const FlockTransformUpdate& update)
+		{
+			if (Warm != nullptr && !Warm->Updated(entityId, update))
+			{
+				return;
+			}
 
-			updateComponent(flockerId, transform, params, closestNeighbours, nNeighbours, flockersUpdate[idelegate]);
+			FlockOutput::Update updOutput;
+			if (ToFlockOutputUpdate(update, updOutput))
+			{
+				Connection.SendComponentUpdate<FlockOutput>(entityId, updOutput);
+			}
+			Transform::Update updTransform;
+			if (ToTransformUpdate(update, updTransform))
+			{
+				Connection.SendComponentUpdate<Transform>(entityId, updTransform);
+			}
 		}
-	}
-}
 
-//***************************************************************************************************************
-void Run(worker::Connection& connection)
-{ 
-	TFlockers flockers;
-	TFlockersUpdate flockersUpdate;
-
-	flockersUpdate.resize(2048);
-	worker::View view;
-	view.OnAuthorityChange<Transform>(
-		[&flockers, &flockersUpdate](const worker::AuthorityChangeOp& op)
+		// on the pool: the warm start only looks up its stand ins here, and each bird is only ever in one batch
+		virtual void PrepareTransformUpdates(int threadId, const PendingTransformUpdate* updates, int count)
 		{
-			if (op.HasAuthority)
+			auto& batch = Batches[threadId];
+			batch.Outputs.clear();
+			batch.Transforms.clear();
+			for (int iupdate = 0; iupdate < count; ++iupdate)
 			{
-				auto itFind = std::find(flockers.begin(), flockers.end(), op.EntityId);
-				if (itFind == flockers.end())
+				auto entityId = updates[iupdate].EntityId;
+				auto& update = updates[iupdate].Update;
+				if (Warm != nullptr && !Warm->Updated(entityId, update))
+				{
+					continue;
+				}
+
+				FlockOutput::Update updOutput;
+				if (ToFlockOutputUpdate(update, updOutput))
+				{
+					batch.Outputs.push_back(std::make_pair(entityId, updOutput));
+				}
+				Transform::Update updTransform;
+				if (ToTransformUpdate(update, updTransform))
 				{
-					flockers.push_back(op.EntityId);
+					batch.Transforms.push_back(std::make_pair(entityId, updTransform));
 				}
 			}
-			else
+		}
+
+		// sends what PrepareTransformUpdates made of them, which after the warm start filter may be fewer
+		virtual void SendPreparedTransformUpdates(int threadId, const PendingTransformUpdate* /*updates*/, int /*count*/)
+		{
+			auto& batch = Batches[threadId];
+			for (auto itOutput = batch.Outputs.begin(); itOutput != batch.Outputs.end(); ++itOutput)
 			{
-				flockers.erase(std::remove(flockers.begin(), flockers.end(), op.EntityId), flockers.end());
+				Connection.SendComponentUpdate<FlockOutput>(itOutput->first, itOutput->second);
 			}
-
-			if (flockers.size() > flockersUpdate.size())
+			for (auto itTransform = batch.Transforms.begin(); itTransform != batch.Transforms.end(); ++itTransform)
 			{
-				flockersUpdate.resize(flockers.size());
+				Connection.SendComponentUpdate<Transform>(itTransform->first, itTransform->second);
 			}
 		}
-	);
-	
-	view.OnRemoveEntity([&flockers](const worker::RemoveEntityOp& op)
+
+		// replaces what was there: the component only ever holds the latest period's summary
+		virtual void SendBirdStats(TEntityId entityId, const BirdStatsSummary& summary)
 		{
-			flockers.erase(std::remove(flockers.begin(), flockers.end(), op.EntityId), flockers.end());
+			if (Warm != nullptr && Warm->IsProvisional(entityId))
+			{
+				return;
+			}
+
+			worker::List<UpdateTimeEventData> latest;
+			latest.push_back(UpdateTimeEventData(entityId, summary.PeriodStart, summary.ComputeSeconds, summary.Steps, summary.Candidates, summary.PeriodSeconds));
+			FlockStats::Update updStats;
+			updStats.set_entity_update_time(latest);
+			Connection.SendComponentUpdate<FlockStats>(entityId, updStats);
 		}
-	);
-	
-	auto nextUpdate = std::chrono::system_clock::now();
-	auto nextMetrics = nextUpdate;
-	
-	const int maxLoadBufEntries = 16;
-	float loadBuf[maxLoadBufEntries];
-	for (auto cbuf = 0; cbuf < maxLoadBufEntries; ++cbuf)
-		loadBuf[cbuf] = 0.0f;
-	int loadBufHead = maxLoadBufEntries -1;
 
-	auto calcAverageLoad = [&loadBuf, maxLoadBufEntries]() 
-	{
-		auto sumLoad = 0.0f;
-		for (auto ibuf = 0; ibuf < maxLoadBufEntries; ++ibuf)
+	private:
+		//------------------------------------------
+		// one pool thread's updates, built and waiting to go; cleared rather than freed, so they settle at the
+		// biggest a thread's share has been
+		struct UpdateBatch
 		{
-			sumLoad += loadBuf[ibuf];
-		}
-		return sumLoad / maxLoadBufEntries;
+			std::vector<std::pair<TEntityId, FlockOutput::Update>> Outputs;
+			std::vector<std::pair<TEntityId, Transform::Update>> Transforms;
+		};
+
+		worker::Connection& Connection;
+		worker::View View;
+		UpdateBatch Batches[g_maxSimulationThreads];
+		std::vector<worker::OpList> PendingOps;
+		FlockingSimulation& Sim;
+		PhaseTimers& Timers;
+		bool TrackPlayers;
+		WorldRecorder* Recorder;
+		WarmStart* Warm;
 	};
+}
 
-	// flocking thread pool
-	const int numThreadsLocal = g_numThreads;
-	const int allFlags = (1 << g_numThreads) - 1;
-	std::thread threads[g_numThreads];
+//***************************************************************************************************************
+worker::LogLevel ToWorkerLogLevel(logging::LogLevel level)
+{
+	switch (level)
+	{
+	case logging::Debug: return worker::LogLevel::DEBUG;
+	case logging::Info: return worker::LogLevel::INFO;
+	case logging::Warn: return worker::LogLevel::WARN;
+	default: return worker::LogLevel::ERROR;
+	}
+}
 
-	std::atomic_int workStatus(0);
-	float loadStore = 1.0f;
+//***************************************************************************************************************
+// autotuneReport is whatever the autotuner had to say before we connected, if it ran
+void Run(worker::Connection& connection, const SimulationConfig& config, const char* recordingPath, const std::string& autotuneReport)
+{ 
+	logging::SetLimits(g_logLimits);
+	auto logSink = [&connection](logging::LogLevel level, const std::string& logger, const std::string& message)
+	{
+		connection.SendLogMessage(ToWorkerLogLevel(level), logger, message);
+	};
 
-	TTransformCache transformCache;
-	TBuckets spatialGrid;
-	
-	// initialise the worker thread pool
-	for (int c0 = 0; c0 < g_numThreads; ++c0)
+	if (!autotuneReport.empty())
 	{
-		threads[c0] = std::thread([&flockers, &flockersUpdate, &transformCache, &spatialGrid, &view, &connection, &loadStore, c0, numThreadsLocal, allFlags, &workStatus]() {
+		connection.SendLogMessage(worker::LogLevel::INFO, kWorkerType, autotuneReport);
+	}
 
-			int threadId = c0;
+	FlockingSimulation sim(config);
+	// --confinement=<path> or FLOCKING_CONFINEMENT=<path> swaps the built in bounds for a baked field; without either
+	// they stay as they are
+	if (!sim.LoadConfiguredConfinementField())
+	{
+		logging::Log(logging::Warn, "FlockingWorker", "confinement field didn't load, keeping the built in bounds");
+	}
+	WorldRecorder recorder;
+	if (recordingPath != nullptr && recorder.Open(recordingPath))
+	{
+		logging::Log(logging::Info, "FlockingWorker", "recording ops");
+	}
+	// opt in with FLOCKING_TRACE=<path>
+	if (tracing::StartFromEnvironment())
+	{
+		tracing::SetThreadName("main");
+		logging::Log(logging::Info, "FlockingWorker", "tracing enabled");
+	}
 
-			while (g_ExecutionState.fetch_and(Running) == Running)
-			{
-				// wait for work
-				int flag = 1 << threadId;
-				if ((workStatus.load()&flag)!=0)
-				{
-					// choose what to take based on the threadId and the number of flockers
-					int nflockers = flockers.size();
-					if (nflockers < numThreadsLocal)
-					{
-						// do them all
-						if (threadId == 0)
-						{
-							UpdateFlocking(flockers, flockersUpdate, transformCache, spatialGrid, 0, nflockers, view, connection, g_secondsPerFrame*loadStore);
-						}
-					}
-					else
-					{
-						int ndiv = nflockers/ numThreadsLocal;
-						int ntakeTotal = ndiv*numThreadsLocal;
-						int ntakeDiff = nflockers - ntakeTotal;
-
-						int ibegin = threadId*ndiv;
-						int ntake = ndiv + ((threadId == (numThreadsLocal - 1)) ? ntakeDiff : 0);
-
-						UpdateFlocking(flockers, flockersUpdate, transformCache, spatialGrid, ibegin, ibegin+ ntake, view, connection, g_secondsPerFrame*loadStore);
-					}					
-
-					int expected;
-					int newFlag;
-					do
-					{
-						std::this_thread::yield();
-						expected = workStatus.load();
-						newFlag = expected & (~flag);
-					} 
-					while (!workStatus.compare_exchange_strong(expected, newFlag));
+	// --snapshot=<path> picks up where the last worker to write it left off, rather than waiting on the view
+	WarmStart warmStart(config.WarmStart);
+	bool snapshotting = !config.SnapshotPath.empty();
+	if (snapshotting && !warmStart.Begin(config.SnapshotPath, sim, recorder.IsOpen() ? &recorder : nullptr))
+	{
+		logging::Log(logging::Info, "FlockingWorker", "no snapshot to warm start from, starting cold");
+	}
 
-				}
-				else
-				{
-					std::this_thread::sleep_for(std::chrono::milliseconds(1));
-				}
-			}
+	WorkerHost host(connection, sim, config.Schedule.FarFromPlayerDistance > 0.0f, recorder.IsOpen() ? &recorder : nullptr, snapshotting ? &warmStart : nullptr);
+
+	FrameClock frameClock(std::chrono::microseconds(sim.MicrosecondsPerSubTick()));
+	auto nextMetrics = frameClock.Deadline();
+	auto startTime = nextMetrics;
+	auto nextSnapshot = startTime + std::chrono::milliseconds(static_cast<long long>(config.WarmStart.SaveEverySeconds * 1000.0f));
+	snapshotting = snapshotting && config.WarmStart.SaveEverySeconds > 0.0f;
 
-		});
-	}
-	
 	while (g_ExecutionState.fetch_and(Running)==Running)
 	{	
-		auto theTimeNow = std::chrono::system_clock::now();
-		if (theTimeNow > nextUpdate)
+		// block on the connection until the tick is due instead of spinning, then sleep out the last fraction of a millisecond
+		for (auto timeout = frameClock.MillisecondsRemaining(); timeout > 0; timeout = frameClock.MillisecondsRemaining())
 		{
-			connection.SendLogMessage(worker::LogLevel::INFO, "FlockingWorker", "frame update");
-
-			auto ops = connection.GetOpList(0, 0);
-			view.Process(ops);
-
-			{				
-				// single thread
-				// make sure we write to the load store
-				loadStore = std::max(calcAverageLoad(), 1.0f); // make sure we don't go slower than optimum!
-
-				// precache the transforms because Entity::Get<Transform> is crazy expensize!
-				transformCache.resize(view.Entities.size(), nullptr);
-				auto itEnd = view.Entities.end();
-				int ient = -1;
-				for (auto itEnt = view.Entities.begin(); itEnt != itEnd; ++itEnt)
-				{
-					auto& transformOption = itEnt->second.Get<Transform>(); // expensive!
-					transformCache[++ient] = &*transformOption;
-				}
-
-				{
-#ifdef USE_PARTITIONING
-					spatialGrid.clear();
-					BuildSpatialGrid(spatialGrid, view);		
-#endif // 
-				}
-
-				// tell threads: It's time.
-				workStatus.store(allFlags);
+			host.WaitForOps(timeout);
+		}
+		auto waitBegin = tracing::NowMicroseconds();
+		auto theTimeNow = frameClock.WaitForTick();
+		tracing::Record("WaitForTick", waitBegin, tracing::NowMicroseconds());
 
-				// wait for threads
-				while (workStatus.load() != 0)
-				{
-					std::this_thread::yield();
-				}
+		sim.Tick(host, std::chrono::duration<double>(theTimeNow - startTime).count());
 
-				// force through the updates
-				for (int iflock = 0; iflock < flockers.size(); ++iflock)
-				{
-					auto entId = flockers[iflock];
-					auto flockUp = flockersUpdate[iflock];
-						
-					Transform::Update updTransform;
-					updTransform.set_position(flockUp.pos);
-					updTransform.set_velocity(flockUp.velocity);
-					updTransform.set_forward(flockUp.facing);
-					connection.SendComponentUpdate<Transform>(entId, updTransform);
-				}
+		// not while the warm start is still standing in, or we'd save the old snapshot back over itself
+		if (snapshotting && theTimeNow > nextSnapshot && !warmStart.IsActive())
+		{
+			tracing::Scope trace("SaveSnapshot");
+			if (!sim.SaveSnapshot(config.SnapshotPath))
+			{
+				logging::Log(logging::Warn, "FlockingWorker", "couldn't write the snapshot");
 			}
+			nextSnapshot = theTimeNow + std::chrono::milliseconds(static_cast<long long>(config.WarmStart.SaveEverySeconds * 1000.0f));
+		}
 
-			auto timeElapsed = std::chrono::system_clock::now() - theTimeNow;
-			auto millisElapsed = std::chrono::duration_cast<std::chrono::milliseconds>(timeElapsed).count();
+		if (theTimeNow > nextMetrics)
+		{
+			worker::Metrics metrics;
+			TGauges gauges;
+			metrics.Load = sim.CollectMetrics(gauges);
 
-			auto load = millisElapsed * 1.0f / g_millisecondsPerFrame;
+			auto jitter = frameClock.TakeStats();
+			gauges["tick_jitter_ms_mean"] = jitter.MeanMs;
+			gauges["tick_jitter_ms_p99"] = jitter.P99Ms;
+			gauges["tick_jitter_ms_max"] = jitter.MaxMs;
+			gauges["ticks_missed"] = jitter.MissedTicks;
 
-			loadBufHead = (loadBufHead + 1) % maxLoadBufEntries;
-			loadBuf[loadBufHead] = load;
-				
-			if (theTimeNow > nextMetrics)
+			for (auto itGauge = gauges.begin(); itGauge != gauges.end(); ++itGauge)
 			{
-				worker::Metrics metrics;
-				metrics.Load = calcAverageLoad();
-				connection.SendMetrics(metrics);
-				nextMetrics = theTimeNow + std::chrono::milliseconds(g_millisecondsBetweenMetrics);
+				metrics.GaugeMetrics[itGauge->first] = itGauge->second;
 			}
 
-			auto millisRemaining = std::max(g_millisecondsPerFrame - millisElapsed, 0LL);
-			nextUpdate = theTimeNow + std::chrono::milliseconds(millisRemaining);
-
-			if (millisRemaining > 0)
-			{
-				std::this_thread::sleep_for(std::chrono::milliseconds(millisRemaining));
-			}
-			else
-			{
-				std::this_thread::yield();
-			}
-		}
-		else
-		{
-			std::this_thread::yield();
+			connection.SendMetrics(metrics);
+			nextMetrics = theTimeNow + std::chrono::milliseconds(g_millisecondsBetweenMetrics);
 		}
+
+		// the only place log messages hit the connection
+		logging::Drain(logSink);
+		tracing::Flush();
 	}
 
+	tracing::Stop();
+
 	g_ExecutionState.store(Quitting);
 }
 
 int main(int argc, char**argv)
 {
-	unitTest();
+	// settings can come from --config=<path> and --<key>=<value> anywhere on the line
+	SimulationConfig config = DefaultSimulationConfig();
+	CommandLine commandLine;
+	if (!ParseCommandLine(argc, argv, config, commandLine) || commandLine.Help || commandLine.Positional.size() < 3)
+	{
+		printf("usage: %s <ip> <port> <workerId> [recording] [--autotune] [--config=<path>] [--<key>=<value>...]\n", argv[0]);
+		PrintConfigOptions(config);
+		return 1;
+	}
 
-	const char* ipAddress = argv[1];
-	const int port = atoi(argv[2]);
-	const char* workerId = argv[3]; 
+	const char* ipAddress = commandLine.Positional[0].c_str();
+	const int port = atoi(commandLine.Positional[1].c_str());
+	const char* workerId = commandLine.Positional[2].c_str();
+	// optional: record what we receive, for FlockingReplay
+	const char* recordingPath = commandLine.Positional.size() > 3 ? commandLine.Positional[3].c_str() : nullptr;
+
+	// before connecting, so the deployment doesn't see a worker that's gone quiet
+	std::string autotuneReport;
+	if (commandLine.Autotune)
+	{
+		auto tuned = Autotune(config, DefaultAutotuneParams());
+		config = tuned.Config;
+		autotuneReport = DescribeAutotune(tuned);
+		printf("%s", autotuneReport.c_str());
+	}
 
 	worker::ConnectionParameters wcp;
 	wcp.WorkerType = "FlockingWorker";
@@ -698,7 +445,7 @@ int main(int argc, char**argv)
 
 	g_ExecutionState.store(Running);
 	
-	Run(connection);
+	Run(connection, config, recordingPath, autotuneReport);
 	
 	while (g_ExecutionState.fetch_and(Running)==Running)
 	{
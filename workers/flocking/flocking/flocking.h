@@ -1,10 +1,15 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 #include "Maths.h"
-#include "demoteam/transform.h"
+#include "entityindex.h"
 
 using namespace improbable::math;
 
+#define USE_PARTITIONING
+
 namespace demoteam
 {
 #ifdef _WIN32
@@ -13,9 +18,156 @@ namespace demoteam
 #define FORCEINLINE inline
 #endif //_WIN32
 
-	FORCEINLINE bool ShouldConsiderEntity(const TransformData& me, const TransformData& them, float range)
+	// the simulation core only sees these; converting from and to the SDK's TransformData/FlockingData
+	// happens in whatever hosts it (the worker, or the headless harness)
+	typedef std::int64_t TEntityId;
+
+	const int g_maxNeighbours = 32;
+
+	//------------------------------------------
+	struct FlockTransform
+	{
+		FlockTransform() : Position(zero3<Coordinates>()), Forward(unitZ3<Float4>()), Velocity(zero3<Float4>()), Local(zero3<Float4>()) {}
+		FlockTransform(const Coordinates& position, TFloat4Arg forward, TFloat4Arg velocity) : Position(position), Forward(forward), Velocity(velocity), Local(ToFloat4(position)) {}
+		Coordinates Position;
+		Float4 Forward;
+		Float4 Velocity;
+		// Position less the snapshot's Origin, narrowed once as the snapshot is read; the grid and everything that
+		// searches it work in these
+		Float4 Local;
+	};
+
+	//------------------------------------------
+	// mirrors FlockingData in flock.proto
+	struct FlockParams
+	{
+		float AttractCoefficient;
+		float FollowCoefficient;
+		float RepelCoefficient;
+		float RepelSeparationForHalf;
+		float SearchRange;
+		int NumberToConsider;
+		float Speed;
+		float Drag;
+		float VelocitySpring;
+		float VerticalConfinementCoefficient;
+		float MaxTurnDegreesPerSecond;
+	};
+
+	//------------------------------------------
+	struct FlockTransformUpdate
+	{
+		FlockTransformUpdate() : HasPosition(false), HasForward(false), HasVelocity(false), HasTargetVelocity(false), Position(zero3<Coordinates>()), Forward(unitZ3<Vector3f>()), Velocity(zero3<Vector3f>()), TargetVelocity(zero3<Vector3f>()) {}
+		bool HasPosition;
+		bool HasForward;
+		bool HasVelocity;
+		bool HasTargetVelocity;	// goes in FlockOutput rather than Transform
+		Coordinates Position;
+		Vector3f Forward;
+		Vector3f Velocity;
+		Vector3f TargetVelocity;
+	};
+
+	//------------------------------------------
+	struct PendingTransformUpdate
+	{
+		PendingTransformUpdate() : EntityId(0) {}
+		TEntityId EntityId;
+		FlockTransformUpdate Update;
+	};
+
+	typedef std::vector<Coordinates> TInterestPoints;
+
+	//------------------------------------------
+	// everything with a transform in view, rebuilt by the host at the start of each frame
+	struct WorldSnapshot
+	{
+		WorldSnapshot() : Origin(zero3<Coordinates>()), Rebased(false) {}
+
+		// leaves the origin where it is
+		void Clear()
+		{
+			Ids.clear();
+			Transforms.clear();
+			Params.clear();
+			HasParams.clear();
+			Index.Clear();
+			Players.clear();
+		}
+		void Reserve(int n)
+		{
+			Ids.reserve(n);
+			Transforms.reserve(n);
+			Params.reserve(n);
+			HasParams.reserve(n);
+			Index.Reserve(n);
+		}
+		// params is null for anything that isn't a bird
+		void Add(TEntityId entityId, const FlockTransform& transform, const FlockParams* params)
+		{
+			Index.Set(entityId, Ids.size());
+			Ids.push_back(entityId);
+			Transforms.push_back(transform);
+			Transforms.back().Local = transform.Position - Origin;
+			Params.push_back(params != nullptr ? *params : FlockParams());
+			HasParams.push_back(params != nullptr);
+		}
+		// in place of what the host read for it
+		void Set(int ient, const FlockTransform& transform)
+		{
+			Transforms[ient] = transform;
+			Transforms[ient].Local = transform.Position - Origin;
+		}
+		// -1 if it isn't in view
+		int IndexOf(TEntityId entityId) const
+		{
+			return Index.Get(entityId);
+		}
+		int Size() const { return Ids.size(); }
+
+		// moves the origin, and everything's Local with it; from then on the hot path measures between birds in
+		// Local rather than in Position
+		void Rebase(const Coordinates& origin)
+		{
+			Origin = origin;
+			Rebased = true;
+			for (auto itTransform = Transforms.begin(); itTransform != Transforms.end(); ++itTransform)
+			{
+				itTransform->Local = itTransform->Position - Origin;
+			}
+		}
+
+		std::vector<TEntityId> Ids;
+		std::vector<FlockTransform> Transforms;
+		std::vector<FlockParams> Params;
+		std::vector<char> HasParams;
+		EntityIndex Index;
+		TInterestPoints Players;
+		Coordinates Origin;
+		bool Rebased;
+	};
+
+	//------------------------------------------
+	// Where steering measures from one bird to another. Near the world origin, Local and Position are as good as
+	// each other; far from it, only the difference of two Positions keeps its precision, at the cost of doing it
+	// in doubles and narrowing every time. Once the snapshot is rebased near the flock, Local is good everywhere
+	struct WorldPositions
+	{
+		static FORCEINLINE Float4 Between(const FlockTransform& from, const FlockTransform& to) { return to.Position - from.Position; }
+		static FORCEINLINE Float4 Of(const FlockTransform& transform) { return ToFloat4(transform.Position); }
+	};
+
+	//------------------------------------------
+	struct LocalPositions
+	{
+		static FORCEINLINE Float4 Between(const FlockTransform& from, const FlockTransform& to) { return to.Local - from.Local; }
+		static FORCEINLINE Float4 Of(const FlockTransform& transform) { return transform.Local; }
+	};
+
+	template<class TPositions = WorldPositions>
+	FORCEINLINE bool ShouldConsiderEntity(const FlockTransform& me, const FlockTransform& them, float range)
 	{
-		Vector3f lineTo = them.position() - me.position();
+		Float4 lineTo = TPositions::Between(me, them);
 
 		// test range
 		float distSqr = sqrMag(lineTo);
@@ -24,10 +176,10 @@ namespace demoteam
 			return false;
 		}
 		// in front of me?
-		if (dot(lineTo, me.forward())<0.0f)
+		if (dot(lineTo, me.Forward)<0.0f)
 		{
 			return false;
 		}
 		return true;
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,115 @@
+#include "framearena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace demoteam
+{
+	//***************************************************************************************************************
+	ScratchArena::ScratchArena(std::size_t blockSize) :
+		BlockSize(blockSize),
+		CurrentBlock(0),
+		Offset(0),
+		UsedInEarlierBlocks(0)
+	{
+	}
+
+	//***************************************************************************************************************
+	ScratchArena::~ScratchArena()
+	{
+		for (auto itBlock = Blocks.begin(); itBlock != Blocks.end(); ++itBlock)
+		{
+			delete[] itBlock->Data;
+		}
+	}
+
+	//***************************************************************************************************************
+	void* ScratchArena::Allocate(std::size_t bytes, std::size_t alignment)
+	{
+		// try the current block, then any later ones left over from a bigger frame, then grow
+		for (; CurrentBlock < Blocks.size(); ++CurrentBlock)
+		{
+			auto& block = Blocks[CurrentBlock];
+			auto base = reinterpret_cast<std::uintptr_t>(block.Data);
+			auto aligned = (base + Offset + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+			if (aligned + bytes <= base + block.Size)
+			{
+				Offset = aligned + bytes - base;
+				return reinterpret_cast<void*>(aligned);
+			}
+			UsedInEarlierBlocks += Offset;
+			Offset = 0;
+		}
+
+		Block block = { new char[std::max(BlockSize, bytes + alignment)], std::max(BlockSize, bytes + alignment) };
+		Blocks.push_back(block);
+		return Allocate(bytes, alignment);
+	}
+
+	//***************************************************************************************************************
+	void ScratchArena::Reset()
+	{
+		CurrentBlock = 0;
+		Offset = 0;
+		UsedInEarlierBlocks = 0;
+	}
+
+	//***************************************************************************************************************
+	std::size_t ScratchArena::BytesUsed() const
+	{
+		return UsedInEarlierBlocks + Offset;
+	}
+
+	//***************************************************************************************************************
+	std::size_t ScratchArena::BytesReserved() const
+	{
+		std::size_t total = 0;
+		for (auto itBlock = Blocks.begin(); itBlock != Blocks.end(); ++itBlock)
+		{
+			total += itBlock->Size;
+		}
+		return total;
+	}
+
+	//***************************************************************************************************************
+	FrameArena::FrameArena(int numThreads) :
+		SharedArena(new ScratchArena())
+	{
+		for (int c0 = 0; c0 < numThreads; ++c0)
+		{
+			ThreadArenas.push_back(std::unique_ptr<ScratchArena>(new ScratchArena(16 * 1024)));
+		}
+	}
+
+	//***************************************************************************************************************
+	void FrameArena::Reset()
+	{
+		SharedArena->Reset();
+		for (auto itArena = ThreadArenas.begin(); itArena != ThreadArenas.end(); ++itArena)
+		{
+			(*itArena)->Reset();
+		}
+	}
+
+	//***************************************************************************************************************
+	std::size_t FrameArena::BytesUsed() const
+	{
+		std::size_t total = SharedArena->BytesUsed();
+		for (auto itArena = ThreadArenas.begin(); itArena != ThreadArenas.end(); ++itArena)
+		{
+			total += (*itArena)->BytesUsed();
+		}
+		return total;
+	}
+
+	//***************************************************************************************************************
+	std::size_t FrameArena::BytesReserved() const
+	{
+		std::size_t total = SharedArena->BytesReserved();
+		for (auto itArena = ThreadArenas.begin(); itArena != ThreadArenas.end(); ++itArena)
+		{
+			total += (*itArena)->BytesReserved();
+		}
+		return total;
+	}
+}
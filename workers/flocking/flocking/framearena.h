@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace demoteam
+{
+	//------------------------------------------
+	// Bump allocator for scratch that lives until the next Reset. Reset keeps the blocks, so once it has grown to
+	// a frame's worth it never goes back to the heap. Nothing allocated here gets its destructor run.
+	class ScratchArena
+	{
+	public:
+		explicit ScratchArena(std::size_t blockSize = 256 * 1024);
+		~ScratchArena();
+
+		void* Allocate(std::size_t bytes, std::size_t alignment);
+		void Reset();
+
+		template<typename T, typename... TArgs>
+		T* New(TArgs&&... args)
+		{
+			return new (Allocate(sizeof(T), alignof(T))) T(std::forward<TArgs>(args)...);
+		}
+
+		// default constructed
+		template<typename T>
+		T* NewArray(int count)
+		{
+			T* items = static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+			for (int c0 = 0; c0 < count; ++c0)
+			{
+				new (items + c0) T();
+			}
+			return items;
+		}
+
+		std::size_t BytesUsed() const;
+		std::size_t BytesReserved() const;
+
+	private:
+		ScratchArena(const ScratchArena&);
+		ScratchArena& operator=(const ScratchArena&);
+
+		struct Block
+		{
+			char* Data;
+			std::size_t Size;
+		};
+
+		std::vector<Block> Blocks;
+		std::size_t BlockSize;
+		std::size_t CurrentBlock;
+		std::size_t Offset;
+		std::size_t UsedInEarlierBlocks;
+	};
+
+	//------------------------------------------
+	// for handing an arena to standard containers; deallocate is a no-op, Reset takes it all back
+	template<typename T>
+	class ArenaAllocator
+	{
+	public:
+		typedef T value_type;
+
+		explicit ArenaAllocator(ScratchArena& arena) : Arena(&arena) {}
+		template<typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) : Arena(other.Arena) {}
+
+		T* allocate(std::size_t n) { return static_cast<T*>(Arena->Allocate(sizeof(T) * n, alignof(T))); }
+		void deallocate(T*, std::size_t) {}
+
+		template<typename U>
+		bool operator==(const ArenaAllocator<U>& other) const { return Arena == other.Arena; }
+		template<typename U>
+		bool operator!=(const ArenaAllocator<U>& other) const { return Arena != other.Arena; }
+
+		ScratchArena* Arena;
+	};
+
+	//------------------------------------------
+	// One sub arena for what the whole frame shares (the grid) and one per pool thread, so the threads never touch
+	// each other's or the heap's locks. Reset at the start of each frame, when nothing from the last one is live.
+	class FrameArena
+	{
+	public:
+		explicit FrameArena(int numThreads);
+
+		ScratchArena& Shared() { return *SharedArena; }
+		ScratchArena& Thread(int threadId) { return *ThreadArenas[threadId]; }
+
+		void Reset();
+
+		std::size_t BytesUsed() const;
+		std::size_t BytesReserved() const;
+
+	private:
+		// separately allocated, so no two threads' arenas share a cache line
+		std::unique_ptr<ScratchArena> SharedArena;
+		std::vector<std::unique_ptr<ScratchArena> > ThreadArenas;
+	};
+}
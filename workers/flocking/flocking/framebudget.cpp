@@ -0,0 +1,79 @@
+#include "framebudget.h"
+
+#include <algorithm>
+
+namespace demoteam
+{
+	//***************************************************************************************************************
+	FrameBudgetController::FrameBudgetController(const FrameBudgetPolicy& policy) :
+		Policy(policy), CurrentLevel(FullQuality), Smoothed(0.0f), CalmTicks(0), Overruns(0), SkipCursor(0)
+	{
+	}
+
+	//***************************************************************************************************************
+	bool FrameBudgetController::Record(float load)
+	{
+		Smoothed = Smoothed + (load - Smoothed)*Policy.Smoothing;
+		if (!Policy.Enabled)
+		{
+			return false;
+		}
+
+		auto previousLevel = CurrentLevel;
+
+		// one long tick is as likely a hitch (a page fault, the OS taking the core) as a sign of load, so it takes the
+		// smoothed load or a run of overruns to degrade; recovering needs a run of calm ticks
+		Overruns = load > 1.0f ? Overruns + 1 : 0;
+		bool overrunning = Policy.OverrunsToRaise > 0 && Overruns >= Policy.OverrunsToRaise;
+		if ((Smoothed > Policy.RaiseAtLoad || overrunning) && CurrentLevel < NumDegradationLevels - 1)
+		{
+			CurrentLevel = static_cast<DegradationLevel>(CurrentLevel + 1);
+			CalmTicks = 0;
+			Overruns = 0;
+		}
+		else if (Smoothed < Policy.LowerAtLoad)
+		{
+			if (++CalmTicks >= Policy.TicksToLower && CurrentLevel > FullQuality)
+			{
+				CurrentLevel = static_cast<DegradationLevel>(CurrentLevel - 1);
+				CalmTicks = 0;
+			}
+		}
+		else
+		{
+			CalmTicks = 0;
+		}
+
+		return CurrentLevel != previousLevel;
+	}
+
+	//***************************************************************************************************************
+	FlockingLimits FrameBudgetController::Limits() const
+	{
+		FlockingLimits limits = { 0, 1.0f, 0, false };
+		if (CurrentLevel >= CapCandidates)
+		{
+			limits.MaxCandidates = Policy.CandidateCap;
+		}
+		if (CurrentLevel >= FewerNeighbours)
+		{
+			limits.NeighbourScale = Policy.NeighbourScale;
+		}
+		return limits;
+	}
+
+	//***************************************************************************************************************
+	void FrameBudgetController::TrimWork(TScheduledFlockers& work)
+	{
+		int nwork = work.size();
+		int nskip = static_cast<int>(nwork*Policy.SkipFraction);
+		if (CurrentLevel < SkipSlice || nskip <= 0)
+		{
+			return;
+		}
+
+		std::rotate(work.begin(), work.begin() + (SkipCursor % nwork), work.end());
+		work.resize(nwork - nskip);
+		SkipCursor += nskip;
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "scheduler.h"
+
+namespace demoteam
+{
+	// each level keeps everything the ones below it do
+	enum DegradationLevel
+	{
+		FullQuality = 0,
+		CapCandidates,		// stop scanning after CandidateCap candidates per bird
+		FewerNeighbours,	// scale number_to_consider down
+		SkipSlice,			// leave part of each tick's birds for the next frame, the scheduler catches them up
+		NumDegradationLevels
+	};
+
+	//------------------------------------------
+	struct FrameBudgetPolicy
+	{
+		bool Enabled;			// false holds the level at FullQuality whatever the load, for runs that have to repeat
+		float Smoothing;		// weight of the latest tick in the smoothed load
+		float RaiseAtLoad;		// smoothed load (elapsed / budget) above which we degrade a level
+		int OverrunsToRaise;	// or after this many ticks in a row over budget, before the smoothing catches up; 0 = never
+		float LowerAtLoad;		// and below which we recover one...
+		int TicksToLower;		// ...once it has stayed there this many ticks
+		int CandidateCap;
+		float NeighbourScale;
+		float SkipFraction;
+	};
+
+	//------------------------------------------
+	struct FlockingLimits
+	{
+		int MaxCandidates;		// 0 = no cap
+		float NeighbourScale;
+		int MaxNeighbours;		// after scaling; 0 = g_maxNeighbours, which is also as many as there's room for
+		bool TimeEachBird;		// fills in SUpdateUpdate::stepNanoseconds, at two clock reads a bird
+	};
+
+	//------------------------------------------
+	class FrameBudgetController
+	{
+	public:
+		explicit FrameBudgetController(const FrameBudgetPolicy& policy);
+
+		// load of the tick that just finished; true if that changed the level
+		bool Record(float load);
+
+		DegradationLevel Level() const { return CurrentLevel; }
+		float SmoothedLoad() const { return Smoothed; }
+		FlockingLimits Limits() const;
+
+		// drops this level's share of the work, rotating which birds miss out
+		void TrimWork(TScheduledFlockers& work);
+
+	private:
+		FrameBudgetPolicy Policy;
+		DegradationLevel CurrentLevel;
+		float Smoothed;
+		int CalmTicks;
+		int Overruns;
+		unsigned int SkipCursor;
+	};
+}
@@ -0,0 +1,59 @@
+#include "frameclock.h"
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+
+namespace demoteam
+{
+	//***************************************************************************************************************
+	FrameClock::FrameClock(TClock::duration period) : Period(period), NextDeadline(TClock::now()), MissedTicks(0)
+	{
+	}
+
+	//***************************************************************************************************************
+	unsigned int FrameClock::MillisecondsRemaining() const
+	{
+		auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(NextDeadline - TClock::now()).count();
+		return remaining > 0 ? static_cast<unsigned int>(remaining) : 0;
+	}
+
+	//***************************************************************************************************************
+	FrameClock::TClock::time_point FrameClock::WaitForTick()
+	{
+		std::this_thread::sleep_until(NextDeadline);
+
+		auto now = TClock::now();
+		LatenessMs.push_back(std::chrono::duration<float, std::milli>(now - NextDeadline).count());
+
+		NextDeadline += Period;
+		if (NextDeadline <= now)
+		{
+			// fell behind: skip the periods we missed but stay on the original grid
+			auto missed = (now - NextDeadline) / Period + 1;
+			MissedTicks += static_cast<int>(missed);
+			NextDeadline += Period*missed;
+		}
+		return now;
+	}
+
+	//***************************************************************************************************************
+	FrameJitterStats FrameClock::TakeStats()
+	{
+		FrameJitterStats stats;
+		stats.Ticks = LatenessMs.size();
+		stats.MissedTicks = MissedTicks;
+		if (!LatenessMs.empty())
+		{
+			stats.MeanMs = std::accumulate(LatenessMs.begin(), LatenessMs.end(), 0.0f) / LatenessMs.size();
+			stats.MaxMs = *std::max_element(LatenessMs.begin(), LatenessMs.end());
+
+			auto itP99 = LatenessMs.begin() + (LatenessMs.size() * 99) / 100;
+			std::nth_element(LatenessMs.begin(), itP99, LatenessMs.end());
+			stats.P99Ms = *itP99;
+		}
+		LatenessMs.clear();
+		MissedTicks = 0;
+		return stats;
+	}
+}
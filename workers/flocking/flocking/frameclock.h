@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+namespace demoteam
+{
+	//------------------------------------------
+	struct FrameJitterStats
+	{
+		FrameJitterStats() : Ticks(0), MissedTicks(0), MeanMs(0.0f), P99Ms(0.0f), MaxMs(0.0f) {}
+		int Ticks;
+		int MissedTicks;	// whole periods skipped because a tick ran long
+		float MeanMs;		// lateness of the wake-up relative to the deadline
+		float P99Ms;
+		float MaxMs;
+	};
+
+	//------------------------------------------
+	// Fixed-rate ticks on the monotonic clock. Deadlines are absolute and advance by exactly one
+	// period, so sleeping late or a long tick never shifts the schedule.
+	class FrameClock
+	{
+	public:
+		typedef std::chrono::steady_clock TClock;
+
+		explicit FrameClock(TClock::duration period);
+
+		TClock::time_point Deadline() const { return NextDeadline; }
+
+		// whole milliseconds left before the deadline, for blocking waits
+		unsigned int MillisecondsRemaining() const;
+
+		// sleeps out whatever is left of the period, then starts the tick; returns its start time
+		TClock::time_point WaitForTick();
+
+		FrameJitterStats TakeStats();
+
+	private:
+		TClock::duration Period;
+		TClock::time_point NextDeadline;
+		std::vector<float> LatenessMs;
+		int MissedTicks;
+	};
+}
@@ -9,44 +9,44 @@ namespace geometry
 	bool testBoxPlanes(const Aabb3& box, std::function<bool(Plane)> testFunc)
 	{
 		//left
-		if (!testFunc(Plane(unitX3<Vector3f>()*-1.0f, box.LeftBottomBack)))
+		if (!testFunc(Plane(unitX3<Float4>()*-1.0f, box.LeftBottomBack)))
 			return false;
 		//right
-		if (!testFunc(Plane(unitX3<Vector3f>(), box.RightTopFront)))
+		if (!testFunc(Plane(unitX3<Float4>(), box.RightTopFront)))
 			return false;
 		//bottom
-		if (!testFunc(Plane(unitY3<Vector3f>()*-1.0f, box.LeftBottomBack)))
+		if (!testFunc(Plane(unitY3<Float4>()*-1.0f, box.LeftBottomBack)))
 			return false;
 		//top
-		if (!testFunc(Plane(unitY3<Vector3f>(), box.RightTopFront)))
+		if (!testFunc(Plane(unitY3<Float4>(), box.RightTopFront)))
 			return false;
 		//back
-		if (!testFunc(Plane(unitZ3<Vector3f>()*-1.0f, box.LeftBottomBack)))
+		if (!testFunc(Plane(unitZ3<Float4>()*-1.0f, box.LeftBottomBack)))
 			return false;
 		//front
-		if (!testFunc(Plane(unitZ3<Vector3f>(), box.RightTopFront)))
+		if (!testFunc(Plane(unitZ3<Float4>(), box.RightTopFront)))
 			return false;
 
 		return true;
 	}
 	//*********************************************************************************
-	bool testBoxVerts(const Aabb3& box, std::function<bool(Vector3f)> testFunc)
+	bool testBoxVerts(const Aabb3& box, std::function<bool(TFloat4Arg)> testFunc)
 	{
-		if (testFunc(box.LeftBottomBack*Vector3f(1, 1, 1) + box.RightTopFront*Vector3f(0, 0, 0)))
+		if (testFunc(box.LeftBottomBack*Float4(1, 1, 1) + box.RightTopFront*Float4(0, 0, 0)))
 			return true;
-		if (testFunc(box.LeftBottomBack*Vector3f(0, 1, 1) + box.RightTopFront*Vector3f(1, 0, 0)))
+		if (testFunc(box.LeftBottomBack*Float4(0, 1, 1) + box.RightTopFront*Float4(1, 0, 0)))
 			return true;
-		if (testFunc(box.LeftBottomBack*Vector3f(1, 0, 1) + box.RightTopFront*Vector3f(0, 1, 0)))
+		if (testFunc(box.LeftBottomBack*Float4(1, 0, 1) + box.RightTopFront*Float4(0, 1, 0)))
 			return true;
-		if (testFunc(box.LeftBottomBack*Vector3f(1, 1, 0) + box.RightTopFront*Vector3f(0, 0, 1)))
+		if (testFunc(box.LeftBottomBack*Float4(1, 1, 0) + box.RightTopFront*Float4(0, 0, 1)))
 			return true;
-		if (testFunc(box.LeftBottomBack*Vector3f(0, 0, 0) + box.RightTopFront*Vector3f(1, 1, 1)))
+		if (testFunc(box.LeftBottomBack*Float4(0, 0, 0) + box.RightTopFront*Float4(1, 1, 1)))
 			return true;
-		if (testFunc(box.LeftBottomBack*Vector3f(1, 0, 0) + box.RightTopFront*Vector3f(0, 1, 1)))
+		if (testFunc(box.LeftBottomBack*Float4(1, 0, 0) + box.RightTopFront*Float4(0, 1, 1)))
 			return true;
-		if (testFunc(box.LeftBottomBack*Vector3f(0, 1, 0) + box.RightTopFront*Vector3f(1, 0, 1)))
+		if (testFunc(box.LeftBottomBack*Float4(0, 1, 0) + box.RightTopFront*Float4(1, 0, 1)))
 			return true;
-		if (testFunc(box.LeftBottomBack*Vector3f(0, 0, 1) + box.RightTopFront*Vector3f(1, 1, 0)))
+		if (testFunc(box.LeftBottomBack*Float4(0, 0, 1) + box.RightTopFront*Float4(1, 1, 0)))
 			return true;
 
 		return false;
@@ -56,27 +56,21 @@ namespace geometry
 	bool boxSphereOverlap(const Aabb3& box, const Sphere& sphere)
 	{
 		// early out if we have no chance of overlap
-		if (!boxContains(stretchBox(box, one3<Vector3f>()*sphere.Radius), sphere.Origin))
+		if (!boxContains(stretchBox(box, one3<Float4>()*sphere.Radius), sphere.Origin))
 			return false;
 
-		if (boxContains(stretchBox(box, unitX3<Vector3f>()*sphere.Radius), sphere.Origin))
+		if (boxContains(stretchBox(box, unitX3<Float4>()*sphere.Radius), sphere.Origin))
 			return true;
-		if (boxContains(stretchBox(box, unitY3<Vector3f>()*sphere.Radius), sphere.Origin))
+		if (boxContains(stretchBox(box, unitY3<Float4>()*sphere.Radius), sphere.Origin))
 			return true;
-		if (boxContains(stretchBox(box, unitZ3<Vector3f>()*sphere.Radius), sphere.Origin))
+		if (boxContains(stretchBox(box, unitZ3<Float4>()*sphere.Radius), sphere.Origin))
 			return true;
 
-		// now just check the corners!
-		if (testBoxVerts(box, [sphere](TVector3fArg vert) {
-			return sqrMag(sphere.Origin - vert)<sqr(sphere.Radius);
-		})) {
-			return true;
-		}
-
-		return false;
+		// what's left is near an edge or a corner
+		return sqrDistanceToBox(box, sphere.Origin) < sqr(sphere.Radius);
 	}
 
-	bool boxContains(const Plane* planes, TVector3fArg pos)
+	bool boxContains(const Plane* planes, TFloat4Arg pos)
 	{
 		auto correctSide = [pos](const Plane& plane)
 		{
@@ -95,7 +89,7 @@ namespace geometry
 	}
 
 	//*********************************************************************************
-	bool boxContains(const Aabb3& box, TVector3fArg pos)
+	bool boxContains(const Aabb3& box, TFloat4Arg pos)
 	{
 		auto correctSide = [pos](const Plane& plane)
 		{
@@ -104,24 +98,24 @@ namespace geometry
 		
 		//return testBoxPlanes(box, correctSide);
 
-		if (!correctSide(Plane(unitX3<Vector3f>()*-1.0f, box.LeftBottomBack)))
+		if (!correctSide(Plane(unitX3<Float4>()*-1.0f, box.LeftBottomBack)))
 			return false;
-		if (!correctSide(Plane(unitX3<Vector3f>(), box.RightTopFront)))
+		if (!correctSide(Plane(unitX3<Float4>(), box.RightTopFront)))
 			return false;
-		if (!correctSide(Plane(unitY3<Vector3f>()*-1.0f, box.LeftBottomBack)))
+		if (!correctSide(Plane(unitY3<Float4>()*-1.0f, box.LeftBottomBack)))
 			return false;
-		if (!correctSide(Plane(unitY3<Vector3f>(), box.RightTopFront)))
+		if (!correctSide(Plane(unitY3<Float4>(), box.RightTopFront)))
 			return false;
-		if (!correctSide(Plane(unitZ3<Vector3f>()*-1.0f, box.LeftBottomBack)))
+		if (!correctSide(Plane(unitZ3<Float4>()*-1.0f, box.LeftBottomBack)))
 			return false;
-		if (!correctSide(Plane(unitZ3<Vector3f>(), box.RightTopFront)))
+		if (!correctSide(Plane(unitZ3<Float4>(), box.RightTopFront)))
 			return false;
 
 		return true;
 	}
 
 	//*********************************************************************************
-	CubeSphereIntersection::CubeSphereIntersection(const Aabb3& box, float radius)
+	CubeSphereIntersection::CubeSphereIntersection(const Aabb3& box, float radius) : Box(box), Radius(radius)
 	{
 		Plane* planeBuffer = Planes;
 
@@ -130,34 +124,22 @@ namespace geometry
 			auto& lbb = box.LeftBottomBack;
 			auto& rtf = box.RightTopFront;
 
-			planeBuffer[itarget * 6 + 0] = Plane(unitX3<Vector3f>()*-1.0f, lbb);
-			planeBuffer[itarget * 6 + 1] = Plane(unitX3<Vector3f>(), rtf);
-			planeBuffer[itarget * 6 + 2] = Plane(unitY3<Vector3f>()*-1.0f, lbb);
-			planeBuffer[itarget * 6 + 3] = Plane(unitY3<Vector3f>(), rtf);
-			planeBuffer[itarget * 6 + 4] = Plane(unitZ3<Vector3f>()*-1.0f, lbb);
-			planeBuffer[itarget * 6 + 5] = Plane(unitZ3<Vector3f>(), rtf);
+			planeBuffer[itarget * 6 + 0] = Plane(unitX3<Float4>()*-1.0f, lbb);
+			planeBuffer[itarget * 6 + 1] = Plane(unitX3<Float4>(), rtf);
+			planeBuffer[itarget * 6 + 2] = Plane(unitY3<Float4>()*-1.0f, lbb);
+			planeBuffer[itarget * 6 + 3] = Plane(unitY3<Float4>(), rtf);
+			planeBuffer[itarget * 6 + 4] = Plane(unitZ3<Float4>()*-1.0f, lbb);
+			planeBuffer[itarget * 6 + 5] = Plane(unitZ3<Float4>(), rtf);
 		};
 
-		writePlanes(SuperBox, stretchBox(box, one3<Vector3f>()*radius));
-		writePlanes(StretchX, stretchBox(box, unitX3<Vector3f>()*radius));
-		writePlanes(StretchY, stretchBox(box, unitY3<Vector3f>()*radius));
-		writePlanes(StretchZ, stretchBox(box, unitZ3<Vector3f>()*radius));
-
-		auto& lbb = box.LeftBottomBack;
-		auto& rtf = box.RightTopFront;
-
-		Vertices[0] = Sphere(lbb*Vector3f(1, 1, 1) + rtf*Vector3f(0, 0, 0), radius);
-		Vertices[1] = Sphere(lbb*Vector3f(0, 1, 1) + rtf*Vector3f(1, 0, 0), radius);
-		Vertices[2] = Sphere(lbb*Vector3f(1, 0, 1) + rtf*Vector3f(0, 1, 0), radius);
-		Vertices[3] = Sphere(lbb*Vector3f(1, 1, 0) + rtf*Vector3f(0, 0, 1), radius);
-		Vertices[4] = Sphere(lbb*Vector3f(0, 0, 0) + rtf*Vector3f(1, 1, 1), radius);
-		Vertices[5] = Sphere(lbb*Vector3f(1, 0, 0) + rtf*Vector3f(0, 1, 1), radius);
-		Vertices[6] = Sphere(lbb*Vector3f(0, 1, 0) + rtf*Vector3f(1, 0, 1), radius);
-		Vertices[7] = Sphere(lbb*Vector3f(0, 0, 1) + rtf*Vector3f(1, 1, 0), radius);
+		writePlanes(SuperBox, stretchBox(box, one3<Float4>()*radius));
+		writePlanes(StretchX, stretchBox(box, unitX3<Float4>()*radius));
+		writePlanes(StretchY, stretchBox(box, unitY3<Float4>()*radius));
+		writePlanes(StretchZ, stretchBox(box, unitZ3<Float4>()*radius));
 	}
 
 	//*********************************************************************************
-	bool CubeSphereIntersection::IntersectionAt(TVector3fArg spherePos) const
+	bool CubeSphereIntersection::IntersectionAt(TFloat4Arg spherePos) const
 	{
 		// early out if we have no chance of overlap
 		if (!boxContains(Planes+SuperBox * 6, spherePos))
@@ -170,96 +152,108 @@ namespace geometry
 		if (boxContains(Planes + StretchZ * 6, spherePos))
 			return true;
 
-		// now just check the corners!
-		for (int cvert = 0; cvert < 8; ++cvert)
-		{
-			if (sphereContains(Vertices[cvert], spherePos))
-			{
-				return true;
-			}
-		}
-		return false;
+		// the corner spheres alone leave gaps along the edges
+		return sqrDistanceToBox(Box, spherePos) < sqr(Radius);
 	}
 
 	//*********************************************************************************
 	bool unitTest()
 	{
-		Vector3f boxLBB = Vector3f(50, 50, 50);
-		Vector3f boxRTF = Vector3f(60, 60, 60);
+		Float4 boxLBB = Float4(50, 50, 50);
+		Float4 boxRTF = Float4(60, 60, 60);
 		Aabb3 boxTest(boxLBB, boxRTF);
 
+		bool ok = true;
+		auto check = [&ok](bool passed)
+		{
+			printf(passed ? "success\n" : "failure\n");
+			ok = ok && passed;
+		};
+
 		printf("volume\n");
 		{
-			Sphere sphereOut = { Vector3f(0, 55, 55), 32 };
-			Sphere sphereIn = { Vector3f(20, 55, 55), 32 };
-			if (!boxSphereOverlap(boxTest, sphereOut)) printf("success\n"); else printf("failure\n");
-			if (boxSphereOverlap(boxTest, sphereIn)) printf("success\n"); else printf("failure\n");
+			Sphere sphereOut = { Float4(0, 55, 55), 32 };
+			Sphere sphereIn = { Float4(20, 55, 55), 32 };
+			check(!boxSphereOverlap(boxTest, sphereOut));
+			check(boxSphereOverlap(boxTest, sphereIn));
 		}{
-			Sphere sphereOut = { Vector3f(55, 0, 55), 32 };
-			Sphere sphereIn = { Vector3f(55, 20, 55), 32 };
-			if (!boxSphereOverlap(boxTest, sphereOut)) printf("success\n"); else printf("failure\n");
-			if (boxSphereOverlap(boxTest, sphereIn)) printf("success\n"); else printf("failure\n");
+			Sphere sphereOut = { Float4(55, 0, 55), 32 };
+			Sphere sphereIn = { Float4(55, 20, 55), 32 };
+			check(!boxSphereOverlap(boxTest, sphereOut));
+			check(boxSphereOverlap(boxTest, sphereIn));
 		} {
-			Sphere sphereOut = { Vector3f(55, 55, 0), 32 };
-			Sphere sphereIn = { Vector3f(55, 55, 20), 32 };
-			if (!boxSphereOverlap(boxTest, sphereOut)) printf("success\n"); else printf("failure\n");
-			if (boxSphereOverlap(boxTest, sphereIn)) printf("success\n"); else printf("failure\n");
+			Sphere sphereOut = { Float4(55, 55, 0), 32 };
+			Sphere sphereIn = { Float4(55, 55, 20), 32 };
+			check(!boxSphereOverlap(boxTest, sphereOut));
+			check(boxSphereOverlap(boxTest, sphereIn));
 		}
 		// corner cases
 		printf("corners\n");
 		{
-			Vector3f v0 = boxLBB*Vector3f(1, 1, 1) + boxRTF*Vector3f(0, 0, 0);
-			Vector3f v1 = boxLBB*Vector3f(0, 1, 1) + boxRTF*Vector3f(1, 0, 0);
-			Vector3f v2 = boxLBB*Vector3f(1, 0, 1) + boxRTF*Vector3f(0, 1, 0);
-			Vector3f v3 = boxLBB*Vector3f(1, 1, 0) + boxRTF*Vector3f(0, 0, 1);
+			Float4 v0 = boxLBB*Float4(1, 1, 1) + boxRTF*Float4(0, 0, 0);
+			Float4 v1 = boxLBB*Float4(0, 1, 1) + boxRTF*Float4(1, 0, 0);
+			Float4 v2 = boxLBB*Float4(1, 0, 1) + boxRTF*Float4(0, 1, 0);
+			Float4 v3 = boxLBB*Float4(1, 1, 0) + boxRTF*Float4(0, 0, 1);
 
-			Vector3f v4 = boxLBB*Vector3f(0, 0, 0) + boxRTF*Vector3f(1, 1, 1);
-			Vector3f v5 = boxLBB*Vector3f(1, 0, 0) + boxRTF*Vector3f(0, 1, 1);
-			Vector3f v6 = boxLBB*Vector3f(0, 1, 0) + boxRTF*Vector3f(1, 0, 1);
-			Vector3f v7 = boxLBB*Vector3f(0, 0, 1) + boxRTF*Vector3f(1, 1, 0);
+			Float4 v4 = boxLBB*Float4(0, 0, 0) + boxRTF*Float4(1, 1, 1);
+			Float4 v5 = boxLBB*Float4(1, 0, 0) + boxRTF*Float4(0, 1, 1);
+			Float4 v6 = boxLBB*Float4(0, 1, 0) + boxRTF*Float4(1, 0, 1);
+			Float4 v7 = boxLBB*Float4(0, 0, 1) + boxRTF*Float4(1, 1, 0);
 
 			{
-				Sphere sphereOut = { v0 - one3<Vector3f>() * 20, 32 };
-				Sphere sphereIn = { v0 - one3<Vector3f>() * 15, 32 };
-				if (!boxSphereOverlap(boxTest, sphereOut)) printf("success\n"); else printf("failure\n");
-				if (boxSphereOverlap(boxTest, sphereIn)) printf("success\n"); else printf("failure\n");
+				Sphere sphereOut = { v0 - one3<Float4>() * 20, 32 };
+				Sphere sphereIn = { v0 - one3<Float4>() * 15, 32 };
+				check(!boxSphereOverlap(boxTest, sphereOut));
+				check(boxSphereOverlap(boxTest, sphereIn));
 			} {
-				Sphere sphereOut = { v1 - Vector3f(-1,1,1) * 20, 32 };
-				Sphere sphereIn = { v1 - Vector3f(-1,1,1) * 15, 32 };
-				if (!boxSphereOverlap(boxTest, sphereOut)) printf("success\n"); else printf("failure\n");
-				if (boxSphereOverlap(boxTest, sphereIn)) printf("success\n"); else printf("failure\n");
+				Sphere sphereOut = { v1 - Float4(-1,1,1) * 20, 32 };
+				Sphere sphereIn = { v1 - Float4(-1,1,1) * 15, 32 };
+				check(!boxSphereOverlap(boxTest, sphereOut));
+				check(boxSphereOverlap(boxTest, sphereIn));
 			} {
-				Sphere sphereOut = { v2 - Vector3f(1,-1,1) * 20, 32 };
-				Sphere sphereIn = { v2 - Vector3f(1,-1,1) * 15, 32 };
-				if (!boxSphereOverlap(boxTest, sphereOut)) printf("success\n"); else printf("failure\n");
-				if (boxSphereOverlap(boxTest, sphereIn)) printf("success\n"); else printf("failure\n");
+				Sphere sphereOut = { v2 - Float4(1,-1,1) * 20, 32 };
+				Sphere sphereIn = { v2 - Float4(1,-1,1) * 15, 32 };
+				check(!boxSphereOverlap(boxTest, sphereOut));
+				check(boxSphereOverlap(boxTest, sphereIn));
 			} {
-				Sphere sphereOut = { v3 - Vector3f(1,1,-1) * 20, 32 };
-				Sphere sphereIn = { v3 - Vector3f(1,1,-1) * 15, 32 };
-				if (!boxSphereOverlap(boxTest, sphereOut)) printf("success\n"); else printf("failure\n");
-				if (boxSphereOverlap(boxTest, sphereIn)) printf("success\n"); else printf("failure\n");
+				Sphere sphereOut = { v3 - Float4(1,1,-1) * 20, 32 };
+				Sphere sphereIn = { v3 - Float4(1,1,-1) * 15, 32 };
+				check(!boxSphereOverlap(boxTest, sphereOut));
+				check(boxSphereOverlap(boxTest, sphereIn));
 			} {
-				Sphere sphereOut = { v4 + one3<Vector3f>() * 20, 32 };
-				Sphere sphereIn = { v4 + one3<Vector3f>() * 15, 32 };
-				if (!boxSphereOverlap(boxTest, sphereOut)) printf("success\n"); else printf("failure\n");
-				if (boxSphereOverlap(boxTest, sphereIn)) printf("success\n"); else printf("failure\n");
+				Sphere sphereOut = { v4 + one3<Float4>() * 20, 32 };
+				Sphere sphereIn = { v4 + one3<Float4>() * 15, 32 };
+				check(!boxSphereOverlap(boxTest, sphereOut));
+				check(boxSphereOverlap(boxTest, sphereIn));
 			} {
-				Sphere sphereOut = { v5 + Vector3f(-1,1,1) * 20, 32 };
-				Sphere sphereIn = { v5 + Vector3f(-1,1,1) * 15, 32 };
-				if (!boxSphereOverlap(boxTest, sphereOut)) printf("success\n"); else printf("failure\n");
-				if (boxSphereOverlap(boxTest, sphereIn)) printf("success\n"); else printf("failure\n");
+				Sphere sphereOut = { v5 + Float4(-1,1,1) * 20, 32 };
+				Sphere sphereIn = { v5 + Float4(-1,1,1) * 15, 32 };
+				check(!boxSphereOverlap(boxTest, sphereOut));
+				check(boxSphereOverlap(boxTest, sphereIn));
 			} {
-				Sphere sphereOut = { v6 + Vector3f(1,-1,1) * 20, 32 };
-				Sphere sphereIn = { v6 + Vector3f(1,-1,1) * 15, 32 };
-				if (!boxSphereOverlap(boxTest, sphereOut)) printf("success\n"); else printf("failure\n");
-				if (boxSphereOverlap(boxTest, sphereIn)) printf("success\n"); else printf("failure\n");
+				Sphere sphereOut = { v6 + Float4(1,-1,1) * 20, 32 };
+				Sphere sphereIn = { v6 + Float4(1,-1,1) * 15, 32 };
+				check(!boxSphereOverlap(boxTest, sphereOut));
+				check(boxSphereOverlap(boxTest, sphereIn));
 			} {
-				Sphere sphereOut = { v7 + Vector3f(1,1,-1) * 20, 32 };
-				Sphere sphereIn = { v7 + Vector3f(1,1,-1) * 15, 32 };
-				if (!boxSphereOverlap(boxTest, sphereOut)) printf("success\n"); else printf("failure\n");
-				if (boxSphereOverlap(boxTest, sphereIn)) printf("success\n"); else printf("failure\n");
+				Sphere sphereOut = { v7 + Float4(1,1,-1) * 20, 32 };
+				Sphere sphereIn = { v7 + Float4(1,1,-1) * 15, 32 };
+				check(!boxSphereOverlap(boxTest, sphereOut));
+				check(boxSphereOverlap(boxTest, sphereIn));
 			}
 		}
-		return true;
+		// off the middle of an edge, too far from either corner to touch them
+		printf("edges\n");
+		{
+			Sphere sphereOut = { Float4(46, 46, 55), 5 };
+			Sphere sphereIn = { Float4(47, 47, 55), 5 };
+			check(!boxSphereOverlap(boxTest, sphereOut));
+			check(boxSphereOverlap(boxTest, sphereIn));
+
+			CubeSphereIntersection intersection(boxTest, 5);
+			check(!intersection.IntersectionAt(sphereOut.Origin));
+			check(intersection.IntersectionAt(sphereIn.Origin));
+		}
+		return ok;
 	}
 }
\ No newline at end of file
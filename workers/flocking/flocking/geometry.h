@@ -11,29 +11,28 @@ namespace geometry
 	//------------------------------------------
 	struct Sphere
 	{
-		Sphere() : Origin(zero3<Vector3f>()) {}
-		Sphere(TVector3fArg origin, float radius) : Origin(origin), Radius(radius) {}
-		
-		// todo: Vector4 implementation
-		Vector3f Origin;
+		Sphere() : Origin(zero3<Float4>()) {}
+		Sphere(TFloat4Arg origin, float radius) : Origin(origin), Radius(radius) {}
+
+		Float4 Origin;
 		float Radius;
 	};
 	//------------------------------------------
 	struct Plane
 	{
-		Plane() : Normal(unitY3<Vector3f>()), DistanceToOrigin(0.0f) {}
-		Plane(TVector3fArg n, TVector3fArg posOnPlane) : Normal(n), DistanceToOrigin(dot(posOnPlane, n)) {}
-		Vector3f Normal;
+		Plane() : Normal(unitY3<Float4>()), DistanceToOrigin(0.0f) {}
+		Plane(TFloat4Arg n, TFloat4Arg posOnPlane) : Normal(n), DistanceToOrigin(dot(posOnPlane, n)) {}
+		Float4 Normal;
 		float DistanceToOrigin;
 	};
 	
 	//------------------------------------------
 	struct Aabb3
 	{
-		Aabb3(TVector3fArg lbb, TVector3fArg rtf) : LeftBottomBack(lbb), RightTopFront(rtf) {}
+		Aabb3(TFloat4Arg lbb, TFloat4Arg rtf) : RightTopFront(rtf), LeftBottomBack(lbb) {}
 
-		Vector3f RightTopFront;
-		Vector3f LeftBottomBack;
+		Float4 RightTopFront;
+		Float4 LeftBottomBack;
 	};
 
 	//------------------------------------------
@@ -42,7 +41,7 @@ namespace geometry
 	public:
 		CubeSphereIntersection(const Aabb3& box, float radius);
 
-		bool IntersectionAt(TVector3fArg spherePos) const;
+		bool IntersectionAt(TFloat4Arg spherePos) const;
 		
 		enum
 		{
@@ -54,15 +53,26 @@ namespace geometry
 		};
 
 		Plane Planes[NumStretches*6];
-		Sphere Vertices[8];
+		Aabb3 Box;
+		float Radius;
 	};
 	
-	inline bool sphereContains(const Sphere& sphere, TVector3fArg pos)
+	inline bool sphereContains(const Sphere& sphere, TFloat4Arg pos)
 	{
 		return sqrMag(sphere.Origin - pos) < sqr(sphere.Radius);
 	}
 
-	inline float planeClosestDistance(const Plane& plane, TVector3fArg pos)
+	// zero inside the box, so this covers the faces, edges and corners in one go
+	inline float sqrDistanceToBox(const Aabb3& box, TFloat4Arg pos)
+	{
+		auto axis = [](float p, float lo, float hi) { return p < lo ? lo - p : (p > hi ? p - hi : 0.0f); };
+		float dx = axis(pos.X(), box.LeftBottomBack.X(), box.RightTopFront.X());
+		float dy = axis(pos.Y(), box.LeftBottomBack.Y(), box.RightTopFront.Y());
+		float dz = axis(pos.Z(), box.LeftBottomBack.Z(), box.RightTopFront.Z());
+		return dx*dx + dy*dy + dz*dz;
+	}
+
+	inline float planeClosestDistance(const Plane& plane, TFloat4Arg pos)
 	{
 		return plane.DistanceToOrigin - dot(plane.Normal, pos); // something like this?
 	}
@@ -72,19 +82,19 @@ namespace geometry
 		return sqr(planeClosestDistance(plane, sphere.Origin))<sqr(sphere.Radius);
 	}
 
-	inline Aabb3 stretchBox(const Aabb3& box, TVector3fArg delta)
+	inline Aabb3 stretchBox(const Aabb3& box, TFloat4Arg delta)
 	{
 		return Aabb3(box.LeftBottomBack - delta, box.RightTopFront + delta);
 	}
 
 	inline Aabb3 stretchBox(const Aabb3& box, float delta)
 	{
-		return stretchBox(box, one3<Vector3f>()*delta);
+		return stretchBox(box, one3<Float4>()*delta);
 	}
 
 	bool testBoxPlanes(const Aabb3& box, std::function<bool(Plane)> testFunc);
-	bool testBoxVerts(const Aabb3& box, std::function<bool(Vector3f)> testFunc);
-	bool boxContains(const Aabb3& box, TVector3fArg pos);
+	bool testBoxVerts(const Aabb3& box, std::function<bool(TFloat4Arg)> testFunc);
+	bool boxContains(const Aabb3& box, TFloat4Arg pos);
 	bool boxSphereOverlap(const Aabb3& box, const Sphere& sphere);
 
 	bool unitTest();
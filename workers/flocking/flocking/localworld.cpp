@@ -0,0 +1,159 @@
+#include "localworld.h"
+
+#include <algorithm>
+#include <random>
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+namespace demoteam
+{
+	namespace
+	{
+		const LocalWorldParams g_defaultLocalWorldParams =
+		{
+			128 * 4 * 4,	// NumBirds
+			4,				// NumBirdCells
+			200.0f,			// BirdCageSize
+			8.0f,			// BirdSpawnRadius
+			1				// Seed
+		};
+
+		// SpawnStuff is sent with the origin and the respawner lifts it by this much
+		const double g_spawnHeight = 25.0;
+	}
+
+	//***************************************************************************************************************
+	LocalWorldParams DefaultLocalWorldParams()
+	{
+		return g_defaultLocalWorldParams;
+	}
+
+	//***************************************************************************************************************
+	FlockParams BirdFlockParams(float speed)
+	{
+		FlockParams params;
+		params.AttractCoefficient = 5.0f;
+		params.FollowCoefficient = 3.0f;
+		params.RepelCoefficient = 6.0f;
+		params.RepelSeparationForHalf = 3.0f;
+		params.SearchRange = 18.0f;
+		params.NumberToConsider = 7;
+		params.Speed = speed;
+		params.Drag = 0.25f;
+		params.VelocitySpring = 28.0f;
+		params.VerticalConfinementCoefficient = 12.0f;
+		params.MaxTurnDegreesPerSecond = 5.0f;
+		return params;
+	}
+
+	//***************************************************************************************************************
+	LocalWorld::LocalWorld(const LocalWorldParams& params) : Params(params), NextEntityId(1), NumUpdatesReceived(0)
+	{
+	}
+
+	//***************************************************************************************************************
+	void LocalWorld::SpawnBirds()
+	{
+		std::mt19937 rng(Params.Seed);
+		std::uniform_real_distribution<double> random01(0.0, 1.0);
+
+		const int nx = std::max(Params.NumBirdCells, 1);
+		const int nz = nx;
+		const int ncells = nx*nz;
+		// nx of 1 would divide by zero in the scala, put the single cell at the origin instead
+		const double cellSpacing = nx > 1 ? Params.BirdCageSize / (nx - 1) : 0.0;
+
+		for (int icell = 0; icell < ncells; ++icell)
+		{
+			int ix = icell%nx;
+			int iz = icell/nx;
+			Coordinates cellOrigin((ix - (nx - 1) / 2.0)*cellSpacing, g_spawnHeight, (iz - (nz - 1) / 2.0)*cellSpacing);
+
+			// spread the remainder over the first cells so we spawn exactly NumBirds
+			int nbirds = Params.NumBirds / ncells + (icell < Params.NumBirds % ncells ? 1 : 0);
+			for (int ibird = 0; ibird < nbirds; ++ibird)
+			{
+				double angle = random01(rng) * 2.0 * M_PI;
+				double radius = Params.BirdSpawnRadius*sqrt(random01(rng));
+				Coordinates spawnPos(
+					cellOrigin.X() + sin(angle)*radius,
+					cellOrigin.Y() + ((ibird % 16) / 16.0) * 5.0,
+					cellOrigin.Z() + cos(angle)*radius);
+
+				float interp = static_cast<float>(random01(rng));
+				const float speedMin = 0.9f;
+				const float speedMax = 1.1f;
+				float randFactor = speedMax*interp + speedMin*(1 - interp);
+
+				auto params = BirdFlockParams(randFactor*5.0f);
+				AddEntity(NextEntityId++, FlockTransform(spawnPos, unitZ3<Float4>(), zero3<Float4>()), &params);
+			}
+		}
+	}
+
+	//***************************************************************************************************************
+	void LocalWorld::AddEntity(TEntityId entityId, const FlockTransform& transform, const FlockParams* params)
+	{
+		Index[entityId] = Ids.size();
+		Ids.push_back(entityId);
+		Transforms.push_back(transform);
+		FlockParamsStore.push_back(params != nullptr ? *params : FlockParams());
+		IsBird.push_back(params != nullptr);
+		NextEntityId = std::max(NextEntityId, entityId + 1);
+	}
+
+	//***************************************************************************************************************
+	void LocalWorld::DelegateAll(FlockingSimulation& sim) const
+	{
+		int nents = Ids.size();
+		for (int ient = 0; ient < nents; ++ient)
+		{
+			if (IsBird[ient])
+			{
+				sim.OnAuthorityGained(Ids[ient]);
+			}
+		}
+	}
+
+	//***************************************************************************************************************
+	void LocalWorld::ReadWorld(WorldSnapshot& world)
+	{
+		int nents = Ids.size();
+		world.Reserve(nents);
+		for (int ient = 0; ient < nents; ++ient)
+		{
+			world.Add(Ids[ient], Transforms[ient], IsBird[ient] ? &FlockParamsStore[ient] : nullptr);
+		}
+	}
+
+	//***************************************************************************************************************
+	void LocalWorld::SendTransformUpdate(TEntityId entityId, const FlockTransformUpdate& update)
+	{
+		auto itIndex = Index.find(entityId);
+		if (itIndex == Index.end())
+		{
+			return;
+		}
+
+		++NumUpdatesReceived;
+		auto& transform = Transforms[itIndex->second];
+		if (update.HasPosition)
+		{
+			transform.Position = update.Position;
+		}
+		if (update.HasForward)
+		{
+			transform.Forward = update.Forward;
+		}
+		if (update.HasVelocity)
+		{
+			transform.Velocity = update.Velocity;
+		}
+		// there's no clock here to integrate it by, so the position stays at the last keyframe; the simulation keeps
+		// its own birds' positions in between
+		if (update.HasTargetVelocity)
+		{
+			transform.Velocity = update.TargetVelocity;
+		}
+	}
+}
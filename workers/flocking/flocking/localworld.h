@@ -0,0 +1,61 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "flocking.h"
+#include "simulation.h"
+
+namespace demoteam
+{
+	//------------------------------------------
+	// mirrors the spawning parameters in gsim's Parameters.scala
+	struct LocalWorldParams
+	{
+		int NumBirds;			// total, split evenly over the cells
+		int NumBirdCells;		// per side
+		float BirdCageSize;
+		float BirdSpawnRadius;
+		unsigned int Seed;
+	};
+
+	LocalWorldParams DefaultLocalWorldParams();
+
+	// the BirdNature template
+	FlockParams BirdFlockParams(float speed);
+
+	//------------------------------------------
+	// In-process stand-in for the view and the connection, for running the simulation without a deployment.
+	// Updates sent to it are applied straight away, so the next frame sees them as if they'd gone round trip.
+	class LocalWorld : public IFlockingHost
+	{
+	public:
+		explicit LocalWorld(const LocalWorldParams& params);
+
+		// what Respawner.spawnBirds does around the origin
+		void SpawnBirds();
+		void AddEntity(TEntityId entityId, const FlockTransform& transform, const FlockParams* params);
+
+		// we are the only worker, so we are authoritative over every bird
+		void DelegateAll(FlockingSimulation& sim) const;
+
+		int NumEntities() const { return Ids.size(); }
+		TEntityId IdAt(int ient) const { return Ids[ient]; }
+		long long UpdatesReceived() const { return NumUpdatesReceived; }
+
+		virtual void ReadWorld(WorldSnapshot& world);
+		virtual void SendTransformUpdate(TEntityId entityId, const FlockTransformUpdate& update);
+
+	private:
+		LocalWorldParams Params;
+		TEntityId NextEntityId;
+
+		std::vector<TEntityId> Ids;
+		std::vector<FlockTransform> Transforms;
+		std::vector<FlockParams> FlockParamsStore;
+		std::vector<char> IsBird;
+		std::unordered_map<TEntityId, int> Index;
+
+		long long NumUpdatesReceived;
+	};
+}
@@ -0,0 +1,152 @@
+#include "logging.h"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+
+namespace logging
+{
+	namespace
+	{
+		typedef threadrings::RingRegistry<LogRing, 64> TLogRings;
+
+		TLogRings g_rings;
+		thread_local threadrings::RingClaim<TLogRings> tl_ring(g_rings);
+
+		// for threads that can't get a ring of their own; Push takes the lock, so this one has many producers
+		LogRing g_sharedRing;
+		std::mutex g_sharedRingMutex;
+
+		LogLimits g_limits = { 1000, 2, 0 };
+
+		//------------------------------------------
+		struct MessageStats
+		{
+			MessageStats() : PeriodStart(0), Sent(0), Suppressed(0), LastArg(0), HasArg(false) {}
+			long long PeriodStart;
+			int Sent;
+			int Suppressed;
+			long long LastArg;
+			bool HasArg;
+		};
+		typedef std::pair<const char*, const char*> TMessageKey;
+		typedef std::map<std::pair<int, TMessageKey>, MessageStats> TMessageStats;
+
+		TMessageStats g_stats;
+
+		//***************************************************************************************************************
+		void Push(const LogEvent& ev)
+		{
+			auto ring = tl_ring.Get();
+			if (ring != nullptr)
+			{
+				ring->Push(ev);
+			}
+			else
+			{
+				std::lock_guard<std::mutex> lock(g_sharedRingMutex);
+				g_sharedRing.Push(ev);
+			}
+		}
+
+		long long NowMilliseconds()
+		{
+			return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		std::string Format(const char* message, bool hasArg, long long arg)
+		{
+			return hasArg ? std::string(message) + " [" + std::to_string(arg) + "]" : std::string(message);
+		}
+
+		void FlushSummary(const TLogSink& sink, int level, const TMessageKey& key, MessageStats& stats)
+		{
+			if (stats.Suppressed > 0)
+			{
+				sink(static_cast<LogLevel>(level), key.first,
+					Format(key.second, stats.HasArg, stats.LastArg) + " (repeated " + std::to_string(stats.Suppressed) +
+					" more times in " + std::to_string(g_limits.PeriodMilliseconds) + "ms)");
+			}
+			stats.Sent = 0;
+			stats.Suppressed = 0;
+		}
+	}
+
+	//***************************************************************************************************************
+	void Log(LogLevel level, const char* logger, const char* message)
+	{
+		LogEvent ev = { level, logger, message, 0, false };
+		Push(ev);
+	}
+
+	void Log(LogLevel level, const char* logger, const char* message, long long arg)
+	{
+		LogEvent ev = { level, logger, message, arg, true };
+		Push(ev);
+	}
+
+	//***************************************************************************************************************
+	void SetLimits(const LogLimits& limits)
+	{
+		g_limits = limits;
+	}
+
+	//***************************************************************************************************************
+	void Drain(const TLogSink& sink)
+	{
+		auto now = NowMilliseconds();
+		unsigned int dropped = 0;
+
+		// the shared ring goes last
+		int nrings = g_rings.NumClaimed();
+		for (int iring = 0; iring <= nrings; ++iring)
+		{
+			auto& ring = iring < nrings ? g_rings.Ring(iring) : g_sharedRing;
+			LogEvent ev;
+			while (ring.Pop(ev))
+			{
+				auto key = std::make_pair(ev.Logger, ev.Message);
+				auto& stats = g_stats[std::make_pair(static_cast<int>(ev.Level), key)];
+				if (now - stats.PeriodStart >= g_limits.PeriodMilliseconds)
+				{
+					FlushSummary(sink, ev.Level, key, stats);
+					stats.PeriodStart = now;
+				}
+
+				stats.LastArg = ev.Arg;
+				stats.HasArg = ev.HasArg;
+
+				if (stats.Sent < g_limits.BurstPerPeriod)
+				{
+					++stats.Sent;
+					sink(ev.Level, ev.Logger, Format(ev.Message, ev.HasArg, ev.Arg));
+				}
+				else
+				{
+					++stats.Suppressed;
+					if (g_limits.SampleEvery > 0 && (stats.Suppressed % g_limits.SampleEvery) == 0)
+					{
+						sink(ev.Level, ev.Logger, Format(ev.Message, ev.HasArg, ev.Arg) + " (sampled 1 in " + std::to_string(g_limits.SampleEvery) + ")");
+					}
+				}
+			}
+			dropped += ring.TakeDropped();
+		}
+
+		// summaries for messages that have gone quiet
+		for (auto itStats = g_stats.begin(); itStats != g_stats.end(); ++itStats)
+		{
+			auto& stats = itStats->second;
+			if (stats.Suppressed > 0 && now - stats.PeriodStart >= g_limits.PeriodMilliseconds)
+			{
+				FlushSummary(sink, itStats->first.first, itStats->first.second, stats);
+				stats.PeriodStart = now;
+			}
+		}
+
+		if (dropped > 0)
+		{
+			sink(Warn, "logging", "log ring overflow, dropped " + std::to_string(dropped) + " events");
+		}
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "threadrings.h"
+
+namespace logging
+{
+	enum LogLevel
+	{
+		Debug = 0,
+		Info,
+		Warn,
+		Error
+	};
+
+	//------------------------------------------
+	// Logger and Message are not copied, so they must be string literals. Arg is only
+	// formatted on the main thread if the message actually gets sent.
+	struct LogEvent
+	{
+		LogLevel Level;
+		const char* Logger;
+		const char* Message;
+		long long Arg;
+		bool HasArg;
+	};
+
+	// drained on the main thread
+	typedef threadrings::SpscRing<LogEvent, 256> LogRing;
+
+	//------------------------------------------
+	struct LogLimits
+	{
+		long long PeriodMilliseconds;
+		int BurstPerPeriod;		// sent as-is every period, per message
+		int SampleEvery;		// then one in this many of the rest (0 = none), the others are just counted
+	};
+
+	typedef std::function<void(LogLevel level, const std::string& logger, const std::string& message)> TLogSink;
+
+	// safe from any thread, never allocates. Each thread has a ring of its own, given back when it exits; only a
+	// thread that finds them all taken shares one, under a lock.
+	void Log(LogLevel level, const char* logger, const char* message);
+	void Log(LogLevel level, const char* logger, const char* message, long long arg);
+
+	// main thread only
+	void SetLimits(const LogLimits& limits);
+	void Drain(const TLogSink& sink);
+}
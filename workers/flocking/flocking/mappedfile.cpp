@@ -0,0 +1,109 @@
+#include "mappedfile.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif //_WIN32
+
+namespace demoteam
+{
+	//***************************************************************************************************************
+	MappedFile::MappedFile() : Bytes(nullptr), NumBytes(0)
+	{
+	}
+
+	//***************************************************************************************************************
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+#ifdef _WIN32
+	//***************************************************************************************************************
+	bool MappedFile::Open(const std::string& path)
+	{
+		Close();
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			printf("couldn't open %s to map it\n", path.c_str());
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		bool ok = GetFileSizeEx(file, &size) && size.QuadPart > 0;
+		// the view keeps the mapping alive, and the mapping the file
+		HANDLE mapping = ok ? CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr) : nullptr;
+		void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0) : nullptr;
+		if (mapping != nullptr)
+		{
+			CloseHandle(mapping);
+		}
+		CloseHandle(file);
+
+		if (view == nullptr)
+		{
+			printf("couldn't map %s\n", path.c_str());
+			return false;
+		}
+		Bytes = static_cast<char*>(view);
+		NumBytes = static_cast<size_t>(size.QuadPart);
+		return true;
+	}
+
+	//***************************************************************************************************************
+	void MappedFile::Close()
+	{
+		if (Bytes != nullptr)
+		{
+			UnmapViewOfFile(Bytes);
+		}
+		Bytes = nullptr;
+		NumBytes = 0;
+	}
+#else
+	//***************************************************************************************************************
+	bool MappedFile::Open(const std::string& path)
+	{
+		Close();
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			printf("couldn't open %s to map it\n", path.c_str());
+			return false;
+		}
+
+		struct stat info;
+		bool ok = fstat(fd, &info) == 0 && info.st_size > 0;
+		// the mapping keeps the file alive once it's made
+		void* view = ok ? mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+		close(fd);
+
+		if (view == MAP_FAILED)
+		{
+			printf("couldn't map %s\n", path.c_str());
+			return false;
+		}
+		Bytes = static_cast<char*>(view);
+		NumBytes = static_cast<size_t>(info.st_size);
+		return true;
+	}
+
+	//***************************************************************************************************************
+	void MappedFile::Close()
+	{
+		if (Bytes != nullptr)
+		{
+			munmap(Bytes, NumBytes);
+		}
+		Bytes = nullptr;
+		NumBytes = 0;
+	}
+#endif //_WIN32
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace demoteam
+{
+	//------------------------------------------
+	// A whole file mapped copy-on-write: the pages come in as they're touched rather than in one big read, and
+	// anything written through Data() stays in this process and never reaches the file.
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		bool Open(const std::string& path);
+		void Close();
+		bool IsOpen() const { return Bytes != nullptr; }
+
+		char* Data() { return Bytes; }
+		const char* Data() const { return Bytes; }
+		size_t Size() const { return NumBytes; }
+
+	private:
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+		char* Bytes;
+		size_t NumBytes;
+	};
+}
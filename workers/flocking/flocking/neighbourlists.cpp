@@ -0,0 +1,54 @@
+#include "neighbourlists.h"
+
+namespace demoteam
+{
+	//***************************************************************************************************************
+	void NeighbourLists::Resize(int numSlots)
+	{
+		if (numSlots > static_cast<int>(Lists.size()))
+		{
+			Lists.resize(numSlots);
+		}
+	}
+
+	//***************************************************************************************************************
+	void NeighbourLists::Reset(int slot)
+	{
+		// keeps the capacity for whoever has the slot next
+		Lists[slot].Candidates.clear();
+		Lists[slot].FramesSinceBuild = 0.0f;
+		Lists[slot].Built = false;
+	}
+
+	//***************************************************************************************************************
+	bool NeighbourLists::NeedsRebuild(const NeighbourList& list, const FlockTransform& transform) const
+	{
+		return !list.Built ||
+			list.FramesSinceBuild >= Policy.RebuildFrames ||
+			sqrMag(transform.Position - list.Anchor) > sqr(Policy.Skin * 0.5f);
+	}
+
+	//***************************************************************************************************************
+	void NeighbourLists::Rebuild(NeighbourList& list, const TBuckets& spatialGrid, const WorldSnapshot& world, int ient, float searchRange) const
+	{
+		auto& transform = world.Transforms[ient];
+		auto& candidates = list.Candidates;
+		candidates.clear();
+
+		Sphere sphere(transform.Local, searchRange + Policy.Skin);
+		const FlockTransform* transforms = world.Transforms.data();
+		forAllEntitiesWithinRadius(spatialGrid, world, sphere, [ient, transforms, &candidates](TEntityId neighbourId, const FlockTransform& neighbourTransform)
+		{
+			int ineighbour = static_cast<int>(&neighbourTransform - transforms);
+			if (ineighbour != ient)
+			{
+				candidates.push_back(std::make_pair(neighbourId, ineighbour));
+			}
+			return true;
+		});
+
+		list.Anchor = transform.Position;
+		list.FramesSinceBuild = 0.0f;
+		list.Built = true;
+	}
+}
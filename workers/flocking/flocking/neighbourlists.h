@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+
+#include "flocking.h"
+#include "spatialgrid.h"
+
+namespace demoteam
+{
+	//------------------------------------------
+	struct NeighbourListPolicy
+	{
+		float Skin;				// lists reach this far past each bird's SearchRange (0 = off, query the grid every step)
+		float RebuildFrames;	// rebuilt at least this often, counted in frames the bird has been stepped through
+	};
+
+	//------------------------------------------
+	// one bird's candidates from its last grid query, out to SearchRange + Skin. Index is where the candidate sat in
+	// the snapshot it was found in; if it has moved since, it's found again by id
+	struct NeighbourList
+	{
+		NeighbourList() : Anchor(zero3<Coordinates>()), FramesSinceBuild(0.0f), Built(false) {}
+		std::vector<TEntityStorage> Candidates;
+		Coordinates Anchor;		// where the bird was when the list was built
+		float FramesSinceBuild;
+		bool Built;
+	};
+
+	//------------------------------------------
+	// Verlet lists, one per flocker slot. Birds only move a fraction of a metre a frame, so a list taken a little
+	// wider than the search stays good for a few frames, and each step only has to filter it rather than walk the
+	// grid. It's exact as long as no two birds close on each other by more than Skin between rebuilds: with the
+	// default 6m skin and rebuilds every 4 frames, that holds for anything up to ~6m/s at 8 frames a second.
+	// Each slot is only touched by the thread stepping that bird, like FlockersUpdate; the candidate vectors keep
+	// their capacity, so once the flock has settled rebuilding doesn't allocate.
+	class NeighbourLists
+	{
+	public:
+		explicit NeighbourLists(const NeighbourListPolicy& policy) : Policy(policy) {}
+
+		bool Enabled() const { return Policy.Skin > 0.0f; }
+		const NeighbourListPolicy& GetPolicy() const { return Policy; }
+
+		// grows with the flocker set's slot capacity
+		void Resize(int numSlots);
+		// a new bird in a reused slot
+		void Reset(int slot);
+
+		NeighbourList& At(int slot) { return Lists[slot]; }
+
+		bool NeedsRebuild(const NeighbourList& list, const FlockTransform& transform) const;
+		void Rebuild(NeighbourList& list, const TBuckets& spatialGrid, const WorldSnapshot& world, int ient, float searchRange) const;
+
+	private:
+		NeighbourListPolicy Policy;
+		std::vector<NeighbourList> Lists;
+	};
+
+	// the same contract as forAllEntitiesWithinRadius, over a bird's list instead of the grid. Fixes up the indices of
+	// any candidates that have moved in the snapshot, and skips ones that have gone
+	template<typename TFunc>
+	void forAllListedWithinRadius(NeighbourList& list, const WorldSnapshot& world, const Sphere& sphere, TFunc&& func)
+	{
+		int nents = world.Size();
+		auto itEnd = list.Candidates.end();
+		for (auto itCand = list.Candidates.begin(); itCand != itEnd; ++itCand)
+		{
+			auto& cand = *itCand;
+			if (cand.second < 0 || cand.second >= nents || world.Ids[cand.second] != cand.first)
+			{
+				cand.second = world.IndexOf(cand.first);
+				if (cand.second < 0)
+				{
+					continue;
+				}
+			}
+
+			auto& transform = world.Transforms[cand.second];
+			if (sphereContains(sphere, transform.Local))
+			{
+				if (!func(cand.first, transform))
+				{
+					return;
+				}
+			}
+		}
+	}
+}
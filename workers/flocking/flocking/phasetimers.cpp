@@ -0,0 +1,127 @@
+#include "phasetimers.h"
+
+#include <string.h>
+
+#include <algorithm>
+
+namespace demoteam
+{
+	namespace
+	{
+		const char* g_phaseNames[NumTimedPhases] = { "ops", "cache", "grid", "flocking", "send" };
+		const float g_percentiles[] = { 50.0f, 90.0f, 99.0f };
+		const char* g_percentileNames[] = { "p50", "p90", "p99" };
+	}
+
+	//***************************************************************************************************************
+	int LatencyHistogram::BucketOf(unsigned long long microseconds)
+	{
+		if (microseconds < SubBuckets)
+		{
+			return static_cast<int>(microseconds);
+		}
+
+		int msb = 0;
+		for (auto v = microseconds; v > 1; v >>= 1)
+		{
+			++msb;
+		}
+		// msb >= 2 here; the two bits under it pick the sub bucket
+		int sub = static_cast<int>((microseconds >> (msb - 2)) & (SubBuckets - 1));
+		return std::min((msb - 1)*SubBuckets + sub, static_cast<int>(NumBuckets) - 1);
+	}
+
+	//***************************************************************************************************************
+	float LatencyHistogram::BucketMidMicroseconds(int ibucket)
+	{
+		if (ibucket < SubBuckets)
+		{
+			return static_cast<float>(ibucket);
+		}
+		int msb = ibucket / SubBuckets + 1;
+		int sub = ibucket % SubBuckets;
+		float low = static_cast<float>(1ULL << msb) * (1.0f + sub / static_cast<float>(SubBuckets));
+		float width = static_cast<float>(1ULL << msb) / SubBuckets;
+		return low + width*0.5f;
+	}
+
+	//***************************************************************************************************************
+	void LatencyHistogram::Record(long long microseconds)
+	{
+		auto us = microseconds > 0 ? static_cast<unsigned long long>(microseconds) : 0ULL;
+		++Buckets[BucketOf(us)];
+		++NumSamples;
+		MaxMicroseconds = std::max(MaxMicroseconds, static_cast<long long>(us));
+	}
+
+	//***************************************************************************************************************
+	void LatencyHistogram::Merge(const LatencyHistogram& other)
+	{
+		for (int ibucket = 0; ibucket < NumBuckets; ++ibucket)
+		{
+			Buckets[ibucket] += other.Buckets[ibucket];
+		}
+		NumSamples += other.NumSamples;
+		MaxMicroseconds = std::max(MaxMicroseconds, other.MaxMicroseconds);
+	}
+
+	//***************************************************************************************************************
+	void LatencyHistogram::Reset()
+	{
+		memset(Buckets, 0, sizeof(Buckets));
+		NumSamples = 0;
+		MaxMicroseconds = 0;
+	}
+
+	//***************************************************************************************************************
+	float LatencyHistogram::PercentileMs(float percentile) const
+	{
+		if (NumSamples == 0)
+		{
+			return 0.0f;
+		}
+
+		// rank of the sample we want, 1 based
+		long long rank = std::max(1LL, static_cast<long long>(NumSamples * percentile / 100.0f + 0.5f));
+		long long seen = 0;
+		for (int ibucket = 0; ibucket < NumBuckets; ++ibucket)
+		{
+			seen += Buckets[ibucket];
+			if (seen >= rank)
+			{
+				// never report more than we actually saw
+				return std::min(BucketMidMicroseconds(ibucket), static_cast<float>(MaxMicroseconds)) / 1000.0f;
+			}
+		}
+		return MaxMs();
+	}
+
+	//***************************************************************************************************************
+	void PhaseTimers::Collect(TGauges& gauges)
+	{
+		Phases[FlockingCompute].Reset();
+		for (auto itThread = ThreadCompute.begin(); itThread != ThreadCompute.end(); ++itThread)
+		{
+			Phases[FlockingCompute].Merge(*itThread);
+		}
+
+		for (int iphase = 0; iphase < NumTimedPhases; ++iphase)
+		{
+			auto& histogram = Phases[iphase];
+			std::string prefix = std::string("phase_") + g_phaseNames[iphase] + "_ms_";
+			for (int ipercentile = 0; ipercentile < 3; ++ipercentile)
+			{
+				gauges[prefix + g_percentileNames[ipercentile]] = histogram.PercentileMs(g_percentiles[ipercentile]);
+			}
+			gauges[prefix + "max"] = histogram.MaxMs();
+			histogram.Reset();
+		}
+
+		int numThreads = ThreadCompute.size();
+		for (int ithread = 0; ithread < numThreads; ++ithread)
+		{
+			gauges["phase_flocking_thread_" + std::to_string(ithread) + "_ms_p99"] = ThreadCompute[ithread].PercentileMs(99.0f);
+			ThreadCompute[ithread].Reset();
+		}
+	}
+}
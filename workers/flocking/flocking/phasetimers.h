@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace demoteam
+{
+	//------------------------------------------
+	// Log-scale microsecond buckets, four per power of two, so recording is a few integer ops and
+	// never allocates. Percentiles come back as the middle of their bucket: within ~10%.
+	class LatencyHistogram
+	{
+	public:
+		enum { SubBuckets = 4, NumBuckets = 26 * SubBuckets };	// up to ~60s
+
+		LatencyHistogram() { Reset(); }
+
+		void Record(long long microseconds);
+		void Merge(const LatencyHistogram& other);
+		void Reset();
+
+		long long Count() const { return NumSamples; }
+		float PercentileMs(float percentile) const;
+		float MaxMs() const { return MaxMicroseconds / 1000.0f; }
+
+	private:
+		static int BucketOf(unsigned long long microseconds);
+		static float BucketMidMicroseconds(int ibucket);
+
+		unsigned int Buckets[NumBuckets];
+		long long NumSamples;
+		long long MaxMicroseconds;
+	};
+
+	//------------------------------------------
+	class ScopedTimer
+	{
+	public:
+		typedef std::chrono::steady_clock TClock;
+
+		explicit ScopedTimer(LatencyHistogram& histogram) : Histogram(histogram), Start(TClock::now()) {}
+		~ScopedTimer()
+		{
+			Histogram.Record(std::chrono::duration_cast<std::chrono::microseconds>(TClock::now() - Start).count());
+		}
+
+	private:
+		ScopedTimer(const ScopedTimer&);
+		ScopedTimer& operator=(const ScopedTimer&);
+
+		LatencyHistogram& Histogram;
+		TClock::time_point Start;
+	};
+
+	enum TimedPhase
+	{
+		OpProcessing = 0,
+		CacheRefresh,
+		GridBuild,
+		FlockingCompute,	// one sample per thread per sub tick, see ThreadPhase
+		UpdateSend,
+		NumTimedPhases
+	};
+
+	typedef std::map<std::string, double> TGauges;
+
+	//------------------------------------------
+	// Everything but FlockingCompute is timed on the main thread. Each pool thread has its own compute
+	// histogram, only read while the pool is idle, so nothing here needs to be atomic.
+	class PhaseTimers
+	{
+	public:
+		explicit PhaseTimers(int numThreads) : ThreadCompute(numThreads) {}
+
+		LatencyHistogram& Phase(TimedPhase phase) { return Phases[phase]; }
+		LatencyHistogram& ThreadPhase(int threadId) { return ThreadCompute[threadId]; }
+
+		// phase_<name>_ms_p50/p90/p99/max, plus the p99 of each compute thread to show imbalance; then resets
+		void Collect(TGauges& gauges);
+
+	private:
+		LatencyHistogram Phases[NumTimedPhases];
+		std::vector<LatencyHistogram> ThreadCompute;
+	};
+}
@@ -0,0 +1,366 @@
+#include "recording.h"
+
+#include <string.h>
+
+#include <cstdint>
+
+namespace demoteam
+{
+	namespace
+	{
+		const char g_recordingMagic[8] = { 'F', 'L', 'O', 'C', 'K', 'R', 'E', 'C' };
+		const std::uint32_t g_recordingVersion = 1;
+		const size_t g_flushBytes = 1 << 20;
+		// what each entity and player in a frame takes up, for telling a count that can't be right before it's used
+		const long long g_entityRecordBytes = sizeof(TEntityId) + 3 * sizeof(double) + 6 * sizeof(float) + sizeof(char);
+		const long long g_playerRecordBytes = 3 * sizeof(double);
+
+		enum RecordType
+		{
+			AuthorityGainedRecord = 'A',
+			AuthorityLostRecord = 'L',
+			EntityRemovedRecord = 'R',
+			ParamsRecord = 'P',
+			FrameRecord = 'F'
+		};
+
+		//***************************************************************************************************************
+		unsigned long long fnv1a(unsigned long long hash, const void* data, size_t size)
+		{
+			auto bytes = static_cast<const unsigned char*>(data);
+			for (size_t c0 = 0; c0 < size; ++c0)
+			{
+				hash = (hash ^ bytes[c0]) * 1099511628211ULL;
+			}
+			return hash;
+		}
+	}
+
+	//***************************************************************************************************************
+	WorldRecorder::WorldRecorder() : File(nullptr), NumBytesWritten(0)
+	{
+	}
+
+	//***************************************************************************************************************
+	WorldRecorder::~WorldRecorder()
+	{
+		Close();
+	}
+
+	//***************************************************************************************************************
+	bool WorldRecorder::Open(const std::string& path)
+	{
+		Close();
+		File = fopen(path.c_str(), "wb");
+		if (File == nullptr)
+		{
+			printf("couldn't open %s for recording\n", path.c_str());
+			return false;
+		}
+
+		WrittenParams.clear();
+		NumBytesWritten = 0;
+		Buffer.insert(Buffer.end(), g_recordingMagic, g_recordingMagic + sizeof(g_recordingMagic));
+		Put(g_recordingVersion);
+		return true;
+	}
+
+	//***************************************************************************************************************
+	void WorldRecorder::Close()
+	{
+		if (File != nullptr)
+		{
+			Flush();
+			fclose(File);
+			File = nullptr;
+		}
+	}
+
+	//***************************************************************************************************************
+	template<class T> void WorldRecorder::Put(const T& value)
+	{
+		auto bytes = reinterpret_cast<const char*>(&value);
+		Buffer.insert(Buffer.end(), bytes, bytes + sizeof(T));
+	}
+
+	//***************************************************************************************************************
+	void WorldRecorder::PutEvent(char type, TEntityId entityId)
+	{
+		if (File != nullptr)
+		{
+			Put(type);
+			Put(entityId);
+		}
+	}
+
+	//***************************************************************************************************************
+	void WorldRecorder::Flush()
+	{
+		if (!Buffer.empty())
+		{
+			fwrite(&Buffer[0], 1, Buffer.size(), File);
+			NumBytesWritten += Buffer.size();
+			Buffer.clear();
+		}
+	}
+
+	//***************************************************************************************************************
+	void WorldRecorder::AuthorityGained(TEntityId entityId)
+	{
+		PutEvent(AuthorityGainedRecord, entityId);
+	}
+
+	//***************************************************************************************************************
+	void WorldRecorder::AuthorityLost(TEntityId entityId)
+	{
+		PutEvent(AuthorityLostRecord, entityId);
+	}
+
+	//***************************************************************************************************************
+	void WorldRecorder::EntityRemoved(TEntityId entityId)
+	{
+		PutEvent(EntityRemovedRecord, entityId);
+		WrittenParams.erase(entityId);
+	}
+
+	//***************************************************************************************************************
+	void WorldRecorder::Frame(const WorldSnapshot& world)
+	{
+		if (File == nullptr)
+		{
+			return;
+		}
+
+		int nents = world.Size();
+
+		// params first, so they're known by the time the frame is read back
+		for (int ient = 0; ient < nents; ++ient)
+		{
+			if (!world.HasParams[ient])
+			{
+				continue;
+			}
+			auto& params = world.Params[ient];
+			auto itWritten = WrittenParams.find(world.Ids[ient]);
+			if (itWritten == WrittenParams.end() || memcmp(&itWritten->second, &params, sizeof(FlockParams)) != 0)
+			{
+				Put(static_cast<char>(ParamsRecord));
+				Put(world.Ids[ient]);
+				Put(params);
+				WrittenParams[world.Ids[ient]] = params;
+			}
+		}
+
+		Put(static_cast<char>(FrameRecord));
+		Put(static_cast<std::int32_t>(nents));
+		for (int ient = 0; ient < nents; ++ient)
+		{
+			auto& transform = world.Transforms[ient];
+			Put(world.Ids[ient]);
+			Put(transform.Position.X());
+			Put(transform.Position.Y());
+			Put(transform.Position.Z());
+			Put(transform.Forward.X());
+			Put(transform.Forward.Y());
+			Put(transform.Forward.Z());
+			Put(transform.Velocity.X());
+			Put(transform.Velocity.Y());
+			Put(transform.Velocity.Z());
+			Put(world.HasParams[ient]);
+		}
+
+		Put(static_cast<std::int32_t>(world.Players.size()));
+		for (auto itPlayer = world.Players.begin(); itPlayer != world.Players.end(); ++itPlayer)
+		{
+			Put(itPlayer->X());
+			Put(itPlayer->Y());
+			Put(itPlayer->Z());
+		}
+
+		if (Buffer.size() >= g_flushBytes)
+		{
+			Flush();
+		}
+	}
+
+	//***************************************************************************************************************
+	WorldReplay::WorldReplay(FlockingSimulation& sim) : Sim(sim), File(nullptr), FileBytes(0), NumFramesRead(0), Corrupt(false), Checksum(14695981039346656037ULL), NumUpdatesSent(0)
+	{
+	}
+
+	//***************************************************************************************************************
+	WorldReplay::~WorldReplay()
+	{
+		if (File != nullptr)
+		{
+			fclose(File);
+		}
+	}
+
+	//***************************************************************************************************************
+	bool WorldReplay::Open(const std::string& path)
+	{
+		File = fopen(path.c_str(), "rb");
+		if (File == nullptr)
+		{
+			printf("couldn't open recording %s\n", path.c_str());
+			return false;
+		}
+		fseek(File, 0, SEEK_END);
+		FileBytes = ftell(File);
+		fseek(File, 0, SEEK_SET);
+
+		char magic[sizeof(g_recordingMagic)];
+		std::uint32_t version = 0;
+		if (fread(magic, 1, sizeof(magic), File) != sizeof(magic) || memcmp(magic, g_recordingMagic, sizeof(magic)) != 0 || !Get(version) || version != g_recordingVersion)
+		{
+			printf("%s is not a version %u flocking recording\n", path.c_str(), g_recordingVersion);
+			Corrupt = true;
+			return false;
+		}
+		return true;
+	}
+
+	//***************************************************************************************************************
+	template<class T> bool WorldReplay::Get(T& value)
+	{
+		if (fread(&value, sizeof(T), 1, File) != 1)
+		{
+			Corrupt = true;
+			return false;
+		}
+		return true;
+	}
+
+	//***************************************************************************************************************
+	bool WorldReplay::HasRoomFor(std::int32_t count, long long recordBytes)
+	{
+		if (count < 0 || count > (FileBytes - ftell(File)) / recordBytes)
+		{
+			Corrupt = true;
+			return false;
+		}
+		return true;
+	}
+
+	//***************************************************************************************************************
+	bool WorldReplay::AtEnd()
+	{
+		if (File == nullptr || Corrupt)
+		{
+			return true;
+		}
+		int next = fgetc(File);
+		if (next == EOF)
+		{
+			return true;
+		}
+		ungetc(next, File);
+		return false;
+	}
+
+	//***************************************************************************************************************
+	void WorldReplay::ReadWorld(WorldSnapshot& world)
+	{
+		// the events in front of the frame are what the view would have dispatched while processing its ops
+		char type;
+		while (!AtEnd() && Get(type))
+		{
+			TEntityId entityId;
+			switch (type)
+			{
+			case AuthorityGainedRecord:
+				if (Get(entityId)) Sim.OnAuthorityGained(entityId);
+				break;
+			case AuthorityLostRecord:
+				if (Get(entityId)) Sim.OnAuthorityLost(entityId);
+				break;
+			case EntityRemovedRecord:
+				if (Get(entityId))
+				{
+					Sim.OnEntityRemoved(entityId);
+					Params.erase(entityId);
+				}
+				break;
+			case ParamsRecord:
+			{
+				FlockParams params;
+				if (Get(entityId) && Get(params))
+				{
+					Params[entityId] = params;
+				}
+				break;
+			}
+			case FrameRecord:
+			{
+				std::int32_t nents = 0;
+				if (!Get(nents) || !HasRoomFor(nents, g_entityRecordBytes))
+				{
+					return;
+				}
+				world.Reserve(nents);
+				for (int ient = 0; ient < nents && !Corrupt; ++ient)
+				{
+					double px, py, pz;
+					float fx, fy, fz, vx, vy, vz;
+					char hasParams;
+					if (!(Get(entityId) && Get(px) && Get(py) && Get(pz) && Get(fx) && Get(fy) && Get(fz) && Get(vx) && Get(vy) && Get(vz) && Get(hasParams)))
+					{
+						break;
+					}
+					auto itParams = hasParams ? Params.find(entityId) : Params.end();
+					world.Add(entityId, FlockTransform(Coordinates(px, py, pz), Float4(fx, fy, fz), Float4(vx, vy, vz)), itParams != Params.end() ? &itParams->second : nullptr);
+				}
+
+				std::int32_t nplayers = 0;
+				if (!Get(nplayers) || !HasRoomFor(nplayers, g_playerRecordBytes))
+				{
+					return;
+				}
+				for (int iplayer = 0; iplayer < nplayers && !Corrupt; ++iplayer)
+				{
+					double px, py, pz;
+					if (Get(px) && Get(py) && Get(pz))
+					{
+						world.Players.push_back(Coordinates(px, py, pz));
+					}
+				}
+
+				++NumFramesRead;
+				return;
+			}
+			default:
+				printf("unknown record '%c' in recording\n", type);
+				Corrupt = true;
+				return;
+			}
+		}
+	}
+
+	//***************************************************************************************************************
+	void WorldReplay::SendTransformUpdate(TEntityId entityId, const FlockTransformUpdate& update)
+	{
+		++NumUpdatesSent;
+		Checksum = fnv1a(Checksum, &entityId, sizeof(entityId));
+		if (update.HasPosition)
+		{
+			double pos[3] = { update.Position.X(), update.Position.Y(), update.Position.Z() };
+			Checksum = fnv1a(Checksum, pos, sizeof(pos));
+		}
+		if (update.HasForward)
+		{
+			float fwd[3] = { update.Forward.X(), update.Forward.Y(), update.Forward.Z() };
+			Checksum = fnv1a(Checksum, fwd, sizeof(fwd));
+		}
+		if (update.HasVelocity)
+		{
+			float vel[3] = { update.Velocity.X(), update.Velocity.Y(), update.Velocity.Z() };
+			Checksum = fnv1a(Checksum, vel, sizeof(vel));
+		}
+		if (update.HasTargetVelocity)
+		{
+			float target[3] = { update.TargetVelocity.X(), update.TargetVelocity.Y(), update.TargetVelocity.Z() };
+			Checksum = fnv1a(Checksum, target, sizeof(target));
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdio.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "flocking.h"
+#include "simulation.h"
+
+namespace demoteam
+{
+	// Recordings hold what the simulation consumed from the view: authority changes and removals in the
+	// order the view delivered them, then the world as it was read on each frame boundary. Flock params
+	// are only written when they first appear or change. Host byte order, so replay on the same platform.
+
+	//------------------------------------------
+	class WorldRecorder
+	{
+	public:
+		WorldRecorder();
+		~WorldRecorder();
+
+		bool Open(const std::string& path);
+		bool IsOpen() const { return File != nullptr; }
+		void Close();
+
+		void AuthorityGained(TEntityId entityId);
+		void AuthorityLost(TEntityId entityId);
+		void EntityRemoved(TEntityId entityId);
+		void Frame(const WorldSnapshot& world);
+
+		long long BytesWritten() const { return NumBytesWritten; }
+
+	private:
+		WorldRecorder(const WorldRecorder&);
+		WorldRecorder& operator=(const WorldRecorder&);
+
+		template<class T> void Put(const T& value);
+		void PutEvent(char type, TEntityId entityId);
+		void Flush();
+
+		FILE* File;
+		std::vector<char> Buffer;
+		std::unordered_map<TEntityId, FlockParams> WrittenParams;
+		long long NumBytesWritten;
+	};
+
+	//------------------------------------------
+	// plays a recording back into a simulation in place of the connection; no pacing, no network
+	class WorldReplay : public IFlockingHost
+	{
+	public:
+		explicit WorldReplay(FlockingSimulation& sim);
+		~WorldReplay();
+
+		bool Open(const std::string& path);
+		// true once there are no frames left to read
+		bool AtEnd();
+		int FramesRead() const { return NumFramesRead; }
+		bool Failed() const { return Corrupt; }
+
+		virtual void ReadWorld(WorldSnapshot& world);
+		virtual void SendTransformUpdate(TEntityId entityId, const FlockTransformUpdate& update);
+
+		// hash of everything sent, in order; equal between runs means the output was identical
+		unsigned long long UpdateChecksum() const { return Checksum; }
+		long long UpdatesSent() const { return NumUpdatesSent; }
+
+	private:
+		WorldReplay(const WorldReplay&);
+		WorldReplay& operator=(const WorldReplay&);
+
+		template<class T> bool Get(T& value);
+		// false, and the recording's corrupt, unless there's room left in the file for count records of this size
+		bool HasRoomFor(std::int32_t count, long long recordBytes);
+
+		FlockingSimulation& Sim;
+		FILE* File;
+		long long FileBytes;
+		std::unordered_map<TEntityId, FlockParams> Params;
+		int NumFramesRead;
+		bool Corrupt;
+		unsigned long long Checksum;
+		long long NumUpdatesSent;
+	};
+}
@@ -0,0 +1,100 @@
+#include "scheduler.h"
+
+#include <algorithm>
+
+namespace demoteam
+{
+	//***************************************************************************************************************
+	FlockScheduler::FlockScheduler(const SchedulePolicy& policy) : Policy(policy)
+	{
+		Policy.NumPhases = std::max(Policy.NumPhases, 1);
+		Policy.MaxTier = std::min(std::max(Policy.MaxTier, 0), 8);
+	}
+
+	//***************************************************************************************************************
+	bool FlockScheduler::IsDue(TEntityId entityId, int frame, const FlockerSchedule& schedule) const
+	{
+		int period = 1 << schedule.Tier;
+
+		// birds in the same tier are spread over its frames by id, so the tiers don't all land on the same frame.
+		// Anything that has waited far too long (tier just went up) goes regardless.
+		auto offset = static_cast<int>((entityId / Policy.NumPhases) % period);
+		return ((frame + offset) % period) == 0 || frame - schedule.LastFrame >= 2 * period;
+	}
+
+	//***************************************************************************************************************
+	void FlockScheduler::BuildWorkList(int frame, int phase, const std::vector<TEntityId>& flockers, TScheduledFlockers& work)
+	{
+		work.clear();
+
+		int nflockers = flockers.size();
+		for (int iflock = 0; iflock < nflockers; ++iflock)
+		{
+			auto entityId = flockers[iflock];
+			if (static_cast<int>(entityId % Policy.NumPhases) != phase)
+			{
+				continue;
+			}
+
+			auto itSchedule = Schedules.find(entityId);
+			if (itSchedule == Schedules.end())
+			{
+				FlockerSchedule schedule = { 0, frame - 1 };
+				itSchedule = Schedules.insert(std::make_pair(entityId, schedule)).first;
+			}
+
+			auto& schedule = itSchedule->second;
+			if (IsDue(entityId, frame, schedule))
+			{
+				ScheduledFlocker scheduled = { iflock, static_cast<float>(std::max(frame - schedule.LastFrame, 1)) };
+				work.push_back(scheduled);
+			}
+		}
+	}
+
+	//***************************************************************************************************************
+	void FlockScheduler::Stepped(TEntityId entityId, int frame, const Coordinates& pos, int numCandidates, const TInterestPoints& players)
+	{
+		auto itSchedule = Schedules.find(entityId);
+		if (itSchedule == Schedules.end())
+		{
+			return;
+		}
+
+		int tier = 0;
+		if (Policy.SparseCandidateCount > 0 && numCandidates < Policy.SparseCandidateCount)
+		{
+			++tier;
+		}
+		if (Policy.FarFromPlayerDistance > 0.0f)
+		{
+			auto maxSqrDist = sqr(Policy.FarFromPlayerDistance);
+			bool nearPlayer = std::any_of(players.begin(), players.end(), [&pos, maxSqrDist](const Coordinates& player)
+			{
+				return sqrMag(player - pos) < maxSqrDist;
+			});
+			if (!nearPlayer)
+			{
+				++tier;
+			}
+		}
+
+		itSchedule->second.Tier = std::min(tier, Policy.MaxTier);
+		itSchedule->second.LastFrame = frame;
+	}
+
+	//***************************************************************************************************************
+	void FlockScheduler::Forget(TEntityId entityId)
+	{
+		Schedules.erase(entityId);
+	}
+
+	//***************************************************************************************************************
+	int FlockScheduler::CountInTier(int tier) const
+	{
+		return std::count_if(Schedules.begin(), Schedules.end(), [tier](const std::pair<const TEntityId, FlockerSchedule>& schedule)
+		{
+			return schedule.second.Tier == tier;
+		});
+	}
+}
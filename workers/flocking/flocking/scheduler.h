@@ -0,0 +1,58 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "flocking.h"
+
+namespace demoteam
+{
+	//------------------------------------------
+	struct SchedulePolicy
+	{
+		int NumPhases;					// sub-ticks per frame, every bird belongs to exactly one of them
+		int MaxTier;					// a tier t bird is stepped every 2^t frames
+		int SparseCandidateCount;		// fewer candidates than this puts a bird up a tier (0 = off)
+		float FarFromPlayerDistance;	// further than this from every player puts a bird up a tier (0 = off)
+	};
+
+	//------------------------------------------
+	struct ScheduledFlocker
+	{
+		int FlockerIndex;
+		float TimeScale;	// how many frames' worth of time to step
+	};
+
+	typedef std::vector<ScheduledFlocker> TScheduledFlockers;
+
+	//------------------------------------------
+	class FlockScheduler
+	{
+	public:
+		explicit FlockScheduler(const SchedulePolicy& policy);
+
+		int NumPhases() const { return Policy.NumPhases; }
+
+		// the flockers due in this phase of this frame
+		void BuildWorkList(int frame, int phase, const std::vector<TEntityId>& flockers, TScheduledFlockers& work);
+
+		// after a bird has been stepped; picks the tier for its next step
+		void Stepped(TEntityId entityId, int frame, const Coordinates& pos, int numCandidates, const TInterestPoints& players);
+
+		void Forget(TEntityId entityId);
+
+		int CountInTier(int tier) const;
+
+	private:
+		struct FlockerSchedule
+		{
+			int Tier;
+			int LastFrame;
+		};
+
+		bool IsDue(TEntityId entityId, int frame, const FlockerSchedule& schedule) const;
+
+		SchedulePolicy Policy;
+		std::unordered_map<TEntityId, FlockerSchedule> Schedules;
+	};
+}
@@ -0,0 +1,554 @@
+#include "simulation.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "cpudispatch.h"
+#include "logging.h"
+#include "tracing.h"
+
+namespace demoteam
+{
+	namespace
+	{
+		const int g_maxLoadBufEntries = 16;
+		// how many times an idle pool thread yields before it blocks until there's work
+		const int g_idleSpinsBeforeBlocking = 1000;
+
+		const SimulationConfig g_defaultConfig =
+		{
+			8,		// TargetFPS
+			8,		// NumThreads
+			{
+				4,		// NumPhases
+				2,		// MaxTier
+				1,		// SparseCandidateCount
+				0.0f	// FarFromPlayerDistance
+			},
+			{
+				true,	// Enabled
+				0.25f,	// Smoothing
+				0.85f,	// RaiseAtLoad
+				3,		// OverrunsToRaise
+				0.5f,	// LowerAtLoad
+				16,		// TicksToLower
+				64,		// CandidateCap
+				0.5f,	// NeighbourScale
+				0.25f	// SkipFraction
+			},
+			// receivers only extrapolate if they know to, so dead reckoning is opt-in
+			ThresholdUpdates,
+			{
+				0.01f,	// Position
+				0.001f,	// Forward
+				0.01f,	// Velocity
+				0.25f,	// DeadReckoningDrift
+				0.0f,	// PositionQuantum
+				0.0f,	// VectorQuantum
+				2.0f,	// MaxSilenceSeconds
+				0.25f	// SteeringSeconds
+			},
+			false,	// CompactNeighbours
+			{
+				0.0f,	// Range
+				0.5f	// Theta
+			},
+			{
+				0.0f,	// Skin
+				4.0f	// RebuildFrames
+			},
+			{
+				g_gridCellSize,		// CellSize
+				g_gridHalfExtent	// HalfExtent
+			},
+			false,	// LocalOrigin
+			g_maxNeighbours,	// MaxNeighbours
+			"",			// ConfinementPath
+			"",			// SnapshotPath
+			{
+				10.0f,	// SaveEverySeconds
+				80		// GraceFrames
+			},
+			{
+				3.0f	// PeriodSeconds, as FlockingStats samples
+			}
+		};
+	}
+
+	//***************************************************************************************************************
+	SimulationConfig DefaultSimulationConfig()
+	{
+		return g_defaultConfig;
+	}
+
+	//***************************************************************************************************************
+	FlockingSimulation::FlockingSimulation(const SimulationConfig& config) :
+		Config(config),
+		UpdateFilter(config.UpdateMode, config.UpdateThresholds),
+		Scheduler(config.Schedule),
+		FrameBudget(config.FrameBudget),
+		Limits(FrameBudget.Limits()),
+		Arena(config.NumThreads),
+		CandidateLists(config.NeighbourLists),
+		Stats(config.BirdStats),
+		SubTick(0),
+		LastTickTime(0.0),
+		TickHost(nullptr),
+		TickFrame(0),
+		Batches(config.NumThreads),
+		ThreadUpdateStats(config.NumThreads),
+		LoadBuf(g_maxLoadBufEntries, 0.0f),
+		LoadBufHead(g_maxLoadBufEntries - 1),
+		PhaseTiming(config.NumThreads),
+		TotalBirdSteps(0),
+		TotalUpdatesSent(0),
+		WorkStatus(0),
+		Stopping(false)
+	{
+		Flockers.Reserve(2048);
+		FlockersUpdate.resize(2048);
+		CandidateLists.Resize(2048);
+		Stats.Resize(2048);
+		UpdateFilter.Resize(2048);
+
+		// initialise the worker thread pool
+		for (int c0 = 0; c0 < Config.NumThreads; ++c0)
+		{
+			Threads.push_back(std::thread([this, c0]() { ThreadMain(c0); }));
+		}
+	}
+
+	//***************************************************************************************************************
+	FlockingSimulation::~FlockingSimulation()
+	{
+		{
+			std::lock_guard<std::mutex> lock(WorkMutex);
+			Stopping.store(true);
+		}
+		WorkReady.notify_all();
+		for (auto itThread = Threads.begin(); itThread != Threads.end(); ++itThread)
+		{
+			itThread->join();
+		}
+	}
+
+	//***************************************************************************************************************
+	void FlockingSimulation::OnAuthorityGained(TEntityId entityId)
+	{
+		if (Flockers.Add(entityId))
+		{
+			if (Flockers.SlotCapacity() > static_cast<int>(FlockersUpdate.size()))
+			{
+				FlockersUpdate.resize(Flockers.SlotCapacity());
+				CandidateLists.Resize(Flockers.SlotCapacity());
+				Stats.Resize(Flockers.SlotCapacity());
+				UpdateFilter.Resize(Flockers.SlotCapacity());
+			}
+			FlockersUpdate[Flockers.SlotOf(entityId)] = SUpdateUpdate();
+			CandidateLists.Reset(Flockers.SlotOf(entityId));
+			UpdateFilter.Forget(Flockers.SlotOf(entityId));
+			Stats.Reset(Flockers.SlotOf(entityId), entityId, LastTickTime);
+		}
+	}
+
+	//***************************************************************************************************************
+	bool FlockingSimulation::LoadConfinementField(const std::string& path)
+	{
+		ConfinementField field;
+		if (!field.Load(path))
+		{
+			return false;
+		}
+		Confinement = field;
+		logging::Log(logging::Info, "FlockingWorker", "loaded confinement field, kb", Confinement.Bytes() / 1024);
+		return true;
+	}
+
+	//***************************************************************************************************************
+	bool FlockingSimulation::LoadConfiguredConfinementField()
+	{
+		if (!Config.ConfinementPath.empty())
+		{
+			return LoadConfinementField(Config.ConfinementPath);
+		}
+		const char* path = getenv("FLOCKING_CONFINEMENT");
+		return path == nullptr || path[0] == 0 || LoadConfinementField(path);
+	}
+
+	//***************************************************************************************************************
+	void FlockingSimulation::OnAuthorityLost(TEntityId entityId)
+	{
+		Stats.Forget(Flockers.SlotOf(entityId));
+		UpdateFilter.Forget(Flockers.SlotOf(entityId));
+		Flockers.Remove(entityId);
+		Scheduler.Forget(entityId);
+	}
+
+	//***************************************************************************************************************
+	void FlockingSimulation::OnEntityRemoved(TEntityId entityId)
+	{
+		OnAuthorityLost(entityId);
+	}
+
+	//***************************************************************************************************************
+	void FlockingSimulation::ResendInFull(TEntityId entityId)
+	{
+		UpdateFilter.Forget(Flockers.SlotOf(entityId));
+	}
+
+	//***************************************************************************************************************
+	bool FlockingSimulation::SaveSnapshot(const std::string& path) const
+	{
+		return WriteFlockSnapshot(path, World, Flockers, FrameCount());
+	}
+
+	//***************************************************************************************************************
+	long long FlockingSimulation::MicrosecondsPerSubTick() const
+	{
+		return 1000000LL / Config.TargetFPS / Scheduler.NumPhases();
+	}
+
+	//***************************************************************************************************************
+	void FlockingSimulation::KeepOwnTransforms()
+	{
+		// the host only hears our birds' keyframes, so between them it's our own last step that's current
+		int nflockers = Flockers.Size();
+		for (int iflock = 0; iflock < nflockers; ++iflock)
+		{
+			auto& flockUp = FlockersUpdate[Flockers.SlotAt(iflock)];
+			int ient = World.IndexOf(Flockers.IdAt(iflock));
+			if (flockUp.stepped && ient >= 0)
+			{
+				World.Set(ient, FlockTransform(flockUp.pos, flockUp.facing, flockUp.velocity));
+			}
+		}
+	}
+
+	//***************************************************************************************************************
+	void FlockingSimulation::FollowFlock()
+	{
+		// the centroid is summed in doubles; it's the one place a far flock's positions get added together
+		double x = 0.0, y = 0.0, z = 0.0;
+		int numBirds = 0;
+		for (int ient = 0; ient < World.Size(); ++ient)
+		{
+			if (World.HasParams[ient])
+			{
+				auto& position = World.Transforms[ient].Position;
+				x += position.X();
+				y += position.Y();
+				z += position.Z();
+				++numBirds;
+			}
+		}
+
+		if (numBirds == 0)
+		{
+			World.Rebase(World.Origin);
+			return;
+		}
+
+		// only moved once the flock has drifted a good way, and then onto a cell boundary, so the cells the birds
+		// fall into don't shift under them every frame
+		Coordinates centroid(x / numBirds, y / numBirds, z / numBirds);
+		const float maxDrift = Config.Grid.HalfExtent * 0.25f;
+		if (!World.Rebased || sqrMag(centroid - World.Origin) > sqr(maxDrift))
+		{
+			const double cellSize = Config.Grid.CellSize;
+			World.Rebase(Coordinates(
+				floor(centroid.X() / cellSize) * cellSize,
+				floor(centroid.Y() / cellSize) * cellSize,
+				floor(centroid.Z() / cellSize) * cellSize));
+		}
+	}
+
+	//***************************************************************************************************************
+	void FlockingSimulation::ThreadMain(int threadId)
+	{
+		const int numThreadsLocal = Config.NumThreads;
+		const float secondsPerFrame = 1.0f / Config.TargetFPS;
+		tracing::SetThreadName("flocking pool");
+
+		// sub ticks come close together, so yield for a while before blocking, which costs a wake up
+		int idleSpins = 0;
+		while (!Stopping.load())
+		{
+			// wait for work
+			int flag = 1 << threadId;
+			if ((WorkStatus.load()&flag)!=0)
+			{
+				// choose what to take based on the threadId and the size of this sub tick's work
+				int nwork = Work.size();
+				if (nwork < numThreadsLocal)
+				{
+					// do them all
+					if (threadId == 0)
+					{
+						ScopedTimer timer(PhaseTiming.ThreadPhase(threadId));
+						tracing::Scope trace("UpdateFlocking", nwork);
+						UpdateFlocking(Flockers, FlockersUpdate, Work, World, SpatialGrid, 0, nwork, Limits, secondsPerFrame, Arena.Thread(threadId), FarField.IsBuilt() ? &FarField : nullptr, CandidateLists.Enabled() ? &CandidateLists : nullptr, &Confinement);
+						FinishSteps(threadId, 0, nwork);
+					}
+				}
+				else
+				{
+					int ndiv = nwork/ numThreadsLocal;
+					int ntakeTotal = ndiv*numThreadsLocal;
+					int ntakeDiff = nwork - ntakeTotal;
+
+					int ibegin = threadId*ndiv;
+					int ntake = ndiv + ((threadId == (numThreadsLocal - 1)) ? ntakeDiff : 0);
+
+					ScopedTimer timer(PhaseTiming.ThreadPhase(threadId));
+					tracing::Scope trace("UpdateFlocking", ntake);
+					UpdateFlocking(Flockers, FlockersUpdate, Work, World, SpatialGrid, ibegin, ibegin+ ntake, Limits, secondsPerFrame, Arena.Thread(threadId), FarField.IsBuilt() ? &FarField : nullptr, CandidateLists.Enabled() ? &CandidateLists : nullptr, &Confinement);
+					FinishSteps(threadId, ibegin, ibegin + ntake);
+				}
+
+				int expected;
+				int newFlag;
+				do
+				{
+					std::this_thread::yield();
+					expected = WorkStatus.load();
+					newFlag = expected & (~flag);
+				}
+				while (!WorkStatus.compare_exchange_strong(expected, newFlag));
+
+			}
+			else if (++idleSpins < g_idleSpinsBeforeBlocking)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			else
+			{
+				std::unique_lock<std::mutex> lock(WorkMutex);
+				WorkReady.wait(lock, [this, flag]() { return (WorkStatus.load() & flag) != 0 || Stopping.load(); });
+			}
+			idleSpins = 0;
+		}
+	}
+
+	//***************************************************************************************************************
+	void FlockingSimulation::FinishSteps(int threadId, int ibegin, int iend)
+	{
+		// everything after the step that's only about the bird itself: slots are the thread's own, and the
+		// scheduler's entries are only looked up
+		tracing::Scope trace("FilterUpdates", iend - ibegin);
+		auto& batch = Batches[threadId];
+		batch.Begin = ibegin;
+		TransformUpdateStats updateStats;
+		for (int iwork = ibegin; iwork < iend; ++iwork)
+		{
+			int iflock = Work[iwork].FlockerIndex;
+			int slot = Flockers.SlotAt(iflock);
+			auto entId = Flockers.IdAt(iflock);
+			auto& flockUp = FlockersUpdate[slot];
+			if (!flockUp.stepped)
+			{
+				continue;
+			}
+
+			++batch.Steps;
+			if (Stats.Enabled())
+			{
+				Stats.Add(slot, flockUp.numCandidates, flockUp.stepNanoseconds);
+			}
+			Scheduler.Stepped(entId, TickFrame, flockUp.pos, flockUp.numCandidates, World.Players);
+
+			// leaving out whatever hasn't changed enough to matter
+			auto& pending = Pending[ibegin + batch.Count];
+			pending.Update = FlockTransformUpdate();
+			if (UpdateFilter.Filter(slot, flockUp.pos, flockUp.facing, flockUp.velocity, LastTickTime, pending.Update, updateStats))
+			{
+				pending.EntityId = entId;
+				++batch.Count;
+			}
+		}
+		ThreadUpdateStats[threadId].Add(updateStats);
+
+		if (batch.Count > 0)
+		{
+			tracing::Scope traceEncode("PrepareUpdates", batch.Count);
+			TickHost->PrepareTransformUpdates(threadId, &Pending[ibegin], batch.Count);
+		}
+	}
+
+	//***************************************************************************************************************
+	void FlockingSimulation::Tick(IFlockingHost& host, double time)
+	{
+		auto tickStart = std::chrono::steady_clock::now();
+
+		int phase = SubTick % Scheduler.NumPhases();
+		int frame = SubTick / Scheduler.NumPhases();
+		long long subTick = SubTick++;
+		LastTickTime = time;
+
+		tracing::Scope traceTick("SubTick", phase);
+
+		// the world and the grid only change on frame boundaries, so the sub ticks in between can share them
+		if (phase == 0)
+		{
+			{
+				tracing::Scope trace("ReadWorld");
+				World.Clear();
+				host.ReadWorld(World);
+				if (Config.UpdateMode == SteeringUpdates)
+				{
+					KeepOwnTransforms();
+				}
+				if (Config.LocalOrigin)
+				{
+					FollowFlock();
+				}
+			}
+
+			// nothing from last frame is in use now: the pool is idle and the grid is about to be rebuilt
+			SpatialGrid.clear();
+			Arena.Reset();
+
+#ifdef USE_PARTITIONING
+			ScopedTimer timer(PhaseTiming.Phase(GridBuild));
+			tracing::Scope trace("BuildSpatialGrid", World.Size());
+			BuildSpatialGrid(SpatialGrid, World, Arena.Shared(), Config.Grid);
+			if (Config.CompactNeighbours)
+			{
+				BuildCompactCells(SpatialGrid, World, Arena.Shared());
+			}
+			if (Config.FarField.Range > 0.0f)
+			{
+				FarField.Build(SpatialGrid, World, Config.FarField, Arena.Shared(), Config.Grid);
+			}
+#endif // USE_PARTITIONING
+		}
+
+		{
+			tracing::Scope trace("BuildWorkList");
+			Scheduler.BuildWorkList(frame, phase, Flockers.Ids(), Work);
+			FrameBudget.TrimWork(Work);
+			Limits = FrameBudget.Limits();
+			Limits.MaxNeighbours = Config.MaxNeighbours;
+			Limits.TimeEachBird = Stats.Enabled();
+
+			// only grows, so it settles after the first few frames
+			if (Pending.size() < Work.size())
+			{
+				Pending.resize(Work.size());
+			}
+			for (auto itBatch = Batches.begin(); itBatch != Batches.end(); ++itBatch)
+			{
+				itBatch->Begin = 0;
+				itBatch->Count = 0;
+				itBatch->Steps = 0;
+			}
+			TickHost = &host;
+			TickFrame = frame;
+		}
+
+		{
+			tracing::Scope trace("WaitForPool", Work.size());
+
+			// tell threads: It's time.
+			const int allFlags = (1 << Config.NumThreads) - 1;
+			{
+				std::lock_guard<std::mutex> lock(WorkMutex);
+				WorkStatus.store(allFlags);
+			}
+			WorkReady.notify_all();
+
+			// wait for threads
+			while (WorkStatus.load() != 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		// the pool has filtered and encoded them, so all that's left is handing them over
+		{
+			ScopedTimer sendTimer(PhaseTiming.Phase(UpdateSend));
+			tracing::Scope trace("SendUpdates");
+			for (int ithread = 0; ithread < Config.NumThreads; ++ithread)
+			{
+				auto& batch = Batches[ithread];
+				TotalBirdSteps += batch.Steps;
+				TotalUpdatesSent += batch.Count;
+				if (batch.Count > 0)
+				{
+					host.SendPreparedTransformUpdates(ithread, &Pending[batch.Begin], batch.Count);
+				}
+			}
+
+			if (Stats.Enabled())
+			{
+				const int subTicksPerPeriod = std::max(static_cast<int>(Config.BirdStats.PeriodSeconds * Config.TargetFPS * Scheduler.NumPhases() + 0.5f), 1);
+				Stats.SendDue(subTick, subTicksPerPeriod, time, [&host](TEntityId entityId, const BirdStatsSummary& summary)
+				{
+					host.SendBirdStats(entityId, summary);
+				});
+			}
+		}
+
+		auto microsElapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tickStart).count();
+
+		auto load = microsElapsed * 1.0f / MicrosecondsPerSubTick();
+		SubTickTiming.Record(microsElapsed);
+
+		LoadBufHead = (LoadBufHead + 1) % g_maxLoadBufEntries;
+		LoadBuf[LoadBufHead] = load;
+
+		if (FrameBudget.Record(load))
+		{
+			logging::Log(logging::Warn, "FlockingWorker", "degradation level changed", FrameBudget.Level());
+		}
+	}
+
+	//***************************************************************************************************************
+	float FlockingSimulation::CollectMetrics(TGauges& gauges)
+	{
+		TransformUpdateStats updateStats;
+		for (auto itStats = ThreadUpdateStats.begin(); itStats != ThreadUpdateStats.end(); ++itStats)
+		{
+			updateStats.Add(*itStats);
+			*itStats = TransformUpdateStats();
+		}
+		gauges["transform_updates_sent"] = static_cast<double>(updateStats.Sent);
+		gauges["steering_updates_sent"] = static_cast<double>(updateStats.SteeringSent);
+		gauges["transform_updates_suppressed"] = static_cast<double>(updateStats.Suppressed);
+		gauges["transform_fields_omitted"] = static_cast<double>(updateStats.FieldsOmitted);
+		gauges["transform_bytes_saved"] = static_cast<double>(updateStats.BytesSaved);
+
+		// tail latency of the sub ticks is what the scheduling policy is meant to flatten
+		if (SubTickTiming.Count() > 0)
+		{
+			gauges["subtick_ms_p99"] = SubTickTiming.PercentileMs(99.0f);
+			gauges["subtick_ms_max"] = SubTickTiming.MaxMs();
+			SubTickTiming.Reset();
+		}
+
+		PhaseTiming.Collect(gauges);
+
+		gauges["frame_arena_kb"] = Arena.BytesReserved() / 1024.0;
+
+		// which steering kernel this host ended up on; see IsaLevel
+		gauges["kernel_isa_level"] = KernelIsaLevel();
+
+		gauges["degradation_level"] = FrameBudget.Level();
+		gauges["smoothed_tick_load"] = FrameBudget.SmoothedLoad();
+
+		for (int tier = 0; tier <= Config.Schedule.MaxTier; ++tier)
+		{
+			gauges["flockers_tier_" + std::to_string(tier)] = Scheduler.CountInTier(tier);
+		}
+
+		auto sumLoad = 0.0f;
+		for (auto ibuf = 0; ibuf < g_maxLoadBufEntries; ++ibuf)
+		{
+			sumLoad += LoadBuf[ibuf];
+		}
+		return sumLoad / g_maxLoadBufEntries;
+	}
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "birdstats.h"
+#include "confinementfield.h"
+#include "flocking.h"
+#include "flockerset.h"
+#include "farfield.h"
+#include "framearena.h"
+#include "framebudget.h"
+#include "neighbourlists.h"
+#include "phasetimers.h"
+#include "scheduler.h"
+#include "spatialgrid.h"
+#include "steering.h"
+#include "updatefilter.h"
+#include "warmstart.h"
+
+namespace demoteam
+{
+	//------------------------------------------
+	// what the simulation needs from whoever is hosting it: a SpatialOS connection, or a local stand-in
+	class IFlockingHost
+	{
+	public:
+		virtual ~IFlockingHost() {}
+
+		// everything currently in view; only called on frame boundaries
+		virtual void ReadWorld(WorldSnapshot& world) = 0;
+		// with SteeringUpdates, most of these carry only a TargetVelocity
+		virtual void SendTransformUpdate(TEntityId entityId, const FlockTransformUpdate& update) = 0;
+		// Called on the pool, as each thread finishes its share of a sub tick, with the updates from it that are
+		// going out: a host can turn them into whatever it sends here, into buffers of threadId's own, while the
+		// other threads do the same. Nothing is sent until every thread is done
+		virtual void PrepareTransformUpdates(int /*threadId*/, const PendingTransformUpdate* /*updates*/, int /*count*/) {}
+		// then on the main thread, each thread's in turn, in the order they were stepped
+		virtual void SendPreparedTransformUpdates(int /*threadId*/, const PendingTransformUpdate* updates, int count)
+		{
+			for (int iupdate = 0; iupdate < count; ++iupdate)
+			{
+				SendTransformUpdate(updates[iupdate].EntityId, updates[iupdate].Update);
+			}
+		}
+		// a bird's totals for its last sample period; hosts with nowhere to put them can leave this be
+		virtual void SendBirdStats(TEntityId /*entityId*/, const BirdStatsSummary& /*summary*/) {}
+	};
+
+	// the pool hands out work with a bit per thread
+	const int g_maxSimulationThreads = 30;
+
+	//------------------------------------------
+	struct SimulationConfig
+	{
+		int TargetFPS;
+		int NumThreads;			// up to g_maxSimulationThreads
+		SchedulePolicy Schedule;
+		FrameBudgetPolicy FrameBudget;
+		TransformUpdateMode UpdateMode;
+		TransformUpdateThresholds UpdateThresholds;
+		// search packed, quantised copies of the cells rather than the snapshot; see CompactFlocker for what it costs
+		bool CompactNeighbours;
+		// attraction and follow out past SearchRange, over per-cell aggregates. A walk per bird on top of the neighbour
+		// search, so it costs more the further it reaches; Range 0 leaves it off
+		FarFieldPolicy FarField;
+		// per-bird candidate lists that last a few frames, in place of a grid query every step; Skin 0 leaves them off
+		NeighbourListPolicy NeighbourLists;
+		GridLayout Grid;
+		// keep the snapshot's origin near the flock and search and steer in floats about it, so the flock behaves the
+		// same far from the world origin as near it
+		bool LocalOrigin;
+		// caps every bird's number_to_consider, up to g_maxNeighbours
+		int MaxNeighbours;
+		// a baked confinement field to load in place of the built in bounds; empty for none
+		std::string ConfinementPath;
+		// where the worker keeps a snapshot to warm start from; empty for none
+		std::string SnapshotPath;
+		WarmStartPolicy WarmStart;
+		// per bird candidate counts and compute time, summed and sent to the host once a period
+		BirdStatsPolicy BirdStats;
+	};
+
+	SimulationConfig DefaultSimulationConfig();
+
+	//------------------------------------------
+	class FlockingSimulation
+	{
+	public:
+		explicit FlockingSimulation(const SimulationConfig& config);
+		~FlockingSimulation();
+
+		void OnAuthorityGained(TEntityId entityId);
+		void OnAuthorityLost(TEntityId entityId);
+		void OnEntityRemoved(TEntityId entityId);
+		// the bird's next update goes out whole, as if it had never sent one
+		void ResendInFull(TEntityId entityId);
+
+		int NumPhases() const { return Scheduler.NumPhases(); }
+		long long MicrosecondsPerSubTick() const;
+		int NumFlockers() const { return Flockers.Size(); }
+		// replaces the built in bounds from the next tick; false, and the bounds stay as they were, if it won't load.
+		// Call it before the first tick, or between them
+		bool LoadConfinementField(const std::string& path);
+		// the config's ConfinementPath, or failing that FLOCKING_CONFINEMENT=<path>; false only if one was given and
+		// it won't load
+		bool LoadConfiguredConfinementField();
+		// the world as of the last frame boundary, and which of it we have authority over; see WriteFlockSnapshot
+		bool SaveSnapshot(const std::string& path) const;
+		// hosts time their own phases (ops, cache) into these too
+		PhaseTimers& Timers() { return PhaseTiming; }
+
+		// one sub tick; time is what the update filter measures silences against, in seconds
+		void Tick(IFlockingHost& host, double time);
+
+		// average load since the last call, plus the gauges that go out with it
+		float CollectMetrics(TGauges& gauges);
+
+		// totals since construction, for offline runs
+		long long FrameCount() const { return SubTick / Scheduler.NumPhases(); }
+		long long BirdSteps() const { return TotalBirdSteps; }
+		long long UpdatesSent() const { return TotalUpdatesSent; }
+
+	private:
+		FlockingSimulation(const FlockingSimulation&);
+		FlockingSimulation& operator=(const FlockingSimulation&);
+
+		void ThreadMain(int threadId);
+		void FinishSteps(int threadId, int ibegin, int iend);
+		void KeepOwnTransforms();
+		void FollowFlock();
+
+		SimulationConfig Config;
+
+		TFlockers Flockers;
+		TFlockersUpdate FlockersUpdate;
+		TransformUpdateFilter UpdateFilter;
+		FlockScheduler Scheduler;
+		// rather than stretching the time step when we fall behind, do less work per tick
+		FrameBudgetController FrameBudget;
+		FlockingLimits Limits;
+
+		WorldSnapshot World;
+		// per-frame scratch, the grid included; reset on frame boundaries so steady state never hits the heap
+		FrameArena Arena;
+		TBuckets SpatialGrid;
+		FarFieldTree FarField;
+		// indexed by flocker slot, and kept across frames
+		NeighbourLists CandidateLists;
+		BirdStats Stats;
+		// empty unless one was loaded
+		ConfinementField Confinement;
+		// each sub tick steps one phase's worth of the flock
+		TScheduledFlockers Work;
+		long long SubTick;
+		double LastTickTime;
+
+		//------------------------------------------
+		// what one pool thread made of its share of the sub tick: its updates are Pending[Begin, Begin + Count)
+		struct StepBatch
+		{
+			int Begin;
+			int Count;
+			long long Steps;
+		};
+		// the host and frame of the sub tick the pool is working on
+		IFlockingHost* TickHost;
+		int TickFrame;
+		// by work index; each thread packs the updates it's sending to the front of its own range
+		std::vector<PendingTransformUpdate> Pending;
+		std::vector<StepBatch> Batches;
+		std::vector<TransformUpdateStats> ThreadUpdateStats;
+
+		std::vector<float> LoadBuf;
+		int LoadBufHead;
+		LatencyHistogram SubTickTiming;
+		PhaseTimers PhaseTiming;
+
+		long long TotalBirdSteps;
+		long long TotalUpdatesSent;
+
+		// flocking thread pool
+		std::vector<std::thread> Threads;
+		std::atomic_int WorkStatus;
+		std::atomic_bool Stopping;
+		// idle threads block on this once they've yielded for a while; WorkStatus and Stopping are set under the mutex
+		std::mutex WorkMutex;
+		std::condition_variable WorkReady;
+	};
+}
@@ -0,0 +1,149 @@
+#include "spatialgrid.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <math.h>
+
+namespace demoteam
+{
+	namespace
+	{
+		const unsigned int maxBitsX = 11;
+		const unsigned int maxBitsY = 10;
+		const unsigned int maxBitsZ = 11;
+	}
+
+	//***************************************************************************************************************
+	unsigned int calcGridIndex(TFloat4Arg pos, const Aabb3& worldExtents, float gridSize)
+	{
+		Float4 gridIndices = (pos - worldExtents.LeftBottomBack)/gridSize;
+
+		// the division can round across a cell face; the box gridIndexToBox makes has the final say
+		auto axis = [gridSize](float index, float pos, float lo)
+		{
+			unsigned int id = index;
+			if (id > 0 && lo + id*gridSize > pos)
+			{
+				--id;
+			}
+			else if (lo + (id + 1)*gridSize <= pos)
+			{
+				++id;
+			}
+			return id;
+		};
+		unsigned int idX = axis(gridIndices.X(), pos.X(), worldExtents.LeftBottomBack.X());
+		unsigned int idY = axis(gridIndices.Y(), pos.Y(), worldExtents.LeftBottomBack.Y());
+		unsigned int idZ = axis(gridIndices.Z(), pos.Z(), worldExtents.LeftBottomBack.Z());
+
+		return idX + (idY << maxBitsX) + (idZ << (maxBitsX + maxBitsY));
+	}
+
+	//***************************************************************************************************************
+	Aabb3 gridIndexToBox(unsigned int gridIndex, const Aabb3& worldExtents, float gridSize)
+	{
+		unsigned int maskX = (1 << maxBitsX) - 1;
+		unsigned int maskY = (1 << maxBitsY) - 1;
+		unsigned int maskZ = (1 << maxBitsZ) - 1;
+		unsigned int offsetX = 0;
+		unsigned int offsetY = offsetX+maxBitsX;
+		unsigned int offsetZ = offsetY+maxBitsY;
+		unsigned int idX = (gridIndex >> offsetX)&maskX;
+		unsigned int idY = (gridIndex >> offsetY)&maskY;
+		unsigned int idZ = (gridIndex >> offsetZ)&maskZ;
+
+		return Aabb3(worldExtents.LeftBottomBack + Float4(idX, idY, idZ)*gridSize, worldExtents.LeftBottomBack + Float4(idX + 1, idY + 1, idZ + 1)*gridSize);
+	}
+
+	//***************************************************************************************************************
+	bool IsValidGridLayout(const GridLayout& layout)
+	{
+		if (!(layout.CellSize > 0.0f && layout.HalfExtent > 0.0f))
+		{
+			return false;
+		}
+		// y has the fewest
+		float cellsAcross = ceilf(2.0f * layout.HalfExtent / layout.CellSize);
+		return cellsAcross <= static_cast<float>(1 << std::min(maxBitsX, std::min(maxBitsY, maxBitsZ)));
+	}
+
+	//***************************************************************************************************************
+	void BuildSpatialGrid(TBuckets& buckets, const WorldSnapshot& world, ScratchArena& arena, const GridLayout& layout)
+	{
+		float len = layout.HalfExtent;
+		Aabb3 worldExtents(Float4(-len,-len,-len), Float4(len, len, len));
+		float gridSize = layout.CellSize;
+
+		int nents = world.Size();
+
+		// never more buckets than entities, and keeping the capacity means this only allocates when the world grows
+		buckets.reserve(nents);
+
+		// spatial partitioning test
+		for (int ient = 0; ient < nents; ++ient)
+		{
+			auto pos = world.Transforms[ient].Local;
+			auto gridIdx = calcGridIndex(pos, worldExtents, gridSize);
+
+			auto itBuck = std::find_if(buckets.begin(), buckets.end(), [gridIdx](const SpatialBucket* bucket) { return bucket->GridIndex == gridIdx;  });
+			if (itBuck == buckets.end())
+			{
+				// make a new one
+				auto box = gridIndexToBox(gridIdx, worldExtents, gridSize);
+				if (sqrDistanceToBox(box, pos) > 0.0f)
+				{
+					printf("placed entity in a box that does not well describe its position :(\n");
+				}
+				buckets.push_back(arena.New<SpatialBucket>(arena, gridIdx, box, world.Ids[ient], ient));
+			}
+			else
+			{
+				auto& bucketPtr = *itBuck;
+				bucketPtr->Entities.push_back(std::make_pair(world.Ids[ient], ient));
+			}
+		}
+	}
+
+	//***************************************************************************************************************
+	void BuildCompactCells(TBuckets& buckets, const WorldSnapshot& world, ScratchArena& arena)
+	{
+		for (auto itBuck = buckets.begin(); itBuck != buckets.end(); ++itBuck)
+		{
+			auto& buck = **itBuck;
+			int nents = buck.Entities.size();
+			auto compact = static_cast<CompactFlocker*>(arena.Allocate(sizeof(CompactFlocker) * nents, alignof(CompactFlocker)));
+
+			int icompact = 0;
+			for (auto itEnt = buck.Entities.begin(); itEnt != buck.Entities.end(); ++itEnt, ++icompact)
+			{
+				compact[icompact] = EncodeCompactFlocker(buck.Box, world.Transforms[itEnt->second], itEnt->second);
+			}
+			buck.Compact = compact;
+			buck.NumCompact = nents;
+		}
+	}
+
+	//***************************************************************************************************************
+	bool HasCompactCells(const TBuckets& buckets)
+	{
+		return !buckets.empty() && buckets.front()->Compact != nullptr;
+	}
+
+	//***************************************************************************************************************
+	int CountEntitiesWithinLinearSearch(const WorldSnapshot& world, TEntityId flockerId, TFloat4Arg pos, float r)
+	{
+		int nentitiesLinear = 0;
+
+		int nents = world.Size();
+		for (int ient = 0; ient < nents; ++ient)
+		{
+			if (world.Ids[ient] != flockerId && sqrMag(world.Transforms[ient].Local - pos) < sqr(r))
+			{
+				++nentitiesLinear;
+			}
+		}
+
+		return nentitiesLinear;
+	}
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <list>
+#include <vector>
+
+#include "compactflocker.h"
+#include "flocking.h"
+#include "framearena.h"
+#include "geometry.h"
+
+using namespace geometry;
+
+namespace demoteam
+{
+	// the grid BuildSpatialGrid lays out unless told otherwise: cubes this size, over +-g_gridHalfExtent on every axis
+	const float g_gridCellSize = 8.0f;
+	const float g_gridHalfExtent = 1000.0f;
+
+	//------------------------------------------
+	struct GridLayout
+	{
+		float CellSize;
+		float HalfExtent;
+	};
+
+	const GridLayout g_defaultGridLayout = { g_gridCellSize, g_gridHalfExtent };
+
+	typedef std::pair<TEntityId, int> TEntityStorage;
+	typedef std::list<TEntityStorage, ArenaAllocator<TEntityStorage> > TEntities;
+
+	//------------------------------------------
+	// lives in a frame arena along with its entity list, and is dropped rather than destroyed when that resets
+	struct SpatialBucket
+	{
+		SpatialBucket(ScratchArena& arena, unsigned int gridIdx, const Aabb3& box, TEntityId entId, int entIdx) : Entities(ArenaAllocator<TEntityStorage>(arena)), Box(box), GridIndex(gridIdx), IntersectionHelper(box, 18.0f), Compact(nullptr), NumCompact(0)
+		{
+			Entities.push_back(std::make_pair(entId, entIdx));
+		}
+		TEntities Entities;
+		Aabb3 Box;
+		unsigned int GridIndex;
+		CubeSphereIntersection IntersectionHelper;
+		// the same entities, packed; null unless BuildCompactCells has run
+		const CompactFlocker* Compact;
+		int NumCompact;
+	};
+	typedef std::vector<SpatialBucket*> TBuckets;
+
+	unsigned int calcGridIndex(TFloat4Arg pos, const Aabb3& worldExtents, float gridSize);
+	Aabb3 gridIndexToBox(unsigned int gridIndex, const Aabb3& worldExtents, float gridSize);
+
+	// whether calcGridIndex has the bits for that many cells across on every axis
+	bool IsValidGridLayout(const GridLayout& layout);
+
+	// the buckets are allocated from arena, so it mustn't be reset while they're in use
+	void BuildSpatialGrid(TBuckets& buckets, const WorldSnapshot& world, ScratchArena& arena, const GridLayout& layout = g_defaultGridLayout);
+
+	// fills in each bucket's Compact array, from the same arena as the buckets
+	void BuildCompactCells(TBuckets& buckets, const WorldSnapshot& world, ScratchArena& arena);
+	bool HasCompactCells(const TBuckets& buckets);
+
+	// the precomputed planes are only good for spheres up to the radius they were built for; anything bigger takes
+	// the plain distance to the box
+	FORCEINLINE bool bucketOverlaps(const SpatialBucket& buck, const Sphere& sphere)
+	{
+		return sphere.Radius <= buck.IntersectionHelper.Radius ?
+			buck.IntersectionHelper.IntersectionAt(sphere.Origin) :
+			sqrDistanceToBox(buck.Box, sphere.Origin) < sqr(sphere.Radius);
+	}
+
+	// func(TEntityId, const FlockTransform&) returns false to stop the search early. A template rather than a
+	// std::function, so the per-bird lambdas don't get copied onto the heap
+	template<typename TFunc>
+	void forAllEntitiesWithinRadius(const TBuckets& spatialGrid, const WorldSnapshot& world, const Sphere& sphere, TFunc&& func)
+	{
+		for (auto itGrid = spatialGrid.begin(); itGrid != spatialGrid.end(); ++itGrid)
+		{
+			auto& buck = *itGrid;
+			if (bucketOverlaps(*buck, sphere))
+			{
+				auto itEntEnd = buck->Entities.end();
+				for (auto itEnt = buck->Entities.begin(); itEnt != itEntEnd; ++itEnt)
+				{
+					auto& ent = *itEnt;
+					auto& transform = world.Transforms[ent.second];
+
+					if (sphereContains(sphere, transform.Local))
+					{
+						if (!func(ent.first, transform))
+						{
+							return;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// the same search over the compact cells: func(const SpatialBucket&, const CompactFlocker&, TFloat4Arg position)
+	// gets the decoded position, and can decode the rest with DecodeCompactFlocker if it wants it
+	template<typename TFunc>
+	void forAllCompactWithinRadius(const TBuckets& spatialGrid, const Sphere& sphere, TFunc&& func)
+	{
+		for (auto itGrid = spatialGrid.begin(); itGrid != spatialGrid.end(); ++itGrid)
+		{
+			auto& buck = **itGrid;
+			if (bucketOverlaps(buck, sphere))
+			{
+				auto itEnd = buck.Compact + buck.NumCompact;
+				for (auto itEnt = buck.Compact; itEnt != itEnd; ++itEnt)
+				{
+					auto pos = DecodeCompactPosition(buck.Box, *itEnt);
+					if (sphereContains(sphere, pos))
+					{
+						if (!func(buck, *itEnt, pos))
+						{
+							return;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	int CountEntitiesWithinLinearSearch(const WorldSnapshot& world, TEntityId flockerId, TFloat4Arg pos, float r);
+}
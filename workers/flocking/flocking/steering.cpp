@@ -0,0 +1,447 @@
+#include "steering.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <limits>
+#define _USE_MATH_DEFINES
+#include <math.h>
+
+#include "cpudispatch.h"
+#include "logging.h"
+
+namespace demoteam
+{
+	//***************************************************************************************************************
+	int GetFurthestNeighbour(const NeighbourData* closestBuffer, int nclosest)
+	{
+		int ifurthest = 0;
+
+		for (int c0 = 1; c0 < nclosest; ++c0)
+		{
+			ifurthest = closestBuffer[c0].DistanceSqr > closestBuffer[ifurthest].DistanceSqr ? c0 : ifurthest;
+		}
+
+		return ifurthest;
+	}
+
+	//***************************************************************************************************************
+	template<class TPositions>
+	Float4 CalculateSteeringVector(
+		const FlockTransform& transform,
+		const FlockParams& params,
+		const NeighbourData* closestBuffer,
+		int nclosest,
+		const FarFieldSums* farField)
+	{
+		Float4 averagePos = zero3<Float4>();
+		Float4 averageVel = zero3<Float4>();
+		Float4 deltaSepSum = zero3<Float4>();
+
+		const int nfar = farField != nullptr ? farField->Count : 0;
+		float oneOnN = nclosest + nfar>0 ? (1.0f / (nclosest + nfar)) : 0.0f;
+
+		auto calculateDeltaSep = [params](TFloat4Arg lineAway)
+		{
+			float separationK = ln2 / sqr(params.RepelSeparationForHalf);
+			float mag = expf(-separationK*sqrMag(lineAway));
+			return normalize(lineAway)*mag;
+		};
+
+		for (int c0 = 0; c0 < nclosest; ++c0)
+		{
+			auto& dat = closestBuffer[c0];
+			auto& neighbourTransform = dat.Transform;
+
+			averagePos = averagePos + TPositions::Of(neighbourTransform)*oneOnN;
+			averageVel = averageVel + neighbourTransform.Velocity*oneOnN;
+
+			Float4 lineAway = TPositions::Between(neighbourTransform, transform);
+			auto deltaSep = sqrMag(lineAway) > epsilon ?
+				calculateDeltaSep(lineAway) :
+				zero3<Float4>();
+
+			deltaSepSum = deltaSepSum + deltaSep;
+		}
+
+		// the far field is already summed; left alone when empty so that turning it off changes nothing
+		if (nfar > 0)
+		{
+			averagePos = averagePos + farField->SumPosition*oneOnN;
+			averageVel = averageVel + farField->SumVelocity*oneOnN;
+		}
+
+		auto deltaPos = (averagePos - TPositions::Of(transform));
+		auto deltaVel = (averageVel - transform.Velocity);
+
+		return	deltaPos*params.AttractCoefficient +
+				deltaVel*params.FollowCoefficient +
+				deltaSepSum*params.RepelCoefficient;
+	}
+
+	template Float4 CalculateSteeringVector<WorldPositions>(const FlockTransform&, const FlockParams&, const NeighbourData*, int, const FarFieldSums*);
+	template Float4 CalculateSteeringVector<LocalPositions>(const FlockTransform&, const FlockParams&, const NeighbourData*, int, const FarFieldSums*);
+
+	//***************************************************************************************************************
+	TFloat4Ret KeepAtGoodHeight(const FlockTransform& transform, TFloat4Arg steeringVector)
+	{
+		auto height = dot(ToFloat4(transform.Position), unitY3<Float4>());
+
+		auto shouldInvertY = [height, steeringVector]()
+		{
+			const float minHeight = 10.0f;
+			const float maxHeight = 30.0f;
+			return ((height<minHeight && steeringVector.Y() < 0.0f) || (height > maxHeight && steeringVector.Y()>0.0f));
+		};
+		auto invertY = [](TFloat4Arg steeringVector)
+		{
+			return steeringVector - 2 * steeringVector*unitY3<Float4>();
+		};
+
+		return shouldInvertY() ? invertY(steeringVector) : steeringVector;
+
+	}
+
+	//***************************************************************************************************************
+	TFloat4Ret KeepNearOrigin(const FlockTransform& transform, TFloat4Arg steeringVector)
+	{
+		const float maxDistance = 192.0f;
+		auto toOrigin = zero3<Float4>() - ToFloat4(transform.Position);
+		auto sqrDist = sqrMag(toOrigin);
+		return steeringVector + (sqrDist > epsilon ? normalize(toOrigin)*powf(sqrDist / sqr(maxDistance), 16.0f) : zero3<Float4>());
+	}
+
+	//***************************************************************************************************************
+	template<class TPositions>
+	void UpdateFlockingIn(
+		const TFlockers& flockers,
+		TFlockersUpdate& flockersUpdate,
+		const TScheduledFlockers& work,
+		const WorldSnapshot& world,
+		const TBuckets& spatialGrid,
+		int ibegin,
+		int iend,
+		const FlockingLimits& limits,
+		const float timeStep,
+		ScratchArena& scratch,
+		const FarFieldTree* farField,
+		NeighbourLists* neighbourLists,
+		const ConfinementField* confinement)
+	{
+		const bool confined = confinement != nullptr && confinement->IsLoaded();
+		auto updateComponent = [timeStep, confined, confinement](
+				const FlockTransform& transform,
+				const FlockParams& params,
+				const NeighbourData* closestNeighbours,
+				int numClosest,
+				const FarFieldSums* farSums,
+				float timeScale,
+				SUpdateUpdate& targetUpdate
+			)
+		{
+			Float4 steeringVector = CalculateSteeringVector<TPositions>(	transform,
+																params,
+																closestNeighbours,
+																numClosest,
+																farSums);
+
+			if (confined)
+			{
+				steeringVector = steeringVector + confinement->Sample(ToFloat4(transform.Position));
+			}
+			else
+			{
+				steeringVector = KeepNearOrigin(transform, steeringVector);
+				steeringVector = KeepAtGoodHeight(transform, steeringVector);
+			}
+
+			// rotate forward
+			auto newFwd = transform.Forward;
+			if (sqrMag(steeringVector) > epsilon)
+			{
+				const float maxAngle = toRadians(params.MaxTurnDegreesPerSecond)*timeScale;
+
+				auto targetFacing = normalize(steeringVector);
+				auto cosAng = dot(newFwd, targetFacing);
+				auto ang = acosf(std::max(std::min(cosAng, 1.0f), -1.0f));
+				auto ey = cross(newFwd, targetFacing);
+				if (!isZero(ey, epsilon))
+				{
+					auto ez = newFwd;
+					auto ex = cross(normalize(ey), ez);
+					auto angLimited = std::min(ang, maxAngle);
+					newFwd = normalize(ez*cosf(angLimited) + ex*sinf(angLimited));
+				}
+			}
+
+			Float4 newVel = newFwd*params.Speed;
+			auto newPos = transform.Position + newVel*(timeStep*timeScale);
+
+			targetUpdate.pos = newPos;
+			targetUpdate.facing = newFwd;
+			targetUpdate.velocity = newVel;
+			targetUpdate.stepped = true;
+		};
+
+		NeighbourData* closestNeighbours = scratch.NewArray<NeighbourData>(g_maxNeighbours);
+		typedef std::pair<const SpatialBucket*, const CompactFlocker*> CompactNeighbour;
+		CompactNeighbour* closestCompact = scratch.NewArray<CompactNeighbour>(g_maxNeighbours);
+
+		int nNeighbours;
+		int ifurthest = 0;
+		const int maxNeighbours = limits.MaxNeighbours > 0 ? std::min(limits.MaxNeighbours, g_maxNeighbours) : g_maxNeighbours;
+
+		int niters = 0;
+
+		// the candidates come out of the compact cells if the grid has them, at slightly less precision
+		const bool compactCells = HasCompactCells(spatialGrid);
+
+		for (int iwork = ibegin; iwork < iend; ++iwork)
+		{
+			auto& scheduled = work[iwork];
+			auto flockerId = flockers.IdAt(scheduled.FlockerIndex);
+			auto& flockerUpdate = flockersUpdate[flockers.SlotAt(scheduled.FlockerIndex)];
+			flockerUpdate.stepped = false;
+
+			int ient = world.IndexOf(flockerId);
+			if (ient < 0)
+			{
+				logging::Log(logging::Warn, "flockingWorker", "delegation for unknown entity", flockerId);
+				continue;
+			}
+
+			int nitersLocal = 0;
+			auto birdStart = limits.TimeEachBird ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
+			// both per bird, or the result would depend on which birds shared a batch
+			nNeighbours = 0;
+			ifurthest = 0;
+			if (world.HasParams[ient])
+			{
+				const FlockParams& params = world.Params[ient];
+				const FlockTransform& transform = world.Transforms[ient];
+
+				const int numberToConsider = std::min(std::max(static_cast<int>(params.NumberToConsider*limits.NeighbourScale), 1), maxNeighbours);
+				const int maxCandidates = limits.MaxCandidates > 0 ? limits.MaxCandidates : std::numeric_limits<int>::max();
+
+				auto sqrDist = [&transform](const FlockTransform& neighbourTransform) {
+					return sqrMag(TPositions::Between(transform, neighbourTransform));
+				};
+				// returns the slot it went into, or -1 if it didn't make the cut
+				auto writeClosestNeighbours = [&transform, &params, numberToConsider, &nNeighbours, closestNeighbours, &ifurthest, sqrDist](TEntityId neighbourId, const FlockTransform& neighbourTransform) {
+					if (ShouldConsiderEntity<TPositions>(transform,
+						neighbourTransform,
+						params.SearchRange))
+					{
+						if (nNeighbours < numberToConsider)
+						{
+							int idx = nNeighbours++;
+
+							closestNeighbours[idx] =
+								NeighbourData(neighbourId, neighbourTransform, sqrDist(neighbourTransform));
+
+							ifurthest =
+								closestNeighbours[idx].DistanceSqr >
+								closestNeighbours[ifurthest].DistanceSqr ?
+								idx :
+								ifurthest;
+							return idx;
+						}
+						else if (sqrDist(neighbourTransform)<closestNeighbours[ifurthest].DistanceSqr)
+						{
+							int idx = ifurthest;
+							closestNeighbours[idx] =
+								NeighbourData(neighbourId, neighbourTransform, sqrDist(neighbourTransform));
+
+							// recalculate the furthest
+							ifurthest = GetFurthestNeighbour(closestNeighbours, nNeighbours);
+							return idx;
+						}
+					}
+					return -1;
+				};
+#ifdef USE_PARTITIONING
+
+#ifdef DEBUG_PARTITIONING
+				int nentitiesLinear = CountEntitiesWithinLinearSearch(world, flockerId, transform.Local, params.SearchRange);
+#endif //DEBUG_PARTITIONING
+
+				Sphere sphere = { transform.Local, params.SearchRange };
+				if (neighbourLists != nullptr)
+				{
+					auto& list = neighbourLists->At(flockers.SlotAt(scheduled.FlockerIndex));
+					if (neighbourLists->NeedsRebuild(list, transform))
+					{
+						neighbourLists->Rebuild(list, spatialGrid, world, ient, params.SearchRange);
+					}
+					list.FramesSinceBuild += scheduled.TimeScale;
+
+					forAllListedWithinRadius(list, world, sphere, [maxCandidates, &nitersLocal, &writeClosestNeighbours](TEntityId neighbourId, const FlockTransform& neighbourTransform)
+					{
+						++nitersLocal;
+						writeClosestNeighbours(neighbourId, neighbourTransform);
+						return nitersLocal < maxCandidates;
+					});
+				}
+				else if (compactCells)
+				{
+					// choosing neighbours only takes positions; the directions are decoded for the ones that get chosen
+					forAllCompactWithinRadius(spatialGrid, sphere, [ient, maxCandidates, &nitersLocal, &writeClosestNeighbours, closestCompact, &world](const SpatialBucket& bucket, const CompactFlocker& neighbour, TFloat4Arg pos)
+					{
+						if (neighbour.EntityIndex != ient)
+						{
+							++nitersLocal;
+							FlockTransform positionOnly(world.Origin + pos, unitZ3<Float4>(), zero3<Float4>());
+							positionOnly.Local = pos;
+							int islot = writeClosestNeighbours(0, positionOnly);
+							if (islot >= 0)
+							{
+								closestCompact[islot] = CompactNeighbour(&bucket, &neighbour);
+							}
+						}
+						return nitersLocal < maxCandidates;
+					});
+					for (int ineighbour = 0; ineighbour < nNeighbours; ++ineighbour)
+					{
+						auto& chosen = closestCompact[ineighbour];
+						closestNeighbours[ineighbour].EntityId = world.Ids[chosen.second->EntityIndex];
+						closestNeighbours[ineighbour].Transform = DecodeCompactFlocker(chosen.first->Box, *chosen.second, world.Origin);
+					}
+				}
+				else
+				{
+					forAllEntitiesWithinRadius(spatialGrid, world, sphere, [flockerId, maxCandidates, &nitersLocal, &writeClosestNeighbours](TEntityId neighbourId, const FlockTransform& neighbourTransform)
+					{
+						if (neighbourId != flockerId)
+						{
+							++nitersLocal;
+							writeClosestNeighbours(neighbourId, neighbourTransform);
+						}
+						return nitersLocal < maxCandidates;
+					});
+				}
+
+#ifdef DEBUG_PARTITIONING
+				assert(limits.MaxCandidates > 0 || nentitiesLinear == nitersLocal);
+				if (limits.MaxCandidates == 0 && nentitiesLinear != nitersLocal)
+				{
+					printf("disparity! Spatial: %d; Actual %d\n", nitersLocal, nentitiesLinear);
+				}
+#endif //DEBUG_PARTITIONING
+#else
+				int nents = world.Size();
+				for (int ineighbour = 0; ineighbour < nents && nitersLocal < maxCandidates; ++ineighbour)
+				{
+					if (world.Ids[ineighbour] != flockerId)
+					{
+						++nitersLocal;
+						writeClosestNeighbours(world.Ids[ineighbour], world.Transforms[ineighbour]);
+					}
+				}
+#endif //USE_PARTITIONING
+
+				niters += nitersLocal;
+
+				flockerUpdate.numCandidates = nitersLocal;
+				FarFieldSums farSums;
+				if (farField != nullptr && farField->IsBuilt())
+				{
+					farSums = farField->Query(transform.Local, transform.Forward, params.SearchRange, world);
+				}
+				updateComponent(transform, params, closestNeighbours, nNeighbours, &farSums, scheduled.TimeScale, flockerUpdate);
+				if (limits.TimeEachBird)
+				{
+					flockerUpdate.stepNanoseconds = static_cast<int>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - birdStart).count());
+				}
+			}
+		}
+	}
+
+	//***************************************************************************************************************
+	void UpdateFlockingKernel(
+		const TFlockers& flockers,
+		TFlockersUpdate& flockersUpdate,
+		const TScheduledFlockers& work,
+		const WorldSnapshot& world,
+		const TBuckets& spatialGrid,
+		int ibegin,
+		int iend,
+		const FlockingLimits& limits,
+		const float timeStep,
+		ScratchArena& scratch,
+		const FarFieldTree* farField,
+		NeighbourLists* neighbourLists,
+		const ConfinementField* confinement)
+	{
+		// a rebased snapshot has every distance taken in floats about its origin; otherwise they're taken in doubles
+		// between world positions, as they always were
+		if (world.Rebased)
+		{
+			UpdateFlockingIn<LocalPositions>(flockers, flockersUpdate, work, world, spatialGrid, ibegin, iend, limits, timeStep, scratch, farField, neighbourLists, confinement);
+		}
+		else
+		{
+			UpdateFlockingIn<WorldPositions>(flockers, flockersUpdate, work, world, spatialGrid, ibegin, iend, limits, timeStep, scratch, farField, neighbourLists, confinement);
+		}
+	}
+
+#ifdef FLOCKING_ISA_CLONES
+	// The kernel again for each wider ISA, with everything it calls in this file and the headers flattened into it so
+	// that's compiled for the ISA too. Whatever can't be inlined (the far field, list rebuilds, the confinement field)
+	// stays generic, and nothing built for one of these is ever shared with the rest of the worker.
+	// The build turns off FMA contraction (AVX-512 has it), so every kernel rounds the same and replays match on any host.
+#define FLOCKING_ISA_KERNEL(name, isa) \
+	__attribute__((target(isa), flatten)) void name( \
+		const TFlockers& flockers, TFlockersUpdate& flockersUpdate, const TScheduledFlockers& work, const WorldSnapshot& world, \
+		const TBuckets& spatialGrid, int ibegin, int iend, const FlockingLimits& limits, const float timeStep, ScratchArena& scratch, \
+		const FarFieldTree* farField, NeighbourLists* neighbourLists, const ConfinementField* confinement) \
+	{ \
+		UpdateFlockingKernel(flockers, flockersUpdate, work, world, spatialGrid, ibegin, iend, limits, timeStep, scratch, farField, neighbourLists, confinement); \
+	}
+
+	FLOCKING_ISA_KERNEL(UpdateFlockingSse42, "sse4.2,popcnt")
+	FLOCKING_ISA_KERNEL(UpdateFlockingAvx2, "avx2,bmi,bmi2,popcnt")
+	FLOCKING_ISA_KERNEL(UpdateFlockingAvx512, "avx512f,avx512vl,avx512bw,avx512dq,avx2,bmi,bmi2,popcnt")
+
+#undef FLOCKING_ISA_KERNEL
+#endif //FLOCKING_ISA_CLONES
+
+	typedef decltype(&UpdateFlockingKernel) TUpdateFlockingKernel;
+
+	//***************************************************************************************************************
+	TUpdateFlockingKernel ChooseUpdateFlockingKernel()
+	{
+#ifdef FLOCKING_ISA_CLONES
+		switch (KernelIsaLevel())
+		{
+		case Avx512Isa: return UpdateFlockingAvx512;
+		case Avx2Isa: return UpdateFlockingAvx2;
+		case Sse42Isa: return UpdateFlockingSse42;
+		default: break;
+		}
+#endif //FLOCKING_ISA_CLONES
+		return UpdateFlockingKernel;
+	}
+
+	//***************************************************************************************************************
+	void UpdateFlocking(
+		const TFlockers& flockers,
+		TFlockersUpdate& flockersUpdate,
+		const TScheduledFlockers& work,
+		const WorldSnapshot& world,
+		const TBuckets& spatialGrid,
+		int ibegin,
+		int iend,
+		const FlockingLimits& limits,
+		const float timeStep,
+		ScratchArena& scratch,
+		const FarFieldTree* farField,
+		NeighbourLists* neighbourLists,
+		const ConfinementField* confinement)
+	{
+		static const TUpdateFlockingKernel kernel = ChooseUpdateFlockingKernel();
+		kernel(flockers, flockersUpdate, work, world, spatialGrid, ibegin, iend, limits, timeStep, scratch, farField, neighbourLists, confinement);
+	}
+}
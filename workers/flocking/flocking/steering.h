@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vector>
+
+#include "farfield.h"
+#include "confinementfield.h"
+#include "flocking.h"
+#include "flockerset.h"
+#include "framebudget.h"
+#include "neighbourlists.h"
+#include "scheduler.h"
+#include "spatialgrid.h"
+
+namespace demoteam
+{
+	//------------------------------------------
+	struct NeighbourData
+	{
+		NeighbourData() : EntityId(0), DistanceSqr(0.0f) {}
+		NeighbourData(TEntityId entityId, const FlockTransform& tr, float distSqr) : EntityId(entityId), Transform(tr), DistanceSqr(distSqr) {}
+		TEntityId EntityId;
+		FlockTransform Transform;
+		float DistanceSqr;
+	};
+
+	//------------------------------------------
+	struct SUpdateUpdate
+	{
+		SUpdateUpdate() : pos(Coordinates(0, 0, 0)), facing(0, 0, 1), velocity(0, 0, 0), numCandidates(0), stepNanoseconds(0), stepped(false) {}
+		Coordinates pos;
+		Float4 facing;
+		Float4 velocity;
+		int numCandidates;
+		int stepNanoseconds;	// only measured if the limits ask for it
+		bool stepped;	// false if the last attempt to step it found nothing to step
+	};
+	typedef FlockerSet TFlockers;
+	typedef std::vector<SUpdateUpdate> TFlockersUpdate;	// indexed by flocker slot
+
+	int GetFurthestNeighbour(const NeighbourData* closestBuffer, int nclosest);
+
+	// farField, if given, joins the closest neighbours in the attraction and follow averages, but not separation.
+	// LocalPositions takes the distances from the transforms' Local positions, which needs a rebased snapshot
+	template<class TPositions = WorldPositions>
+	Float4 CalculateSteeringVector(const FlockTransform& transform, const FlockParams& params, const NeighbourData* closestBuffer, int nclosest, const FarFieldSums* farField = nullptr);
+	TFloat4Ret KeepAtGoodHeight(const FlockTransform& transform, TFloat4Arg steeringVector);
+	TFloat4Ret KeepNearOrigin(const FlockTransform& transform, TFloat4Arg steeringVector);
+
+	// steps work[ibegin, iend) into flockersUpdate; scratch is the calling thread's own. Searches the grid's compact
+	// cells instead of the snapshot if it has them. With a farField, each bird also feels the flock beyond its
+	// SearchRange. With neighbourLists, each bird filters its own list, rebuilt from the grid when it goes stale,
+	// in place of either. A loaded confinement field replaces KeepNearOrigin and KeepAtGoodHeight. If the snapshot
+	// has been rebased, the search and steering run in floats about its origin. Built for several ISAs if the build
+	// asks for it, and runs the one KernelIsaLevel picks
+	void UpdateFlocking(
+		const TFlockers& flockers,
+		TFlockersUpdate& flockersUpdate,
+		const TScheduledFlockers& work,
+		const WorldSnapshot& world,
+		const TBuckets& spatialGrid,
+		int ibegin,
+		int iend,
+		const FlockingLimits& limits,
+		const float timeStep,
+		ScratchArena& scratch,
+		const FarFieldTree* farField = nullptr,
+		NeighbourLists* neighbourLists = nullptr,
+		const ConfinementField* confinement = nullptr);
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+
+// What logging and tracing both need to take events off any thread without locks or allocation: a ring each thread
+// pushes onto and one consumer drains, and a fixed set of them for threads to claim.
+namespace threadrings
+{
+	//------------------------------------------
+	// single producer (the owning thread), single consumer (whoever drains it)
+	template <typename T, int N>
+	class SpscRing
+	{
+	public:
+		enum { Capacity = N };
+
+		SpscRing() : Head(0), Tail(0), Dropped(0) {}
+
+		//***************************************************************************************************************
+		// false, and counted as dropped, if the ring is full
+		bool Push(const T& item)
+		{
+			auto head = Head.load(std::memory_order_relaxed);
+			if (head - Tail.load(std::memory_order_acquire) >= Capacity)
+			{
+				Dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			Items[head % Capacity] = item;
+			Head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		//***************************************************************************************************************
+		bool Pop(T& item)
+		{
+			auto tail = Tail.load(std::memory_order_relaxed);
+			if (tail == Head.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+			item = Items[tail % Capacity];
+			Tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		unsigned int TakeDropped() { return Dropped.exchange(0); }
+
+	private:
+		T Items[Capacity];
+		std::atomic<unsigned int> Head;
+		std::atomic<unsigned int> Tail;
+		std::atomic<unsigned int> Dropped;
+	};
+
+	//------------------------------------------
+	// rings for threads to claim one each of; see RingClaim
+	template <typename T, int N>
+	class RingRegistry
+	{
+	public:
+		typedef T TRing;
+		enum { MaxRings = N };
+
+		RingRegistry() : Claimed(0)
+		{
+			for (int iring = 0; iring < MaxRings; ++iring)
+			{
+				InUse[iring].store(false);
+			}
+		}
+
+		//***************************************************************************************************************
+		// nullptr, and index -1, if every ring is taken
+		TRing* Claim(int& index)
+		{
+			for (int iring = 0; iring < MaxRings; ++iring)
+			{
+				bool inUse = false;
+				if (!InUse[iring].load(std::memory_order_relaxed) && InUse[iring].compare_exchange_strong(inUse, true, std::memory_order_acquire))
+				{
+					int nclaimed = Claimed.load();
+					while (nclaimed <= iring && !Claimed.compare_exchange_weak(nclaimed, iring + 1))
+					{
+					}
+					index = iring;
+					return &Rings[iring];
+				}
+			}
+			index = -1;
+			return nullptr;
+		}
+
+		// whatever is still in the ring stays there for the consumer, and the next thread to claim it
+		void Release(int index) { InUse[index].store(false, std::memory_order_release); }
+
+		TRing& Ring(int index) { return Rings[index]; }
+		// one past the highest ring ever claimed, so the consumer needn't look at the rest
+		int NumClaimed() const { return Claimed.load(); }
+
+	private:
+		TRing Rings[MaxRings];
+		std::atomic_bool InUse[MaxRings];
+		std::atomic_int Claimed;
+	};
+
+	//------------------------------------------
+	// a thread's ring from a registry, taken the first time it's asked for and given back when the thread exits, so
+	// threads that come and go don't use them all up. Declared thread_local, one per registry
+	template <typename TRegistry>
+	class RingClaim
+	{
+	public:
+		explicit RingClaim(TRegistry& registry) : Registry(registry), Ring(nullptr), Index(-1) {}
+		~RingClaim()
+		{
+			if (Ring != nullptr)
+			{
+				Registry.Release(Index);
+			}
+		}
+
+		// nullptr if every ring is taken; tries again on the next call
+		typename TRegistry::TRing* Get()
+		{
+			if (Ring == nullptr)
+			{
+				Ring = Registry.Claim(Index);
+			}
+			return Ring;
+		}
+
+		// the ring's index in the registry, or -1 while the thread hasn't one
+		int RingIndex() const { return Index; }
+
+	private:
+		RingClaim(const RingClaim&);
+		RingClaim& operator=(const RingClaim&);
+
+		TRegistry& Registry;
+		typename TRegistry::TRing* Ring;
+		int Index;
+	};
+}
@@ -0,0 +1,254 @@
+#include "tracing.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+
+namespace tracing
+{
+	namespace
+	{
+		const int g_maxRings = 64;
+		const long long g_defaultMaxBytesPerFile = 64LL << 20;
+		const int g_defaultMaxFiles = 8;
+
+		typedef threadrings::RingRegistry<TraceRing, g_maxRings> TTraceRings;
+
+		TTraceRings g_rings;
+		thread_local threadrings::RingClaim<TTraceRings> tl_ring(g_rings);
+		// by ring; a ring's name stays until its next thread takes it, for whatever Flush hasn't written yet
+		std::atomic<const char*> g_threadNames[g_maxRings];
+		// kept for when the thread first traces something, if it ever does
+		thread_local const char* tl_threadName = nullptr;
+		std::atomic<unsigned int> g_ringsExhausted(0);
+		std::atomic_bool g_enabled(false);
+
+		std::chrono::steady_clock::time_point g_startTime = std::chrono::steady_clock::now();
+
+		// writer state, main thread only
+		TraceConfig g_config;
+		FILE* g_file = nullptr;
+		int g_fileIndex = 0;
+		long long g_fileBytes = 0;
+		// the name each ring's thread was last written under in this file
+		const char* g_namesWritten[g_maxRings];
+		unsigned int g_dropped = 0;
+
+		//***************************************************************************************************************
+		// only called while tracing is on, so threads that never trace never take a ring
+		TraceRing* ThreadRing()
+		{
+			bool hadRing = tl_ring.RingIndex() >= 0;
+			auto ring = tl_ring.Get();
+			if (!hadRing)
+			{
+				if (ring != nullptr)
+				{
+					g_threadNames[tl_ring.RingIndex()].store(tl_threadName);
+				}
+				else
+				{
+					g_ringsExhausted.fetch_add(1, std::memory_order_relaxed);
+				}
+			}
+			return ring;
+		}
+
+		std::string FilePath(int index)
+		{
+			return g_config.BasePath + "." + std::to_string(index) + ".json";
+		}
+
+		void Write(const char* text, int length)
+		{
+			fwrite(text, 1, length, g_file);
+			g_fileBytes += length;
+		}
+
+		//***************************************************************************************************************
+		bool OpenFile(int index)
+		{
+			g_file = fopen(FilePath(index).c_str(), "w");
+			if (g_file == nullptr)
+			{
+				printf("couldn't open trace file %s\n", FilePath(index).c_str());
+				return false;
+			}
+			g_fileIndex = index;
+			g_fileBytes = 0;
+			std::fill(g_namesWritten, g_namesWritten + g_maxRings, static_cast<const char*>(nullptr));
+			Write("[\n", 2);
+
+			if (g_config.MaxFiles > 0 && index >= g_config.MaxFiles)
+			{
+				remove(FilePath(index - g_config.MaxFiles).c_str());
+			}
+			return true;
+		}
+
+		//***************************************************************************************************************
+		void CloseFile()
+		{
+			if (g_file != nullptr)
+			{
+				// every event line ends in a comma; the empty object makes that valid json
+				Write("{}]\n", 4);
+				fclose(g_file);
+				g_file = nullptr;
+			}
+		}
+
+		//***************************************************************************************************************
+		void WriteThreadName(int tid, const char* name)
+		{
+			char line[256];
+			int length = snprintf(line, sizeof(line), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n", tid, name);
+			Write(line, std::min(length, static_cast<int>(sizeof(line)) - 1));
+		}
+
+		//***************************************************************************************************************
+		void WriteEvent(int tid, const TraceEvent& ev)
+		{
+			char line[256];
+			int length = ev.HasArg ?
+				snprintf(line, sizeof(line), "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld,\"args\":{\"n\":%lld}},\n", ev.Name, tid, ev.BeginMicroseconds, ev.DurationMicroseconds, ev.Arg) :
+				snprintf(line, sizeof(line), "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld},\n", ev.Name, tid, ev.BeginMicroseconds, ev.DurationMicroseconds);
+			Write(line, std::min(length, static_cast<int>(sizeof(line)) - 1));
+		}
+	}
+
+	//***************************************************************************************************************
+	bool Start(const TraceConfig& config)
+	{
+		Stop();
+		g_config = config;
+		if (!OpenFile(0))
+		{
+			return false;
+		}
+		g_enabled.store(true);
+		return true;
+	}
+
+	//***************************************************************************************************************
+	bool StartFromEnvironment()
+	{
+		const char* basePath = getenv("FLOCKING_TRACE");
+		if (basePath == nullptr || basePath[0] == 0)
+		{
+			return false;
+		}
+
+		const char* maxMegabytes = getenv("FLOCKING_TRACE_MB");
+		const char* maxFiles = getenv("FLOCKING_TRACE_FILES");
+
+		TraceConfig config;
+		config.BasePath = basePath;
+		config.MaxBytesPerFile = maxMegabytes != nullptr ? (atoll(maxMegabytes) << 20) : g_defaultMaxBytesPerFile;
+		config.MaxFiles = maxFiles != nullptr ? atoi(maxFiles) : g_defaultMaxFiles;
+		return Start(config);
+	}
+
+	//***************************************************************************************************************
+	void Stop()
+	{
+		if (g_file != nullptr)
+		{
+			Flush();
+		}
+		g_enabled.store(false);
+		CloseFile();
+	}
+
+	//***************************************************************************************************************
+	bool IsEnabled()
+	{
+		return g_enabled.load(std::memory_order_relaxed);
+	}
+
+	//***************************************************************************************************************
+	long long NowMicroseconds()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - g_startTime).count();
+	}
+
+	//***************************************************************************************************************
+	void Record(const char* name, long long beginMicroseconds, long long endMicroseconds)
+	{
+		auto ring = IsEnabled() ? ThreadRing() : nullptr;
+		if (ring != nullptr)
+		{
+			TraceEvent ev = { name, beginMicroseconds, endMicroseconds - beginMicroseconds, 0, false };
+			ring->Push(ev);
+		}
+	}
+
+	void Record(const char* name, long long beginMicroseconds, long long endMicroseconds, long long arg)
+	{
+		auto ring = IsEnabled() ? ThreadRing() : nullptr;
+		if (ring != nullptr)
+		{
+			TraceEvent ev = { name, beginMicroseconds, endMicroseconds - beginMicroseconds, arg, true };
+			ring->Push(ev);
+		}
+	}
+
+	//***************************************************************************************************************
+	void SetThreadName(const char* name)
+	{
+		tl_threadName = name;
+		if (tl_ring.RingIndex() >= 0)
+		{
+			g_threadNames[tl_ring.RingIndex()].store(name);
+		}
+	}
+
+	//***************************************************************************************************************
+	void Flush()
+	{
+		if (g_file == nullptr)
+		{
+			return;
+		}
+
+		int nrings = g_rings.NumClaimed();
+		for (int iring = 0; iring < nrings; ++iring)
+		{
+			auto& ring = g_rings.Ring(iring);
+			TraceEvent ev;
+			while (ring.Pop(ev))
+			{
+				if (g_fileBytes >= g_config.MaxBytesPerFile)
+				{
+					CloseFile();
+					if (!OpenFile(g_fileIndex + 1))
+					{
+						g_enabled.store(false);
+						return;
+					}
+				}
+
+				// every file names its threads, so each one can be opened on its own; a ring may have changed hands since
+				auto name = g_threadNames[iring].load();
+				if (name != nullptr && name != g_namesWritten[iring])
+				{
+					WriteThreadName(iring, name);
+					g_namesWritten[iring] = name;
+				}
+				WriteEvent(iring, ev);
+			}
+			g_dropped += ring.TakeDropped();
+		}
+		g_dropped += g_ringsExhausted.exchange(0);
+
+		if (g_dropped > 0)
+		{
+			char line[128];
+			int length = snprintf(line, sizeof(line), "{\"name\":\"dropped %u events\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":%lld},\n", g_dropped, NowMicroseconds());
+			Write(line, std::min(length, static_cast<int>(sizeof(line)) - 1));
+			g_dropped = 0;
+		}
+	}
+}
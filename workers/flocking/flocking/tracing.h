@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "threadrings.h"
+
+namespace tracing
+{
+	//------------------------------------------
+	// Name is not copied, so it must be a string literal. Times are microseconds since Start.
+	struct TraceEvent
+	{
+		const char* Name;
+		long long BeginMicroseconds;
+		long long DurationMicroseconds;
+		long long Arg;
+		bool HasArg;
+	};
+
+	// drained by whoever calls Flush
+	typedef threadrings::SpscRing<TraceEvent, 4096> TraceRing;
+
+	//------------------------------------------
+	struct TraceConfig
+	{
+		std::string BasePath;		// files are BasePath.0.json, BasePath.1.json, ...
+		long long MaxBytesPerFile;	// roll over to the next file past this
+		int MaxFiles;				// keep only the newest this many (0 = keep everything)
+	};
+
+	// main thread only; false if the first file couldn't be opened
+	bool Start(const TraceConfig& config);
+	// FLOCKING_TRACE=<base path>, optionally FLOCKING_TRACE_MB and FLOCKING_TRACE_FILES; false if not set
+	bool StartFromEnvironment();
+	void Stop();
+
+	bool IsEnabled();
+	long long NowMicroseconds();
+
+	// safe from any thread, never blocks or allocates; dropped if tracing is off, and counted as dropped if more
+	// threads than there are rings are tracing at once. A thread takes a ring the first time it records while
+	// tracing is on, and gives it back when it exits.
+	void Record(const char* name, long long beginMicroseconds, long long endMicroseconds);
+	void Record(const char* name, long long beginMicroseconds, long long endMicroseconds, long long arg);
+	// shows up as the thread's name in the viewer
+	void SetThreadName(const char* name);
+
+	// main thread, off the hot path: moves everything buffered so far into the file
+	void Flush();
+
+	//------------------------------------------
+	class Scope
+	{
+	public:
+		explicit Scope(const char* name) : Name(name), Begin(IsEnabled() ? NowMicroseconds() : -1), Arg(0), HasArg(false) {}
+		Scope(const char* name, long long arg) : Name(name), Begin(IsEnabled() ? NowMicroseconds() : -1), Arg(arg), HasArg(true) {}
+		~Scope()
+		{
+			if (Begin >= 0)
+			{
+				if (HasArg)
+					Record(Name, Begin, NowMicroseconds(), Arg);
+				else
+					Record(Name, Begin, NowMicroseconds());
+			}
+		}
+
+	private:
+		Scope(const Scope&);
+		Scope& operator=(const Scope&);
+
+		const char* Name;
+		long long Begin;
+		long long Arg;
+		bool HasArg;
+	};
+}
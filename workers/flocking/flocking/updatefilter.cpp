@@ -0,0 +1,161 @@
+#include "updatefilter.h"
+
+namespace demoteam
+{
+	namespace
+	{
+		// rough protobuf wire sizes, only used for the bytes-saved counter
+		const long long kCoordinatesFieldBytes = 2 + 3 * (1 + 8);
+		const long long kVector3fFieldBytes = 2 + 3 * (1 + 4);
+		const long long kUpdateOverheadBytes = 16;
+
+		double quantise(double v, float quantum)
+		{
+			return quantum > 0.0f ? floor(v / quantum + 0.5) * quantum : v;
+		}
+
+		Coordinates quantise(const Coordinates& c, float quantum)
+		{
+			return Coordinates(quantise(c.X(), quantum), quantise(c.Y(), quantum), quantise(c.Z(), quantum));
+		}
+
+		Float4 quantise(TFloat4Arg v, float quantum)
+		{
+			return Float4(static_cast<float>(quantise(v.X(), quantum)), static_cast<float>(quantise(v.Y(), quantum)), static_cast<float>(quantise(v.Z(), quantum)));
+		}
+
+		bool exceeds(TFloat4Arg delta, float threshold)
+		{
+			return !isZero(delta, threshold);
+		}
+	}
+
+	//***************************************************************************************************************
+	TransformUpdateFilter::TransformUpdateFilter(TransformUpdateMode mode, const TransformUpdateThresholds& thresholds) : Mode(mode), Thresholds(thresholds)
+	{
+	}
+
+	//***************************************************************************************************************
+	void TransformUpdateFilter::Resize(int numSlots)
+	{
+		LastSent.resize(numSlots);
+	}
+
+	//***************************************************************************************************************
+	bool TransformUpdateFilter::Filter(int slot, const Coordinates& posIn, TFloat4Arg forwardIn, TFloat4Arg velocityIn, double time, FlockTransformUpdate& update, TransformUpdateStats& stats)
+	{
+		auto pos = quantise(posIn, Thresholds.PositionQuantum);
+		auto forward = quantise(forwardIn, Thresholds.VectorQuantum);
+		auto velocity = quantise(velocityIn, Thresholds.VectorQuantum);
+
+		auto& sent = LastSent[slot];
+		bool sendAll = Mode == FullUpdates || !sent.Valid || time - sent.FullTime >= Thresholds.MaxSilenceSeconds;
+
+		bool sendPos = sendAll;
+		bool sendFwd = sendAll;
+		bool sendVel = sendAll;
+		bool sendTarget = false;
+
+		if (!sendAll && Mode == SteeringUpdates)
+		{
+			// receivers integrate the last velocity they were given from the last position, and face along it. Sent
+			// holds where that has them now, so a keyframe goes out as soon as they'd be too far out
+			auto predicted = sent.Position + sent.Velocity*static_cast<float>(time - sent.PositionTime);
+			if (sqrMag(pos - predicted) > sqr(Thresholds.DeadReckoningDrift))
+			{
+				sendAll = sendPos = sendFwd = sendVel = true;
+			}
+			else
+			{
+				sendTarget = time - sent.PositionTime >= Thresholds.SteeringSeconds && exceeds(velocity - sent.Velocity, Thresholds.Velocity);
+			}
+		}
+		else if (!sendAll)
+		{
+			sendFwd = exceeds(forward - sent.Forward, Thresholds.Forward);
+			sendVel = exceeds(velocity - sent.Velocity, Thresholds.Velocity);
+
+			if (Mode == DeadReckoningUpdates)
+			{
+				// receivers extrapolate from the last position and velocity, so those always go together
+				auto predicted = sent.Position + sent.Velocity*static_cast<float>(time - sent.PositionTime);
+				sendPos = sendVel || sqrMag(pos - predicted) > sqr(Thresholds.DeadReckoningDrift);
+				sendVel = sendPos;
+			}
+			else
+			{
+				sendPos = sqrMag(pos - sent.Position) > sqr(Thresholds.Position);
+			}
+		}
+
+		int nomitted = (sendPos ? 0 : 1) + (sendFwd ? 0 : 1) + (sendVel ? 0 : 1);
+		long long bytesOmitted = (sendPos ? 0 : kCoordinatesFieldBytes) + (sendFwd ? 0 : kVector3fFieldBytes) + (sendVel ? 0 : kVector3fFieldBytes);
+
+		if (sendTarget)
+		{
+			// the target velocity takes the place of the velocity, at the same size
+			++stats.Sent;
+			++stats.SteeringSent;
+			stats.FieldsOmitted += nomitted;
+			stats.BytesSaved += bytesOmitted - kVector3fFieldBytes;
+
+			sent.Position = sent.Position + sent.Velocity*static_cast<float>(time - sent.PositionTime);
+			sent.PositionTime = time;
+			sent.Velocity = velocity;
+
+			update.HasTargetVelocity = true;
+			update.TargetVelocity = ToVector3f(velocity);
+			return true;
+		}
+
+		if (nomitted == 3)
+		{
+			++stats.Suppressed;
+			stats.BytesSaved += bytesOmitted + kUpdateOverheadBytes;
+			return false;
+		}
+
+		++stats.Sent;
+		stats.FieldsOmitted += nomitted;
+		stats.BytesSaved += bytesOmitted;
+
+		if (!sent.Valid)
+		{
+			sent = SentState(pos, forward, velocity, time);
+		}
+
+		if (sendPos)
+		{
+			update.HasPosition = true;
+			update.Position = pos;
+			sent.Position = pos;
+			sent.PositionTime = time;
+		}
+		if (sendFwd)
+		{
+			update.HasForward = true;
+			update.Forward = ToVector3f(forward);
+			sent.Forward = forward;
+		}
+		if (sendVel)
+		{
+			update.HasVelocity = true;
+			update.Velocity = ToVector3f(velocity);
+			sent.Velocity = velocity;
+		}
+		if (sendAll)
+		{
+			sent.FullTime = time;
+		}
+		return true;
+	}
+
+	//***************************************************************************************************************
+	void TransformUpdateFilter::Forget(int slot)
+	{
+		if (slot >= 0 && slot < static_cast<int>(LastSent.size()))
+		{
+			LastSent[slot] = SentState();
+		}
+	}
+}
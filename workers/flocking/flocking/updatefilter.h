@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+
+#include "flocking.h"
+
+namespace demoteam
+{
+	enum TransformUpdateMode
+	{
+		FullUpdates = 0,		// everything, every frame
+		ThresholdUpdates,		// only the fields that moved past their threshold
+		DeadReckoningUpdates,	// position only when pos + vel*t has drifted past the tolerance
+		SteeringUpdates			// target velocity alone, in FlockOutput, for receivers to integrate; the transform
+								// only as a keyframe, when that's drifted past the tolerance or gone silent too long
+	};
+
+	//------------------------------------------
+	struct TransformUpdateThresholds
+	{
+		float Position;				// metres
+		float Forward;				// per component
+		float Velocity;				// per component, m/s
+		float DeadReckoningDrift;	// metres between the extrapolated and the actual position
+		float PositionQuantum;		// 0 = off
+		float VectorQuantum;		// 0 = off
+		float MaxSilenceSeconds;	// everything gets resent at least this often
+		float SteeringSeconds;		// SteeringUpdates: least time between one bird's target velocities
+	};
+
+	//------------------------------------------
+	struct TransformUpdateStats
+	{
+		TransformUpdateStats() : Sent(0), SteeringSent(0), Suppressed(0), FieldsOmitted(0), BytesSaved(0) {}
+		void Add(const TransformUpdateStats& other)
+		{
+			Sent += other.Sent;
+			SteeringSent += other.SteeringSent;
+			Suppressed += other.Suppressed;
+			FieldsOmitted += other.FieldsOmitted;
+			BytesSaved += other.BytesSaved;
+		}
+		long long Sent;
+		long long SteeringSent;	// of Sent, those with only a target velocity
+		long long Suppressed;
+		long long FieldsOmitted;
+		long long BytesSaved;
+	};
+
+	//------------------------------------------
+	// What was last sent for each bird, by flocker slot like FlockersUpdate, so the pool can filter the birds it has
+	// just stepped: any number of threads can call Filter so long as no two are given the same slot. Each counts
+	// into stats of its own
+	class TransformUpdateFilter
+	{
+	public:
+		TransformUpdateFilter(TransformUpdateMode mode, const TransformUpdateThresholds& thresholds);
+
+		void Resize(int numSlots);
+
+		// fills in only the fields that need sending; false if the whole update can be dropped
+		bool Filter(int slot, const Coordinates& pos, TFloat4Arg forward, TFloat4Arg velocity, double time, FlockTransformUpdate& update, TransformUpdateStats& stats);
+
+		// call when the slot's bird goes, or the slot is given to another, so the next update sent from it is a
+		// full one
+		void Forget(int slot);
+
+	private:
+		struct SentState
+		{
+			SentState() : Position(zero3<Coordinates>()), Forward(unitZ3<Float4>()), Velocity(zero3<Float4>()), PositionTime(0.0), FullTime(0.0), Valid(false) {}
+			SentState(const Coordinates& pos, TFloat4Arg forward, TFloat4Arg velocity, double time) :
+				Position(pos), Forward(forward), Velocity(velocity), PositionTime(time), FullTime(time), Valid(true) {}
+			Coordinates Position;
+			Float4 Forward;
+			Float4 Velocity;
+			double PositionTime;
+			double FullTime;
+			bool Valid;		// false until something's been sent from the slot
+		};
+
+		TransformUpdateMode Mode;
+		TransformUpdateThresholds Thresholds;
+		std::vector<SentState> LastSent;
+	};
+}
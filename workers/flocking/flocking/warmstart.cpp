@@ -0,0 +1,253 @@
+#include "warmstart.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "logging.h"
+#include "recording.h"
+#include "simulation.h"
+
+namespace demoteam
+{
+	namespace
+	{
+		const char g_snapshotMagic[8] = { 'F', 'L', 'O', 'C', 'K', 'S', 'N', 'P' };
+		const std::uint32_t g_snapshotVersion = 1;
+	}
+
+	//***************************************************************************************************************
+	bool WriteFlockSnapshot(const std::string& path, const WorldSnapshot& world, const FlockerSet& flockers, long long frame)
+	{
+		FlockSnapshotHeader header;
+		memcpy(header.Magic, g_snapshotMagic, sizeof(header.Magic));
+		header.Version = g_snapshotVersion;
+		header.EntitySize = sizeof(FlockSnapshotEntity);
+		header.NumEntities = world.Size();
+		header.NumPlayers = world.Players.size();
+		header.Frame = frame;
+
+		// value initialised, so the padding goes out as zeros rather than whatever was on the heap
+		std::vector<FlockSnapshotEntity> entities(world.Size(), FlockSnapshotEntity());
+		for (int ient = 0; ient < world.Size(); ++ient)
+		{
+			auto& entity = entities[ient];
+			auto& transform = world.Transforms[ient];
+			entity.Id = world.Ids[ient];
+			entity.Position[0] = transform.Position.X();
+			entity.Position[1] = transform.Position.Y();
+			entity.Position[2] = transform.Position.Z();
+			entity.Forward[0] = transform.Forward.X();
+			entity.Forward[1] = transform.Forward.Y();
+			entity.Forward[2] = transform.Forward.Z();
+			entity.Velocity[0] = transform.Velocity.X();
+			entity.Velocity[1] = transform.Velocity.Y();
+			entity.Velocity[2] = transform.Velocity.Z();
+			entity.Params = world.Params[ient];
+			entity.HasParams = world.HasParams[ient] ? 1 : 0;
+			entity.Authoritative = flockers.Contains(entity.Id) ? 1 : 0;
+		}
+		std::vector<double> players;
+		for (auto itPlayer = world.Players.begin(); itPlayer != world.Players.end(); ++itPlayer)
+		{
+			players.push_back(itPlayer->X());
+			players.push_back(itPlayer->Y());
+			players.push_back(itPlayer->Z());
+		}
+
+		std::string temporary = path + ".tmp";
+		FILE* file = fopen(temporary.c_str(), "wb");
+		if (file == nullptr)
+		{
+			printf("couldn't open %s to write a snapshot\n", temporary.c_str());
+			return false;
+		}
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+			(entities.empty() || fwrite(&entities[0], sizeof(FlockSnapshotEntity), entities.size(), file) == entities.size()) &&
+			(players.empty() || fwrite(&players[0], sizeof(double), players.size(), file) == players.size());
+		ok = fclose(file) == 0 && ok;
+
+		// rename won't replace a file on Windows
+		ok = ok && (rename(temporary.c_str(), path.c_str()) == 0 || (remove(path.c_str()) == 0 && rename(temporary.c_str(), path.c_str()) == 0));
+		if (!ok)
+		{
+			printf("couldn't write a snapshot to %s\n", path.c_str());
+			remove(temporary.c_str());
+		}
+		return ok;
+	}
+
+	//***************************************************************************************************************
+	WarmStart::WarmStart(const WarmStartPolicy& policy) : Policy(policy), Entities(nullptr), Recorder(nullptr), Frame(0), FramesFilled(0)
+	{
+	}
+
+	//***************************************************************************************************************
+	bool WarmStart::Begin(const std::string& path, FlockingSimulation& sim, WorldRecorder* recorder)
+	{
+		End();
+		if (!Snapshot.Open(path))
+		{
+			return false;
+		}
+
+		// nothing in the header is trusted until the file is exactly the size it says
+		FlockSnapshotHeader header;
+		bool ok = Snapshot.Size() >= sizeof(header);
+		if (ok)
+		{
+			memcpy(&header, Snapshot.Data(), sizeof(header));
+			unsigned long long expectedSize = sizeof(header) +
+				static_cast<unsigned long long>(header.NumEntities) * sizeof(FlockSnapshotEntity) +
+				static_cast<unsigned long long>(header.NumPlayers) * 3 * sizeof(double);
+			ok = memcmp(header.Magic, g_snapshotMagic, sizeof(header.Magic)) == 0 &&
+				header.Version == g_snapshotVersion &&
+				header.EntitySize == sizeof(FlockSnapshotEntity) &&
+				Snapshot.Size() == expectedSize;
+		}
+		if (!ok)
+		{
+			printf("%s isn't a snapshot this build can read\n", path.c_str());
+			Snapshot.Close();
+			return false;
+		}
+
+		// the records are used where they lie; the mapping is copy on write, so stand-ins can be updated in place
+		Entities = reinterpret_cast<FlockSnapshotEntity*>(Snapshot.Data() + sizeof(header));
+		const char* players = Snapshot.Data() + sizeof(header) + header.NumEntities * sizeof(FlockSnapshotEntity);
+		for (std::uint32_t iplayer = 0; iplayer < header.NumPlayers; ++iplayer)
+		{
+			double pos[3];
+			memcpy(pos, players + iplayer * sizeof(pos), sizeof(pos));
+			Players.push_back(Coordinates(pos[0], pos[1], pos[2]));
+		}
+
+		Recorder = recorder;
+		Frame = header.Frame;
+		FramesFilled = 0;
+		StandIns.reserve(header.NumEntities);
+		for (std::uint32_t ient = 0; ient < header.NumEntities; ++ient)
+		{
+			auto& entity = Entities[ient];
+			StandIns[entity.Id] = ient;
+			if (entity.Authoritative != 0)
+			{
+				sim.OnAuthorityGained(entity.Id);
+				Provisional.insert(entity.Id);
+				if (Recorder != nullptr) Recorder->AuthorityGained(entity.Id);
+			}
+		}
+
+		logging::Log(logging::Info, "FlockingWorker", "warm start from a snapshot, birds", Provisional.size());
+		return true;
+	}
+
+	//***************************************************************************************************************
+	void WarmStart::End()
+	{
+		Snapshot.Close();
+		Entities = nullptr;
+		Players.clear();
+		StandIns.clear();
+		Provisional.clear();
+		Recorder = nullptr;
+	}
+
+	//***************************************************************************************************************
+	void WarmStart::AuthorityGained(TEntityId entityId, FlockingSimulation& sim)
+	{
+		// what was held back never went out, so the filter mustn't think it did
+		if (Provisional.erase(entityId) > 0)
+		{
+			sim.ResendInFull(entityId);
+		}
+	}
+
+	//***************************************************************************************************************
+	void WarmStart::AuthorityLost(TEntityId entityId)
+	{
+		Provisional.erase(entityId);
+	}
+
+	//***************************************************************************************************************
+	void WarmStart::EntityRemoved(TEntityId entityId)
+	{
+		StandIns.erase(entityId);
+		Provisional.erase(entityId);
+	}
+
+	//***************************************************************************************************************
+	void WarmStart::FillIn(WorldSnapshot& world, FlockingSimulation& sim)
+	{
+		if (!IsActive())
+		{
+			return;
+		}
+
+		if (++FramesFilled > Policy.GraceFrames)
+		{
+			for (auto itId = Provisional.begin(); itId != Provisional.end(); ++itId)
+			{
+				sim.OnAuthorityLost(*itId);
+				if (Recorder != nullptr) Recorder->AuthorityLost(*itId);
+			}
+			logging::Log(logging::Info, "FlockingWorker", "warm start over, birds the view never confirmed", Provisional.size());
+			End();
+			return;
+		}
+
+		for (auto itStandIn = StandIns.begin(); itStandIn != StandIns.end();)
+		{
+			if (world.IndexOf(itStandIn->first) >= 0)
+			{
+				itStandIn = StandIns.erase(itStandIn);
+				continue;
+			}
+
+			auto& entity = Entities[itStandIn->second];
+			FlockTransform transform(Coordinates(entity.Position[0], entity.Position[1], entity.Position[2]),
+				Float4(entity.Forward[0], entity.Forward[1], entity.Forward[2]),
+				Float4(entity.Velocity[0], entity.Velocity[1], entity.Velocity[2]));
+			world.Add(entity.Id, transform, entity.HasParams != 0 ? &entity.Params : nullptr);
+			++itStandIn;
+		}
+		if (world.Players.empty())
+		{
+			world.Players.insert(world.Players.end(), Players.begin(), Players.end());
+		}
+
+		if (StandIns.empty() && Provisional.empty())
+		{
+			logging::Log(logging::Info, "FlockingWorker", "warm start caught up with the view after frames", FramesFilled);
+			End();
+		}
+	}
+
+	//***************************************************************************************************************
+	bool WarmStart::Updated(TEntityId entityId, const FlockTransformUpdate& update)
+	{
+		auto itStandIn = StandIns.find(entityId);
+		if (itStandIn != StandIns.end())
+		{
+			auto& entity = Entities[itStandIn->second];
+			if (update.HasPosition)
+			{
+				entity.Position[0] = update.Position.X();
+				entity.Position[1] = update.Position.Y();
+				entity.Position[2] = update.Position.Z();
+			}
+			if (update.HasForward)
+			{
+				entity.Forward[0] = update.Forward.X();
+				entity.Forward[1] = update.Forward.Y();
+				entity.Forward[2] = update.Forward.Z();
+			}
+			if (update.HasVelocity)
+			{
+				entity.Velocity[0] = update.Velocity.X();
+				entity.Velocity[1] = update.Velocity.Y();
+				entity.Velocity[2] = update.Velocity.Z();
+			}
+		}
+		return Provisional.count(entityId) == 0;
+	}
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "flocking.h"
+#include "flockerset.h"
+#include "mappedfile.h"
+
+namespace demoteam
+{
+	class FlockingSimulation;
+	class WorldRecorder;
+
+	//------------------------------------------
+	struct WarmStartPolicy
+	{
+		float SaveEverySeconds;		// how often the worker writes a snapshot (0 = never)
+		int GraceFrames;			// how long the snapshot stands in for the view after a restart
+	};
+
+	// Snapshots are the world as the simulation last read it, and which birds it had authority over: a header,
+	// then fixed size entity records, then the players' positions. Host byte order, like recordings, and the
+	// header carries the record size so a build that lays them out differently turns the file away.
+
+	//------------------------------------------
+	struct FlockSnapshotHeader
+	{
+		char Magic[8];
+		std::uint32_t Version;
+		std::uint32_t EntitySize;
+		std::uint32_t NumEntities;
+		std::uint32_t NumPlayers;
+		std::int64_t Frame;
+	};
+
+	//------------------------------------------
+	struct FlockSnapshotEntity
+	{
+		TEntityId Id;
+		double Position[3];
+		float Forward[3];
+		float Velocity[3];
+		FlockParams Params;
+		std::uint8_t HasParams;
+		std::uint8_t Authoritative;
+	};
+
+	// written whole to a temporary file and renamed over path, so a crash part way through leaves the last one
+	bool WriteFlockSnapshot(const std::string& path, const WorldSnapshot& world, const FlockerSet& flockers, long long frame);
+
+	//------------------------------------------
+	// Gets a restarted worker simulating straight away instead of once the view has streamed in. The snapshot is
+	// mapped, its birds are taken on provisionally, and its copies of the entities stand in for the view's until
+	// the real ones arrive; updates to a stand-in are applied to it, as LocalWorld does. Provisional birds are
+	// stepped but their updates are held back until the view confirms the authority, and any it hasn't confirmed
+	// after GraceFrames are let go.
+	class WarmStart
+	{
+	public:
+		explicit WarmStart(const WarmStartPolicy& policy);
+
+		// false, with nothing taken on, if there's no snapshot this build can read. If recorder is given, the
+		// provisional authority goes into the recording as it's taken and let go
+		bool Begin(const std::string& path, FlockingSimulation& sim, WorldRecorder* recorder = nullptr);
+		bool IsActive() const { return Snapshot.IsOpen(); }
+
+		int NumStandIns() const { return StandIns.size(); }
+		int NumProvisional() const { return Provisional.size(); }
+		long long SnapshotFrame() const { return Frame; }
+
+		// from the view's ops, alongside the simulation's own handlers
+		void AuthorityGained(TEntityId entityId, FlockingSimulation& sim);
+		void AuthorityLost(TEntityId entityId);
+		void EntityRemoved(TEntityId entityId);
+
+		// once the host has read the view into world: anything the view has now stops standing in, the rest is
+		// added. Ends the warm start once there's nothing left to stand in for, or the grace frames are up
+		void FillIn(WorldSnapshot& world, FlockingSimulation& sim);
+
+		// applies an update to the entity's stand-in, if it has one; false if the bird's authority is still
+		// provisional, so the update mustn't go out. Only looks things up, so the pool can call it, each thread
+		// for birds of its own, while nothing else here is being called
+		bool Updated(TEntityId entityId, const FlockTransformUpdate& update);
+		bool IsProvisional(TEntityId entityId) const { return Provisional.count(entityId) > 0; }
+
+	private:
+		WarmStart(const WarmStart&);
+		WarmStart& operator=(const WarmStart&);
+
+		void End();
+
+		WarmStartPolicy Policy;
+		MappedFile Snapshot;
+		FlockSnapshotEntity* Entities;
+		std::vector<Coordinates> Players;
+		// into Entities
+		std::unordered_map<TEntityId, int> StandIns;
+		std::unordered_set<TEntityId> Provisional;
+		WorldRecorder* Recorder;
+		long long Frame;
+		int FramesFilled;
+	};
+}
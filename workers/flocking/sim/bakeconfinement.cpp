@@ -0,0 +1,53 @@
+// Bakes a confinement field for --confinement (or FLOCKING_CONFINEMENT) to point the worker, FlockingSim or FlockingReplay at.
+//   FlockingBakeConfinement <out> [cellSize] [x y z radius]...
+// Without obstacles it's the built in bounds: KeepNearOrigin's pull, and a push back into the 10-30m height band.
+// Each obstacle is a sphere birds are pushed off, starting g_obstacleMargin out from its surface.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+
+#include "confinementfield.h"
+
+using namespace demoteam;
+
+namespace
+{
+	const float g_obstacleMargin = 8.0f;
+	const float g_obstacleStrength = 20.0f;
+}
+
+int main(int argc, char**argv)
+{
+	if (argc < 2 || (argc > 3 && (argc - 3) % 4 != 0))
+	{
+		printf("usage: %s <out> [cellSize] [x y z radius]...\n", argv[0]);
+		return 1;
+	}
+
+	ConfinementFieldDesc desc = DefaultConfinementFieldDesc();
+	if (argc > 2) desc.CellSize = static_cast<float>(atof(argv[2]));
+	if (desc.CellSize <= 0.0f)
+	{
+		printf("cell size has to be positive\n");
+		return 1;
+	}
+	for (int iarg = 3; iarg + 3 < argc; iarg += 4)
+	{
+		Float4 centre(static_cast<float>(atof(argv[iarg])), static_cast<float>(atof(argv[iarg + 1])), static_cast<float>(atof(argv[iarg + 2])));
+		desc.Obstacles.push_back(ConfinementObstacle(centre, static_cast<float>(atof(argv[iarg + 3])), g_obstacleMargin, g_obstacleStrength));
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+	ConfinementField field;
+	field.Bake(desc);
+	double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+	if (!field.Save(argv[1]))
+	{
+		return 1;
+	}
+	printf("samples %d, obstacles %d, kb %lld, bake_ms %.1f\n", field.NumSamples(), static_cast<int>(desc.Obstacles.size()), field.Bytes() / 1024, elapsedMs);
+	return 0;
+}
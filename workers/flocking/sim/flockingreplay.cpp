@@ -0,0 +1,97 @@
+// Replays a recording made by the worker (or FlockingSim) through the simulation, as fast as it will go.
+//   FlockingReplay <recording> [numThreads] [--config=<path>] [--<key>=<value>...]
+// The checksum covers every update sent, so two builds given the same recording can be compared directly, as long as
+// they're given the same settings. That's also why there's no --autotune here.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include "config.h"
+#include "logging.h"
+#include "recording.h"
+#include "simulation.h"
+#include "tracing.h"
+
+using namespace demoteam;
+
+int main(int argc, char**argv)
+{
+	SimulationConfig config = DefaultSimulationConfig();
+	CommandLine commandLine;
+	if (!ParseCommandLine(argc, argv, config, commandLine) || commandLine.Help || commandLine.Autotune || commandLine.Positional.empty())
+	{
+		if (commandLine.Autotune)
+		{
+			printf("no --autotune for replays: the checksum only means something if the settings are the same every time\n");
+		}
+		printf("usage: %s <recording> [numThreads] [--config=<path>] [--<key>=<value>...]\n", argv[0]);
+		PrintConfigOptions(config);
+		return 1;
+	}
+	if (commandLine.Positional.size() > 1) config.NumThreads = std::min(std::max(atoi(commandLine.Positional[1].c_str()), 1), g_maxSimulationThreads);
+
+	// degrading depends on how long ticks take, which would make the output depend on the machine
+	config.FrameBudget.Enabled = false;
+
+	logging::SetLimits(logging::LogLimits{ 1000, 2, 0 });
+	auto logSink = [](logging::LogLevel level, const std::string& logger, const std::string& message)
+	{
+		if (level >= logging::Warn)
+		{
+			printf("%s: %s\n", logger.c_str(), message.c_str());
+		}
+	};
+
+	FlockingSimulation sim(config);
+	WorldReplay replay(sim);
+	// --confinement=<path> or FLOCKING_CONFINEMENT=<path> swaps the built in bounds for a baked field
+	if (!sim.LoadConfiguredConfinementField())
+	{
+		return 1;
+	}
+	if (!replay.Open(commandLine.Positional[0]))
+	{
+		return 1;
+	}
+
+	const double secondsPerSubTick = 1.0 / config.TargetFPS / sim.NumPhases();
+	long long subTick = 0;
+
+	// FLOCKING_TRACE=<path> writes a chrome://tracing timeline
+	if (tracing::StartFromEnvironment())
+	{
+		tracing::SetThreadName("main");
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+	while (!replay.AtEnd())
+	{
+		// a frame's worth of sub ticks per recorded frame; the first one reads it
+		for (int phase = 0; phase < sim.NumPhases(); ++phase, ++subTick)
+		{
+			sim.Tick(replay, subTick * secondsPerSubTick);
+		}
+		logging::Drain(logSink);
+		tracing::Flush();
+	}
+	double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	tracing::Stop();
+
+	if (replay.Failed())
+	{
+		printf("recording is truncated or corrupt after %d frames\n", replay.FramesRead());
+	}
+
+	int numFrames = replay.FramesRead();
+	printf("frames %d\n", numFrames);
+	printf("elapsed_ms %.1f\n", elapsedMs);
+	printf("ms_per_frame %.3f\n", numFrames > 0 ? elapsedMs / numFrames : 0.0);
+	printf("bird_steps %lld\n", sim.BirdSteps());
+	printf("updates_sent %lld\n", replay.UpdatesSent());
+	printf("update_checksum %016llx\n", replay.UpdateChecksum());
+	return replay.Failed() ? 1 : 0;
+}
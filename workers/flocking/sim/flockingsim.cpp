@@ -0,0 +1,165 @@
+// Headless run of the flocking simulation against a LocalWorld, no deployment needed.
+//   FlockingSim [numBirds] [numFrames] [numThreads] [numBirdCells] [recording] [--autotune] [--config=<path>] [--<key>=<value>...]
+// Frames are stepped back to back rather than paced, so the output is the throughput we can sustain. A numThreads
+// given positionally wins over --threads; --autotune tunes on this run's flock, then runs it.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include "autotune.h"
+#include "config.h"
+#include "cpudispatch.h"
+#include "localworld.h"
+#include "logging.h"
+#include "recording.h"
+#include "simulation.h"
+#include "tracing.h"
+
+using namespace demoteam;
+
+namespace
+{
+	const int g_defaultNumFrames = 200;
+
+	const char* LogLevelName(logging::LogLevel level)
+	{
+		switch (level)
+		{
+		case logging::Debug: return "DEBUG";
+		case logging::Info: return "INFO";
+		case logging::Warn: return "WARN";
+		default: return "ERROR";
+		}
+	}
+
+	//------------------------------------------
+	// records what the simulation reads, so synthetic loads can go through FlockingReplay too
+	class RecordingHost : public IFlockingHost
+	{
+	public:
+		RecordingHost(IFlockingHost& host, WorldRecorder& recorder) : Host(host), Recorder(recorder) {}
+
+		virtual void ReadWorld(WorldSnapshot& world)
+		{
+			Host.ReadWorld(world);
+			Recorder.Frame(world);
+		}
+
+		virtual void SendTransformUpdate(TEntityId entityId, const FlockTransformUpdate& update)
+		{
+			Host.SendTransformUpdate(entityId, update);
+		}
+
+	private:
+		IFlockingHost& Host;
+		WorldRecorder& Recorder;
+	};
+}
+
+int main(int argc, char**argv)
+{
+	LocalWorldParams worldParams = DefaultLocalWorldParams();
+	SimulationConfig config = DefaultSimulationConfig();
+	int numFrames = g_defaultNumFrames;
+
+	CommandLine commandLine;
+	if (!ParseCommandLine(argc, argv, config, commandLine) || commandLine.Help)
+	{
+		printf("usage: %s [numBirds] [numFrames] [numThreads] [numBirdCells] [recording] [--autotune] [--config=<path>] [--<key>=<value>...]\n", argv[0]);
+		PrintConfigOptions(config);
+		return 1;
+	}
+	auto& args = commandLine.Positional;
+	if (args.size() > 0) worldParams.NumBirds = atoi(args[0].c_str());
+	if (args.size() > 1) numFrames = atoi(args[1].c_str());
+	if (args.size() > 2) config.NumThreads = std::min(std::max(atoi(args[2].c_str()), 1), g_maxSimulationThreads);
+	if (args.size() > 3) worldParams.NumBirdCells = atoi(args[3].c_str());
+	const char* recordingPath = args.size() > 4 ? args[4].c_str() : nullptr;
+
+	if (commandLine.Autotune)
+	{
+		auto autotuneParams = DefaultAutotuneParams();
+		autotuneParams.NumBirds = worldParams.NumBirds;
+		autotuneParams.NumBirdCells = worldParams.NumBirdCells;
+		auto tuned = Autotune(config, autotuneParams);
+		config = tuned.Config;
+		printf("%s", DescribeAutotune(tuned).c_str());
+	}
+
+	// never degrade, or the numbers stop being comparable between runs
+	config.FrameBudget.Enabled = false;
+
+	// info would be one line per frame
+	logging::SetLimits(logging::LogLimits{ 1000, 2, 0 });
+	auto logSink = [](logging::LogLevel level, const std::string& logger, const std::string& message)
+	{
+		if (level >= logging::Warn)
+		{
+			printf("[%s] %s: %s\n", LogLevelName(level), logger.c_str(), message.c_str());
+		}
+	};
+
+	LocalWorld world(worldParams);
+	world.SpawnBirds();
+
+	FlockingSimulation sim(config);
+	world.DelegateAll(sim);
+	// --confinement=<path> or FLOCKING_CONFINEMENT=<path> swaps the built in bounds for a baked field
+	if (!sim.LoadConfiguredConfinementField())
+	{
+		return 1;
+	}
+
+	WorldRecorder recorder;
+	if (recordingPath != nullptr && !recorder.Open(recordingPath))
+	{
+		return 1;
+	}
+	for (int ient = 0; recorder.IsOpen() && ient < world.NumEntities(); ++ient)
+	{
+		recorder.AuthorityGained(world.IdAt(ient));
+	}
+	RecordingHost recordingHost(world, recorder);
+	IFlockingHost& host = recorder.IsOpen() ? static_cast<IFlockingHost&>(recordingHost) : world;
+
+	printf("birds %d, frames %d, threads %d, cells %d, phases %d, kernel %s\n", world.NumEntities(), numFrames, config.NumThreads, worldParams.NumBirdCells, sim.NumPhases(), IsaLevelName(KernelIsaLevel()));
+
+	const double secondsPerSubTick = 1.0 / config.TargetFPS / sim.NumPhases();
+	const int numSubTicks = numFrames * sim.NumPhases();
+
+	// FLOCKING_TRACE=<path> writes a chrome://tracing timeline
+	if (tracing::StartFromEnvironment())
+	{
+		tracing::SetThreadName("main");
+	}
+
+	auto startTime = std::chrono::steady_clock::now();
+	for (int isub = 0; isub < numSubTicks; ++isub)
+	{
+		// virtual time, so the update filter behaves as it would at the target rate
+		sim.Tick(host, isub * secondsPerSubTick);
+		logging::Drain(logSink);
+		tracing::Flush();
+	}
+	double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+	tracing::Stop();
+
+	TGauges gauges;
+	sim.CollectMetrics(gauges);
+
+	double msPerFrame = numFrames > 0 ? elapsedMs / numFrames : 0.0;
+	printf("elapsed_ms %.1f\n", elapsedMs);
+	printf("ms_per_frame %.3f (budget %.1f)\n", msPerFrame, 1000.0 / config.TargetFPS);
+	printf("bird_steps %lld\n", sim.BirdSteps());
+	printf("bird_steps_per_sec %.0f\n", elapsedMs > 0.0 ? sim.BirdSteps() * 1000.0 / elapsedMs : 0.0);
+	printf("updates_sent %lld\n", sim.UpdatesSent());
+	for (auto itGauge = gauges.begin(); itGauge != gauges.end(); ++itGauge)
+	{
+		printf("%s %g\n", itGauge->first.c_str(), itGauge->second);
+	}
+	return 0;
+}
@@ -0,0 +1,126 @@
+// Runs a local flock for a few stats periods and checks what comes out for FlockStats: every bird reports once a
+// period and no more, its periods follow on from each other, the counts add up to what the simulation stepped, and
+// the reports are spread over the sub ticks rather than all landing in one. With the period at 0 nothing is sent.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "localworld.h"
+#include "simulation.h"
+#include "testutil.h"
+
+using namespace demoteam;
+using namespace testutil;
+
+namespace
+{
+	const float g_periodSeconds = 0.5f;
+	const int g_numPeriods = 4;
+
+	//------------------------------------------
+	// keeps every summary the simulation sends, and which sub tick it came in
+	class StatsHost : public LocalWorld
+	{
+	public:
+		StatsHost() : LocalWorld(DefaultLocalWorldParams()), SubTick(0) {}
+
+		virtual void SendBirdStats(TEntityId entityId, const BirdStatsSummary& summary)
+		{
+			Reports[entityId].push_back(summary);
+			ReportSubTicks.push_back(SubTick);
+		}
+
+		std::unordered_map<TEntityId, std::vector<BirdStatsSummary>> Reports;
+		std::vector<int> ReportSubTicks;
+		int SubTick;
+	};
+
+	//***************************************************************************************************************
+	void RunFor(FlockingSimulation& sim, StatsHost& host, int numSubTicks)
+	{
+		for (host.SubTick = 0; host.SubTick < numSubTicks; ++host.SubTick)
+		{
+			sim.Tick(host, host.SubTick * SubTickSeconds(sim));
+		}
+	}
+
+	//***************************************************************************************************************
+	void TestReports()
+	{
+		SimulationConfig config = DefaultSimulationConfig();
+		config.NumThreads = 2;
+		config.BirdStats.PeriodSeconds = g_periodSeconds;
+
+		FlockingSimulation sim(config);
+		StatsHost host;
+		host.SpawnBirds();
+		host.DelegateAll(sim);
+
+		const int subTicksPerPeriod = static_cast<int>(g_periodSeconds * config.TargetFPS * sim.NumPhases() + 0.5f);
+		RunFor(sim, host, subTicksPerPeriod * g_numPeriods);
+
+		Check(static_cast<int>(host.Reports.size()) == sim.NumFlockers(), std::to_string(host.Reports.size()) + " of " + std::to_string(sim.NumFlockers()) + " birds reported");
+
+		long long reportedSteps = 0;
+		for (auto itBird = host.Reports.begin(); itBird != host.Reports.end(); ++itBird)
+		{
+			auto& reports = itBird->second;
+			auto bird = "bird " + std::to_string(itBird->first);
+			// the first period runs from the start until the bird's slot comes round, so long as that's half a period
+			Check(reports.size() == g_numPeriods || reports.size() == g_numPeriods - 1, bird + " reported " + std::to_string(reports.size()) + " times in " + std::to_string(g_numPeriods) + " periods");
+			for (auto itReport = reports.begin(); itReport != reports.end(); ++itReport)
+			{
+				reportedSteps += itReport->Steps;
+				Check(itReport->Steps > 0 && itReport->Candidates > 0 && itReport->ComputeSeconds > 0.0, bird + " reported an empty period");
+				Check(itReport->ComputeSeconds < itReport->PeriodSeconds * config.NumThreads, bird + " took longer to step than the period lasted");
+				if (itReport != reports.begin())
+				{
+					auto& previous = *(itReport - 1);
+					Check(fabs(itReport->PeriodStart - (previous.PeriodStart + previous.PeriodSeconds)) < 1e-9, bird + "'s periods don't follow on from each other");
+					Check(fabs(itReport->PeriodSeconds - subTicksPerPeriod * SubTickSeconds(sim)) < 1e-9, bird + " reported a period of " + std::to_string(itReport->PeriodSeconds) + "s");
+				}
+			}
+		}
+		// whatever's left is in the periods still running
+		Check(reportedSteps > 0 && reportedSteps <= sim.BirdSteps(), "reported " + std::to_string(reportedSteps) + " steps of " + std::to_string(sim.BirdSteps()));
+
+		// spread out: no sub tick carries much more than its share
+		std::vector<int> perSubTick(subTicksPerPeriod * g_numPeriods, 0);
+		for (auto itSubTick = host.ReportSubTicks.begin(); itSubTick != host.ReportSubTicks.end(); ++itSubTick)
+		{
+			++perSubTick[*itSubTick];
+		}
+		int busiest = *std::max_element(perSubTick.begin(), perSubTick.end());
+		int share = sim.NumFlockers() / subTicksPerPeriod + 1;
+		Check(busiest <= share, std::to_string(busiest) + " reports went out in one sub tick, against a share of " + std::to_string(share));
+	}
+
+	//***************************************************************************************************************
+	void TestOff()
+	{
+		SimulationConfig config = DefaultSimulationConfig();
+		config.NumThreads = 2;
+		config.BirdStats.PeriodSeconds = 0.0f;
+
+		FlockingSimulation sim(config);
+		StatsHost host;
+		host.SpawnBirds();
+		host.DelegateAll(sim);
+		RunFor(sim, host, 64);
+		Check(host.Reports.empty() && sim.BirdSteps() > 0, "stats went out with them turned off");
+	}
+}
+
+int main()
+{
+	TestReports();
+	TestOff();
+
+	return Finish();
+}
@@ -0,0 +1,197 @@
+// Checks the settings layer: single settings against their ranges, config files, the command line, and that what
+// DescribeConfig writes loads back to the same config. Then a tiny autotune, for what it hands back rather than
+// what it picks, which depends on the machine.
+//   ConfigTest [scratchDir]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "autotune.h"
+#include "config.h"
+#include "testutil.h"
+
+using namespace demoteam;
+using namespace testutil;
+
+namespace
+{
+	//***************************************************************************************************************
+	void WriteFile(const std::string& path, const std::string& text)
+	{
+		FILE* file = fopen(path.c_str(), "wb");
+		fwrite(text.data(), 1, text.size(), file);
+		fclose(file);
+	}
+
+	//***************************************************************************************************************
+	bool ParseArgs(std::vector<std::string> args, SimulationConfig& config, CommandLine& commandLine)
+	{
+		std::vector<char*> argv;
+		args.insert(args.begin(), "ConfigTest");
+		for (auto itArg = args.begin(); itArg != args.end(); ++itArg)
+		{
+			argv.push_back(&(*itArg)[0]);
+		}
+		return ParseCommandLine(static_cast<int>(argv.size()), &argv[0], config, commandLine);
+	}
+
+	//***************************************************************************************************************
+	void TestOptions()
+	{
+		auto config = DefaultSimulationConfig();
+		Check(SetConfigOption(config, "threads", "3") && config.NumThreads == 3, "threads wasn't set");
+		Check(SetConfigOption(config, "far_field_range", "48.5") && config.FarField.Range == 48.5f, "far_field_range wasn't set");
+		Check(SetConfigOption(config, "compact_neighbours", "on") && config.CompactNeighbours, "compact_neighbours wasn't set");
+		Check(SetConfigOption(config, "budget_enabled", "off") && !config.FrameBudget.Enabled, "budget_enabled wasn't set");
+		Check(SetConfigOption(config, "update_mode", "dead_reckoning") && config.UpdateMode == DeadReckoningUpdates, "update_mode wasn't set");
+		Check(SetConfigOption(config, "update_mode", "steering") && config.UpdateMode == SteeringUpdates, "update_mode=steering wasn't set");
+		Check(SetConfigOption(config, "confinement", "field.bin") && config.ConfinementPath == "field.bin", "confinement wasn't set");
+		Check(SetConfigOption(config, "grid_cell_size", "12") && config.Grid.CellSize == 12.0f, "grid_cell_size wasn't set");
+		Check(SetConfigOption(config, "snapshot", "flock.snp") && config.SnapshotPath == "flock.snp", "snapshot wasn't set");
+
+		auto before = DescribeConfig(config);
+		Check(!SetConfigOption(config, "no_such_setting", "1"), "took a setting that doesn't exist");
+		Check(!SetConfigOption(config, "threads", "0"), "took threads below its range");
+		Check(!SetConfigOption(config, "threads", std::to_string(g_maxSimulationThreads + 1)), "took more threads than the pool can have");
+		Check(!SetConfigOption(config, "max_neighbours", std::to_string(g_maxNeighbours + 1)), "took more neighbours than there's room for");
+		Check(!SetConfigOption(config, "threads", "4x"), "took a number with junk after it");
+		Check(!SetConfigOption(config, "threads", ""), "took an empty number");
+		Check(!SetConfigOption(config, "far_field_theta", "nan"), "took a nan");
+		Check(!SetConfigOption(config, "compact_neighbours", "maybe"), "took a switch that's neither on nor off");
+		Check(!SetConfigOption(config, "update_mode", "sometimes"), "took an update mode that doesn't exist");
+		Check(DescribeConfig(config) == before, "a setting that was turned away still changed the config");
+	}
+
+	//***************************************************************************************************************
+	void TestGridLayouts()
+	{
+		Check(IsValidGridLayout(g_defaultGridLayout), "the default grid layout isn't valid");
+		GridLayout finest = { 2.0f, 1000.0f };
+		Check(IsValidGridLayout(finest), "1000 cells across should fit");
+		GridLayout tooFine = { 1.0f, 1000.0f };
+		Check(!IsValidGridLayout(tooFine), "2000 cells across shouldn't fit");
+		GridLayout empty = { 0.0f, 1000.0f };
+		Check(!IsValidGridLayout(empty), "a zero cell size shouldn't be valid");
+	}
+
+	//***************************************************************************************************************
+	void TestFiles(const std::string& dir)
+	{
+		std::string path = dir + "/config_test.cfg";
+		WriteFile(path, "# a comment\n\n  threads = 2\ntarget_fps=10\r\n\tneighbour_skin = 6 \nconfinement = some field.bin\n");
+		auto config = DefaultSimulationConfig();
+		Check(LoadConfigFile(config, path), "couldn't load a good file");
+		Check(config.NumThreads == 2 && config.TargetFPS == 10 && config.NeighbourLists.Skin == 6.0f, "the file's settings weren't applied");
+		Check(config.ConfinementPath == "some field.bin", "a value with a space in it didn't survive");
+
+		WriteFile(path, "threads = 2\njust some words\n");
+		Check(!LoadConfigFile(config, path), "loaded a line that isn't key = value");
+		WriteFile(path, "threads = 200\n");
+		Check(!LoadConfigFile(config, path), "loaded a setting out of range");
+		Check(!LoadConfigFile(config, dir + "/no_such_config_test.cfg"), "loaded a file that isn't there");
+
+		// everything changed from the defaults, written out and read back into the defaults
+		config = DefaultSimulationConfig();
+		config.NumThreads = 5;
+		config.Schedule.MaxTier = 3;
+		config.FrameBudget.SkipFraction = 0.125f;
+		config.UpdateMode = FullUpdates;
+		config.UpdateThresholds.PositionQuantum = 0.01f;
+		config.CompactNeighbours = true;
+		config.LocalOrigin = true;
+		config.FarField.Range = 64.0f;
+		config.NeighbourLists.Skin = 4.0f;
+		config.Grid.CellSize = 16.0f;
+		config.MaxNeighbours = 12;
+		config.ConfinementPath = "field.bin";
+		config.SnapshotPath = "flock.snp";
+		config.WarmStart.GraceFrames = 40;
+		config.BirdStats.PeriodSeconds = 10.0f;
+		config.UpdateThresholds.SteeringSeconds = 0.5f;
+		WriteFile(path, DescribeConfig(config));
+		auto loaded = DefaultSimulationConfig();
+		Check(LoadConfigFile(loaded, path), "couldn't load what DescribeConfig wrote");
+		Check(DescribeConfig(loaded) == DescribeConfig(config), "what DescribeConfig wrote loaded back differently");
+		Check(loaded.Grid.CellSize == 16.0f && loaded.MaxNeighbours == 12 && loaded.FrameBudget.SkipFraction == 0.125f, "settings were lost in the round trip");
+		Check(loaded.SnapshotPath == "flock.snp" && loaded.WarmStart.GraceFrames == 40, "the warm start settings were lost in the round trip");
+		Check(loaded.BirdStats.PeriodSeconds == 10.0f, "the stats period was lost in the round trip");
+		Check(loaded.UpdateThresholds.SteeringSeconds == 0.5f, "the steering rate was lost in the round trip");
+
+		remove(path.c_str());
+	}
+
+	//***************************************************************************************************************
+	void TestCommandLine(const std::string& dir)
+	{
+		std::string path = dir + "/config_test_args.cfg";
+		WriteFile(path, "threads = 2\ntarget_fps = 10\n");
+
+		auto config = DefaultSimulationConfig();
+		CommandLine commandLine;
+		Check(ParseArgs({ "host", "--threads=6", "--config=" + path, "7777", "--target_fps=12", "--compact_neighbours", "--autotune", "worker" }, config, commandLine), "didn't parse a good command line");
+		Check(commandLine.Positional == std::vector<std::string>({ "host", "7777", "worker" }), "positional arguments came out wrong");
+		Check(config.NumThreads == 2, "the config file should have won over the --threads before it");
+		Check(config.TargetFPS == 12, "--target_fps should have won over the config file before it");
+		Check(config.CompactNeighbours, "a bare switch wasn't turned on");
+		Check(commandLine.Autotune && !commandLine.Help, "--autotune wasn't noted");
+
+		CommandLine other;
+		config = DefaultSimulationConfig();
+		Check(!ParseArgs({ "--threads" }, config, other), "took --threads without a value");
+		Check(!ParseArgs({ "--no_such_setting=1" }, config, other), "took a setting that doesn't exist");
+		Check(!ParseArgs({ "--config=" + dir + "/no_such_config_test.cfg" }, config, other), "took a config file that isn't there");
+		Check(!ParseArgs({ "--grid_cell_size=1" }, config, other), "took a grid with more cells than it can index");
+		Check(!ParseArgs({ "--budget_lower_at_load=0.9", "--budget_raise_at_load=0.8" }, config, other), "took a budget that would never settle");
+		config = DefaultSimulationConfig();
+		Check(ParseArgs({ "--grid_cell_size=1", "--grid_half_extent=500" }, config, other), "a finer grid over a smaller world should fit");
+
+		remove(path.c_str());
+	}
+
+	//***************************************************************************************************************
+	void TestAutotune()
+	{
+		auto params = DefaultAutotuneParams();
+		params.NumBirds = 128;
+		params.NumBirdCells = 1;
+		params.WarmupFrames = 1;
+		params.MeasuredFrames = 1;
+		params.MaxThreads = 2;
+
+		auto base = DefaultSimulationConfig();
+		base.NumThreads = 2;
+		base.FarField.Range = 48.0f;
+		auto result = Autotune(base, params);
+
+		Check(!result.Trials.empty(), "autotune didn't try anything");
+		bool chosenWasTried = false;
+		for (auto itTrial = result.Trials.begin(); itTrial != result.Trials.end(); ++itTrial)
+		{
+			Check(itTrial->Kernel != CompactKernel, "tried compact cells, which weren't asked for");
+			Check(itTrial->NumThreads >= 1 && itTrial->NumThreads <= params.MaxThreads, "tried more threads than it was allowed");
+			Check(itTrial->MsPerFrame > 0.0, "a trial took no time");
+			chosenWasTried = chosenWasTried || (itTrial->NumThreads == result.Chosen.NumThreads && itTrial->CellSize == result.Chosen.CellSize && itTrial->Kernel == result.Chosen.Kernel);
+		}
+		Check(chosenWasTried, "chose something it didn't try");
+		Check(result.Config.NumThreads == result.Chosen.NumThreads && result.Config.Grid.CellSize == result.Chosen.CellSize && KernelOf(result.Config) == result.Chosen.Kernel, "the config doesn't have what was chosen");
+		Check(result.Config.FarField.Range == base.FarField.Range, "autotune changed a setting it doesn't tune");
+		Check(ValidateConfig(result.Config), "autotune came up with a config that doesn't validate");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string dir = argc > 1 ? argv[1] : ".";
+
+	TestOptions();
+	TestGridLayouts();
+	TestFiles(dir);
+	TestCommandLine(dir);
+	TestAutotune();
+
+	return Finish();
+}
@@ -0,0 +1,169 @@
+// Bakes confinement fields and checks the lookup against the description they came from: exact at the samples,
+// exact everywhere for a field that's linear anyway, close between samples for the default bounds, clamped outside.
+// Then that a field survives being saved and loaded, and that damaged files are turned away.
+//   ConfinementFieldTest [scratchDir]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <math.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "confinementfield.h"
+#include "testutil.h"
+
+using namespace demoteam;
+using namespace testutil;
+
+namespace
+{
+	const float g_sampleTolerance = 1e-4f;
+	// the default bounds' pull is steep near its radius, but well inside it linear interpolation is close. The height
+	// band's edges are between samples and get softened over a cell, so the heights tested keep a cell clear of them
+	const float g_interpolationRadius = 160.0f;
+	const float g_interpolationMinHeight = 16.0f;
+	const float g_interpolationMaxHeight = 24.0f;
+	const float g_interpolationTolerance = 0.02f;
+
+	//***************************************************************************************************************
+	float Uniform(std::mt19937& rng, float lo, float hi)
+	{
+		return std::uniform_real_distribution<float>(lo, hi)(rng);
+	}
+
+	//***************************************************************************************************************
+	void TestSamples(const ConfinementFieldDesc& desc, const ConfinementField& field, std::mt19937& rng)
+	{
+		auto extent = desc.RightTopFront - desc.LeftBottomBack;
+		for (int c0 = 0; c0 < 1000; ++c0)
+		{
+			int ix = rng() % static_cast<int>(extent.X() / desc.CellSize + 1);
+			int iy = rng() % static_cast<int>(extent.Y() / desc.CellSize + 1);
+			int iz = rng() % static_cast<int>(extent.Z() / desc.CellSize + 1);
+			auto pos = desc.LeftBottomBack + Float4(ix * desc.CellSize, iy * desc.CellSize, iz * desc.CellSize);
+			auto expected = EvaluateConfinement(desc, pos);
+			float scale = std::max(1.0f, mag(expected));
+			Check(isZero(field.Sample(pos) - expected, g_sampleTolerance * scale), "sample " + std::to_string(ix) + "," + std::to_string(iy) + "," + std::to_string(iz) + " doesn't match");
+		}
+	}
+
+	//***************************************************************************************************************
+	void TestLinear(std::mt19937& rng)
+	{
+		// only the height band, and never outside it on one side: linear in y, which trilinear gets exactly
+		ConfinementFieldDesc desc;
+		desc.LeftBottomBack = Float4(-20.0f, -20.0f, -20.0f);
+		desc.RightTopFront = Float4(20.0f, 0.0f, 20.0f);
+		desc.CellSize = 5.0f;
+		desc.MinHeight = 10.0f;
+		desc.MaxHeight = 30.0f;
+		desc.HeightStrength = 3.0f;
+		ConfinementField field;
+		field.Bake(desc);
+
+		for (int c0 = 0; c0 < 1000; ++c0)
+		{
+			Float4 pos(Uniform(rng, -20, 20), Uniform(rng, -20, 0), Uniform(rng, -20, 20));
+			Check(isZero(field.Sample(pos) - EvaluateConfinement(desc, pos), g_sampleTolerance * 100.0f), "linear field isn't reproduced");
+		}
+
+		// outside the grid, the nearest edge
+		Check(isZero(field.Sample(Float4(500.0f, -10.0f, 0.0f)) - field.Sample(Float4(20.0f, -10.0f, 0.0f)), g_sampleTolerance), "doesn't clamp past the +x edge");
+		Check(isZero(field.Sample(Float4(0.0f, -500.0f, 0.0f)) - field.Sample(Float4(0.0f, -20.0f, 0.0f)), g_sampleTolerance), "doesn't clamp below the grid");
+	}
+
+	//***************************************************************************************************************
+	void TestInterpolation(const ConfinementFieldDesc& desc, const ConfinementField& field, std::mt19937& rng)
+	{
+		float worst = 0.0f;
+		for (int c0 = 0; c0 < 10000; ++c0)
+		{
+			float angle = Uniform(rng, 0.0f, 6.2831853f);
+			float radius = g_interpolationRadius * sqrtf(Uniform(rng, 0.0f, 1.0f));
+			Float4 pos(radius * cosf(angle), Uniform(rng, g_interpolationMinHeight, g_interpolationMaxHeight), radius * sinf(angle));
+			worst = std::max(worst, mag(field.Sample(pos) - EvaluateConfinement(desc, pos)));
+		}
+		Check(worst < g_interpolationTolerance, "interpolated up to " + std::to_string(worst) + " from the bounds");
+	}
+
+	//***************************************************************************************************************
+	void TestFiles(const ConfinementField& field, const std::string& dir, std::mt19937& rng)
+	{
+		std::string path = dir + "/confinement_field_test.bin";
+		Check(field.Save(path), "couldn't save");
+
+		ConfinementField loaded;
+		Check(loaded.Load(path), "couldn't load what was saved");
+		Check(loaded.NumSamples() == field.NumSamples(), "loaded a different number of samples");
+		for (int c0 = 0; c0 < 1000; ++c0)
+		{
+			Float4 pos(Uniform(rng, -300, 300), Uniform(rng, -50, 120), Uniform(rng, -300, 300));
+			auto a = loaded.Sample(pos);
+			auto b = field.Sample(pos);
+			Check(a.X() == b.X() && a.Y() == b.Y() && a.Z() == b.Z(), "loaded field samples differently");
+		}
+
+		// cut short, claiming far more samples than it has, then with the magic scribbled on
+		FILE* file = fopen(path.c_str(), "r+b");
+		fseek(file, 0, SEEK_END);
+		long size = ftell(file);
+		fclose(file);
+		std::string truncated = dir + "/confinement_field_test_truncated.bin";
+		std::vector<char> bytes(size);
+		{
+			FILE* in = fopen(path.c_str(), "rb");
+			size_t nread = fread(&bytes[0], 1, bytes.size(), in);
+			fclose(in);
+			FILE* out = fopen(truncated.c_str(), "wb");
+			fwrite(&bytes[0], 1, nread - 4, out);
+			fclose(out);
+		}
+		ConfinementField damaged;
+		Check(!damaged.Load(truncated), "loaded a truncated field");
+		Check(!damaged.IsLoaded(), "kept a truncated field");
+
+		{
+			// 4096 samples an axis is allowed, but not without the 800gb of samples to go with it
+			const std::int32_t dims[3] = { 4096, 4096, 4096 };
+			memcpy(&bytes[12], dims, sizeof(dims));
+			FILE* out = fopen(truncated.c_str(), "wb");
+			fwrite(&bytes[0], 1, bytes.size(), out);
+			fclose(out);
+		}
+		Check(!damaged.Load(truncated), "loaded a field much smaller than its header says");
+
+		file = fopen(path.c_str(), "r+b");
+		fputc('X', file);
+		fclose(file);
+		Check(!damaged.Load(path), "loaded a field with the wrong magic");
+		Check(!damaged.Load(dir + "/no_such_confinement_field.bin"), "loaded a field that isn't there");
+
+		remove(path.c_str());
+		remove(truncated.c_str());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string dir = argc > 1 ? argv[1] : ".";
+	std::mt19937 rng(1);
+
+	auto desc = DefaultConfinementFieldDesc();
+	desc.Obstacles.push_back(ConfinementObstacle(Float4(40.0f, 20.0f, -40.0f), 12.0f, 8.0f, 20.0f));
+	ConfinementField field;
+	field.Bake(desc);
+
+	TestSamples(desc, field, rng);
+	TestLinear(rng);
+	desc.Obstacles.clear();
+	field.Bake(desc);
+	TestInterpolation(desc, field, rng);
+	TestFiles(field, dir, rng);
+
+	return Finish(std::to_string(field.NumSamples()) + " samples, " + std::to_string(field.Bytes() / 1024) + " kb");
+}
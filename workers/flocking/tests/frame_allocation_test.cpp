@@ -0,0 +1,80 @@
+// Steps a local flock until it has settled, then checks that whole frames go by without a single heap allocation.
+// Counts every operator new, from any thread, so a std::function or node container sneaking back onto the per
+// frame path shows up here.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+#include <string>
+
+#include "localworld.h"
+#include "logging.h"
+#include "simulation.h"
+#include "testutil.h"
+
+using namespace demoteam;
+using namespace testutil;
+
+namespace
+{
+	const int g_warmupFrames = 32;
+	const int g_measuredFrames = 16;
+
+	std::atomic_bool g_counting(false);
+	std::atomic<long long> g_allocations(0);
+
+	//***************************************************************************************************************
+	void* CountedAlloc(std::size_t size)
+	{
+		if (g_counting.load(std::memory_order_relaxed))
+		{
+			g_allocations.fetch_add(1, std::memory_order_relaxed);
+		}
+		void* ptr = malloc(size > 0 ? size : 1);
+		if (ptr == nullptr)
+		{
+			throw std::bad_alloc();
+		}
+		return ptr;
+	}
+}
+
+void* operator new(std::size_t size) { return CountedAlloc(size); }
+void* operator new[](std::size_t size) { return CountedAlloc(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return malloc(size > 0 ? size : 1); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return malloc(size > 0 ? size : 1); }
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { free(ptr); }
+
+int main()
+{
+	// the degradation levels don't allocate either, but keep the run the same everywhere
+	FlockingSimulation sim(RepeatableConfig(4));
+	LocalWorld world(DefaultLocalWorldParams());
+	world.SpawnBirds();
+	world.DelegateAll(sim);
+
+	auto logSink = [](logging::LogLevel, const std::string&, const std::string&) {};
+
+	long long subTick = 0;
+	for (int frame = 0; frame < g_warmupFrames + g_measuredFrames; ++frame)
+	{
+		bool measured = frame >= g_warmupFrames;
+
+		g_allocations.store(0);
+		g_counting.store(measured);
+		RunSubTicks(sim, world, sim.NumPhases(), subTick);
+		g_counting.store(false);
+
+		// formats strings, so it stays outside the measured part, as it does in the worker
+		logging::Drain(logSink);
+
+		Check(!measured || g_allocations.load() == 0, "frame " + std::to_string(frame) + " made " + std::to_string(g_allocations.load()) + " allocations");
+	}
+
+	return Finish(std::to_string(g_measuredFrames) + " steady state frames, " + std::to_string(sim.NumFlockers()) + " birds, no allocations");
+}
@@ -0,0 +1,112 @@
+// Feeds the frame budget controller loads by hand: a single long tick in an otherwise easy run mustn't change the
+// level, a run of them must, and so must a smoothed load that stays high with no tick over budget at all. Then that
+// it recovers once things calm down.
+//   FrameBudgetTest
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+
+#include "framebudget.h"
+#include "simulation.h"
+#include "testutil.h"
+
+using namespace demoteam;
+using namespace testutil;
+
+namespace
+{
+	const float g_easyLoad = 0.3f;
+	// half again over budget: enough that the old rule degraded on it at once, not enough to drag the smoothed load up
+	const float g_spikeLoad = 1.5f;
+
+	//***************************************************************************************************************
+	FrameBudgetPolicy TestPolicy()
+	{
+		return DefaultSimulationConfig().FrameBudget;
+	}
+
+	//***************************************************************************************************************
+	void Feed(FrameBudgetController& budget, float load, int numTicks)
+	{
+		for (int c0 = 0; c0 < numTicks; ++c0)
+		{
+			budget.Record(load);
+		}
+	}
+
+	//***************************************************************************************************************
+	void TestSpike()
+	{
+		auto policy = TestPolicy();
+		FrameBudgetController budget(policy);
+		Feed(budget, g_easyLoad, 32);
+		Check(!budget.Record(g_spikeLoad), "one long tick changed the level");
+		Check(budget.Level() == FullQuality, "one long tick left the level at " + std::to_string(budget.Level()));
+		Feed(budget, g_easyLoad, 32);
+		Check(budget.Level() == FullQuality, "the level moved after a single long tick");
+
+		// spikes with easy ticks between never make a run
+		for (int c0 = 0; c0 < 16; ++c0)
+		{
+			budget.Record(g_spikeLoad);
+			Feed(budget, g_easyLoad, 8);
+		}
+		Check(budget.Level() == FullQuality, "spread out long ticks changed the level");
+	}
+
+	//***************************************************************************************************************
+	void TestOverruns()
+	{
+		// smoothing slow enough that only the run of overruns can be what raises the level
+		auto policy = TestPolicy();
+		policy.Smoothing = 0.01f;
+		FrameBudgetController budget(policy);
+		Feed(budget, g_easyLoad, 32);
+		Feed(budget, g_spikeLoad, policy.OverrunsToRaise - 1);
+		Check(budget.Level() == FullQuality, "degraded before OverrunsToRaise ticks over budget");
+		Check(budget.Record(g_spikeLoad), "OverrunsToRaise ticks over budget didn't change the level");
+		Check(budget.Level() == CapCandidates, "a run of overruns went to level " + std::to_string(budget.Level()));
+
+		// and with them switched off, it waits for the smoothed load
+		policy.OverrunsToRaise = 0;
+		FrameBudgetController smoothedOnly(policy);
+		Feed(smoothedOnly, g_easyLoad, 32);
+		Feed(smoothedOnly, g_spikeLoad, 8);
+		Check(smoothedOnly.Level() == FullQuality, "OverrunsToRaise 0 still degraded on overruns");
+	}
+
+	//***************************************************************************************************************
+	void TestSmoothed()
+	{
+		// never over budget, but above RaiseAtLoad for long enough to pull the smoothed load up
+		auto policy = TestPolicy();
+		FrameBudgetController budget(policy);
+		Feed(budget, 0.95f, 64);
+		Check(budget.Level() == NumDegradationLevels - 1, "a sustained high load only got to level " + std::to_string(budget.Level()));
+
+		Feed(budget, g_easyLoad, policy.TicksToLower * NumDegradationLevels + 32);
+		Check(budget.Level() == FullQuality, "didn't recover, still at level " + std::to_string(budget.Level()));
+	}
+
+	//***************************************************************************************************************
+	void TestDisabled()
+	{
+		auto policy = TestPolicy();
+		policy.Enabled = false;
+		FrameBudgetController budget(policy);
+		Feed(budget, g_spikeLoad, 64);
+		Check(budget.Level() == FullQuality, "degraded with the budget off");
+	}
+}
+
+int main()
+{
+	TestSpike();
+	TestOverruns();
+	TestSmoothed();
+	TestDisabled();
+
+	return Finish();
+}
@@ -0,0 +1,8 @@
+// The box/sphere overlap checks that used to run at worker startup.
+
+#include "geometry.h"
+
+int main()
+{
+	return geometry::unitTest() ? 0 : 1;
+}
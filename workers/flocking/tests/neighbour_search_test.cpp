@@ -0,0 +1,571 @@
+// Randomised differential tests: the spatial grid against brute force over the whole snapshot.
+//   NeighbourSearchTest [seed]
+// Checks that radius queries return exactly the same set of entities, that the counts agree with
+// CountEntitiesWithinLinearSearch, and that UpdateFlocking steps every bird the same way whether it
+// searches the grid or one bucket holding everything (which is the linear search). The compact cells
+// get the same checks, to within their quantisation, and the far field is checked against brute force: exact
+// with Theta 0, close with the Theta the simulation uses. Neighbour lists built a few frames back, from a snapshot
+// in a different order, have to step every bird the same way as a fresh grid search. Queries, steering and the far
+// field (exact only) are checked again on grids with other cell sizes. Finally, the whole flock is moved a long way
+// from the world origin and the snapshot rebased onto it; it has to step the same way as it did at home.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "confinementfield.h"
+#include "farfield.h"
+#include "flocking.h"
+#include "flockerset.h"
+#include "localworld.h"
+#include "neighbourlists.h"
+#include "spatialgrid.h"
+#include "steering.h"
+
+using namespace demoteam;
+
+namespace
+{
+	const float g_gridSize = 8.0f;	// BuildSpatialGrid's
+	const float g_steeringTolerance = 1e-4f;
+	// the buckets' precomputed planes are for radii up to 18; past that they fall back to the box distance
+	const float g_queryRadii[] = { 24.0f, 18.0f, 17.99f, 8.0f, 0.5f };
+	// what CompactFlocker promises: positions to within 0.1mm; a step of steering lands within ~1cm of full precision
+	const float g_compactPositionTolerance = 1e-4f;
+	const float g_compactStepTolerance = 0.05f;
+	const float g_farFieldRanges[] = { 32.0f, 64.0f };
+	const float g_farFieldNearRange = 18.0f;	// BirdFlockParams' SearchRange
+	const float g_farFieldExactTolerance = 1e-2f;	// Theta 0; only the order of the float sums differs
+	// Theta 0.5, what the simulation uses, on average over the queries
+	const float g_farFieldTheta = 0.5f;
+	const float g_farFieldCountBias = 0.1f;
+	const float g_farFieldPositionFraction = 0.15f;	// of the range
+	const float g_farFieldVelocity = 0.75f;
+	const NeighbourListPolicy g_listPolicy = { 6.0f, 4.0f };	// the simulation's suggested settings
+	const int g_listFramesMoved = 3;	// under half the skin at 5.5m/s
+	// the same searches again over grids laid out some other way; all of them cover far_from_origin
+	const GridLayout g_otherLayouts[] = { { 5.0f, 1000.0f }, { 12.0f, 1000.0f } };
+	// their cells hand the candidates over in another order, so the steering sums round differently
+	const float g_otherLayoutSteeringTolerance = 1e-3f;
+	// far enough out that a float position is only good to a few centimetres
+	const double g_farOffset[] = { 250000.0, 0.0, -250000.0 };
+	// the distances are taken in floats rather than narrowed from doubles
+	const float g_localOriginTolerance = 1e-3f;
+
+	typedef std::mt19937 TRandom;
+	typedef std::function<Coordinates(TRandom&, int)> TPositionFunc;
+
+	//------------------------------------------
+	struct DistributionCase
+	{
+		const char* Name;
+		int NumBirds;
+		TPositionFunc Position;
+	};
+
+	int g_failures = 0;
+
+	//***************************************************************************************************************
+	void Fail(const std::string& what)
+	{
+		if (g_failures < 20)
+		{
+			printf("FAIL %s\n", what.c_str());
+		}
+		++g_failures;
+	}
+
+	//***************************************************************************************************************
+	float Uniform(TRandom& rng, float lo, float hi)
+	{
+		return std::uniform_real_distribution<float>(lo, hi)(rng);
+	}
+
+	//***************************************************************************************************************
+	std::vector<DistributionCase> BuildCases()
+	{
+		std::vector<DistributionCase> cases;
+
+		DistributionCase uniform = { "uniform", 3000, [](TRandom& rng, int)
+		{
+			return Coordinates(Uniform(rng, -192, 192), Uniform(rng, 10, 30), Uniform(rng, -192, 192));
+		} };
+		cases.push_back(uniform);
+
+		DistributionCase clustered = { "clustered", 3000, [](TRandom& rng, int ibird)
+		{
+			std::normal_distribution<float> gauss(0.0f, 5.0f);
+			float cx = (ibird % 4) * 40.0f - 60.0f;
+			return Coordinates(cx + gauss(rng), 20.0f + gauss(rng), gauss(rng));
+		} };
+		cases.push_back(clustered);
+
+		DistributionCase singleCell = { "single_cell", 500, [](TRandom& rng, int)
+		{
+			return Coordinates(Uniform(rng, 0.01f, 7.99f), Uniform(rng, 16.01f, 23.99f), Uniform(rng, 0.01f, 7.99f));
+		} };
+		cases.push_back(singleCell);
+
+		// on, or a hair either side of, bucket faces and edges; one axis is always left free so birds can't land on the
+		// same spot and tie for the neighbour cap
+		DistributionCase cellBoundaries = { "cell_boundaries", 2000, [](TRandom& rng, int)
+		{
+			const float offsets[] = { 0.0f, 1e-3f, -1e-3f };
+			int freeAxis = rng() % 3;
+			auto snap = [&rng, &offsets](float lo, float hi, bool free)
+			{
+				float pos = Uniform(rng, lo, hi);
+				return free ? pos : floorf(pos / g_gridSize) * g_gridSize + offsets[rng() % 3];
+			};
+			return Coordinates(snap(-48, 48, freeAxis == 0), snap(8, 40, freeAxis == 1), snap(-48, 48, freeAxis == 2));
+		} };
+		cases.push_back(cellBoundaries);
+
+		// pairs at almost exactly the search range from each other
+		DistributionCase atRange = { "at_search_range", 2000, [](TRandom& rng, int ibird)
+		{
+			TRandom pairRng(ibird / 2);
+			Coordinates centre(Uniform(pairRng, -64, 64), Uniform(pairRng, 10, 30), Uniform(pairRng, -64, 64));
+			if (ibird % 2 == 0)
+			{
+				return centre;
+			}
+			std::normal_distribution<float> gauss(0.0f, 1.0f);
+			Float4 dir = normalize(Float4(gauss(rng), gauss(rng), gauss(rng)));
+			return centre + dir*(18.0f * (1.0f + Uniform(rng, -1e-4f, 1e-4f)));
+		} };
+		cases.push_back(atRange);
+
+		// a long way out, still inside the grid's extents
+		DistributionCase farOut = { "far_from_origin", 2000, [](TRandom& rng, int)
+		{
+			return Coordinates(Uniform(rng, -990, -900), Uniform(rng, -990, -900), Uniform(rng, 900, 990));
+		} };
+		cases.push_back(farOut);
+
+		return cases;
+	}
+
+	//***************************************************************************************************************
+	void BuildWorld(const DistributionCase& dist, TRandom& rng, WorldSnapshot& world)
+	{
+		std::normal_distribution<float> gauss(0.0f, 1.0f);
+		for (int ibird = 0; ibird < dist.NumBirds; ++ibird)
+		{
+			auto pos = dist.Position(rng, ibird);
+			Float4 fwd(gauss(rng), gauss(rng), gauss(rng));
+			fwd = sqrMag(fwd) > epsilon ? normalize(fwd) : unitZ3<Float4>();
+			auto params = BirdFlockParams(Uniform(rng, 4.5f, 5.5f));
+			world.Add(1000 + ibird, FlockTransform(pos, fwd, fwd*params.Speed), &params);
+		}
+	}
+
+	//***************************************************************************************************************
+	std::set<TEntityId> GridQuery(const TBuckets& grid, const WorldSnapshot& world, TFloat4Arg pos, float r)
+	{
+		std::set<TEntityId> found;
+		Sphere sphere(pos, r);
+		forAllEntitiesWithinRadius(grid, world, sphere, [&found](TEntityId entityId, const FlockTransform&)
+		{
+			found.insert(entityId);
+			return true;
+		});
+		return found;
+	}
+
+	//***************************************************************************************************************
+	std::set<TEntityId> BruteForceQuery(const WorldSnapshot& world, TFloat4Arg pos, float r)
+	{
+		std::set<TEntityId> found;
+		Sphere sphere(pos, r);
+		for (int ient = 0; ient < world.Size(); ++ient)
+		{
+			if (sphereContains(sphere, ToFloat4(world.Transforms[ient].Position)))
+			{
+				found.insert(world.Ids[ient]);
+			}
+		}
+		return found;
+	}
+
+	//***************************************************************************************************************
+	void TestQueries(const DistributionCase& dist, const WorldSnapshot& world, const TBuckets& grid, TRandom& rng)
+	{
+		const int numQueries = 300;
+		for (int iquery = 0; iquery < numQueries; ++iquery)
+		{
+			// half at birds, half anywhere near them
+			int ient = rng() % world.Size();
+			auto pos = ToFloat4(world.Transforms[ient].Position);
+			bool atBird = iquery % 2 == 0;
+			if (!atBird)
+			{
+				pos = pos + Float4(Uniform(rng, -10, 10), Uniform(rng, -10, 10), Uniform(rng, -10, 10));
+			}
+
+			for (auto r : g_queryRadii)
+			{
+				auto expected = BruteForceQuery(world, pos, r);
+				auto actual = GridQuery(grid, world, pos, r);
+				if (expected != actual)
+				{
+					Fail(std::string(dist.Name) + ": grid found " + std::to_string(actual.size()) + " within " + std::to_string(r) +
+						", brute force " + std::to_string(expected.size()));
+				}
+
+				if (atBird)
+				{
+					int linear = CountEntitiesWithinLinearSearch(world, world.Ids[ient], pos, r);
+					int partitioned = actual.size() - (actual.count(world.Ids[ient]) > 0 ? 1 : 0);
+					if (linear != partitioned)
+					{
+						Fail(std::string(dist.Name) + ": CountEntitiesWithinLinearSearch " + std::to_string(linear) + " vs grid " + std::to_string(partitioned));
+					}
+				}
+			}
+		}
+	}
+
+	//***************************************************************************************************************
+	// updates come back by flocker slot, which is the bird's rank by id, whatever order the snapshot is in
+	void StepAll(const WorldSnapshot& world, const TBuckets& grid, TFlockersUpdate& updates, NeighbourLists* lists = nullptr, const ConfinementField* confinement = nullptr)
+	{
+		ScratchArena scratch;
+		FlockerSet flockers;
+		TScheduledFlockers work;
+		std::vector<TEntityId> ids(world.Ids);
+		std::sort(ids.begin(), ids.end());
+		for (int ibird = 0; ibird < static_cast<int>(ids.size()); ++ibird)
+		{
+			flockers.Add(ids[ibird]);
+			ScheduledFlocker scheduled = { ibird, 1.0f };
+			work.push_back(scheduled);
+		}
+		updates.assign(flockers.SlotCapacity(), SUpdateUpdate());
+		FlockingLimits limits = { 0, 1.0f, 0, false };
+		UpdateFlocking(flockers, updates, work, world, grid, 0, work.size(), limits, 0.125f, scratch, nullptr, lists, confinement);
+	}
+
+	//***************************************************************************************************************
+	void TestSteering(const DistributionCase& dist, const WorldSnapshot& world, const TBuckets& grid, float tolerance = g_steeringTolerance)
+	{
+		// one bucket over the whole world that everything passes the box test for: the linear search
+		float len = 1000.0f;
+		ScratchArena arena;
+		TBuckets linear;
+		linear.push_back(arena.New<SpatialBucket>(arena, 0, Aabb3(Float4(-len, -len, -len), Float4(len, len, len)), world.Ids[0], 0));
+		for (int ient = 1; ient < world.Size(); ++ient)
+		{
+			linear[0]->Entities.push_back(std::make_pair(world.Ids[ient], ient));
+		}
+
+		TFlockersUpdate expected;
+		TFlockersUpdate actual;
+		StepAll(world, linear, expected);
+		StepAll(world, grid, actual);
+
+		for (int ient = 0; ient < world.Size(); ++ient)
+		{
+			auto& e = expected[ient];
+			auto& a = actual[ient];
+			auto bird = std::string(dist.Name) + ": bird " + std::to_string(world.Ids[ient]);
+			if (!a.stepped || !e.stepped)
+			{
+				Fail(bird + " wasn't stepped");
+			}
+			else if (a.numCandidates != e.numCandidates)
+			{
+				Fail(bird + " saw " + std::to_string(a.numCandidates) + " candidates, linear " + std::to_string(e.numCandidates));
+			}
+			else if (!isZero(a.pos - e.pos, tolerance) || !isZero(a.facing - e.facing, tolerance) || !isZero(a.velocity - e.velocity, tolerance))
+			{
+				Fail(bird + " steered differently to the linear search");
+			}
+		}
+	}
+
+	//***************************************************************************************************************
+	FarFieldSums BruteForceFarField(const WorldSnapshot& world, int ient, float nearRange, float farRange)
+	{
+		FarFieldSums sums;
+		auto& me = world.Transforms[ient];
+		for (int ineighbour = 0; ineighbour < world.Size(); ++ineighbour)
+		{
+			// in floats like the tree, or a bird right on the near range can land on different sides of it
+			auto& them = world.Transforms[ineighbour];
+			auto lineTo = ToFloat4(them.Position) - ToFloat4(me.Position);
+			float distSqr = sqrMag(lineTo);
+			if (distSqr > sqr(nearRange) && distSqr < sqr(farRange) && dot(lineTo, me.Forward) >= 0.0f)
+			{
+				++sums.Count;
+				sums.SumPosition = sums.SumPosition + ToFloat4(them.Position);
+				sums.SumVelocity = sums.SumVelocity + them.Velocity;
+			}
+		}
+		return sums;
+	}
+
+	//***************************************************************************************************************
+	// how close Theta > 0 gets depends on the cell size, and the tolerances are for the default one
+	void TestFarField(const DistributionCase& dist, const WorldSnapshot& world, const TBuckets& grid, const GridLayout& layout, bool exactOnly, TRandom& rng)
+	{
+		const int numQueries = 200;
+		for (auto range : g_farFieldRanges)
+		{
+			for (int itheta = 0; itheta < (exactOnly ? 1 : 2); ++itheta)
+			{
+				bool exact = itheta == 0;
+				FarFieldPolicy policy = { range, exact ? 0.0f : g_farFieldTheta };
+				ScratchArena arena;
+				FarFieldTree farField;
+				farField.Build(grid, world, policy, arena, layout);
+
+				auto what = std::string(dist.Name) + ": far field to " + std::to_string(static_cast<int>(range)) + (exact ? ", exact," : "");
+				auto meanPos = [](const FarFieldSums& sums) { return sums.SumPosition * (1.0f / sums.Count); };
+				auto meanVel = [](const FarFieldSums& sums) { return sums.SumVelocity * (1.0f / sums.Count); };
+
+				// Theta > 0 is judged over all the queries, single birds can come out well off when a cell is cut in two
+				int expectedTotal = 0;
+				int countError = 0;
+				float positionError = 0.0f;
+				float velocityError = 0.0f;
+				int numCompared = 0;
+				for (int iquery = 0; iquery < numQueries; ++iquery)
+				{
+					int ient = rng() % world.Size();
+					auto& transform = world.Transforms[ient];
+					auto expected = BruteForceFarField(world, ient, g_farFieldNearRange, range);
+					auto actual = farField.Query(ToFloat4(transform.Position), transform.Forward, g_farFieldNearRange, world);
+
+					expectedTotal += expected.Count;
+					countError += actual.Count - expected.Count;
+					if (exact && actual.Count != expected.Count)
+					{
+						Fail(what + " counted " + std::to_string(actual.Count) + ", brute force " + std::to_string(expected.Count));
+						continue;
+					}
+					if (expected.Count == 0 || actual.Count == 0)
+					{
+						continue;
+					}
+
+					float positionOut = mag(meanPos(actual) - meanPos(expected));
+					float velocityOut = mag(meanVel(actual) - meanVel(expected));
+					if (exact && (positionOut > g_farFieldExactTolerance || velocityOut > g_farFieldExactTolerance))
+					{
+						Fail(what + " put the means out by " + std::to_string(positionOut) + " and " + std::to_string(velocityOut));
+					}
+					positionError += positionOut;
+					velocityError += velocityOut;
+					++numCompared;
+				}
+
+				if (!exact && expectedTotal > 0)
+				{
+					float countBias = static_cast<float>(countError) / expectedTotal;
+					float meanPositionError = numCompared > 0 ? positionError / numCompared : 0.0f;
+					float meanVelocityError = numCompared > 0 ? velocityError / numCompared : 0.0f;
+					if (fabsf(countBias) > g_farFieldCountBias || meanPositionError > range * g_farFieldPositionFraction || meanVelocityError > g_farFieldVelocity)
+					{
+						Fail(what + " is further out than it should be: count bias " + std::to_string(countBias) + ", centre of mass " +
+							std::to_string(meanPositionError) + ", mean velocity " + std::to_string(meanVelocityError));
+					}
+				}
+			}
+		}
+	}
+
+	//***************************************************************************************************************
+	void TestNeighbourLists(const DistributionCase& dist, const WorldSnapshot& world, const TBuckets& grid)
+	{
+		NeighbourLists lists(g_listPolicy);
+		lists.Resize(world.Size());
+		TFlockersUpdate built;
+		StepAll(world, grid, built, &lists);
+
+		// a few frames on, everyone flown straight, and the snapshot the other way round so every index is stale
+		WorldSnapshot moved;
+		for (int ient = world.Size() - 1; ient >= 0; --ient)
+		{
+			auto transform = world.Transforms[ient];
+			transform.Position = transform.Position + transform.Velocity*(0.125f * g_listFramesMoved);
+			moved.Add(world.Ids[ient], transform, &world.Params[ient]);
+		}
+		ScratchArena arena;
+		TBuckets movedGrid;
+		BuildSpatialGrid(movedGrid, moved, arena);
+
+		TFlockersUpdate expected;
+		TFlockersUpdate actual;
+		StepAll(moved, movedGrid, expected);
+		StepAll(moved, movedGrid, actual, &lists);
+
+		for (int islot = 0; islot < static_cast<int>(expected.size()); ++islot)
+		{
+			auto& e = expected[islot];
+			auto& a = actual[islot];
+			auto bird = std::string(dist.Name) + ": bird in slot " + std::to_string(islot);
+			if (a.numCandidates != e.numCandidates)
+			{
+				Fail(bird + " saw " + std::to_string(a.numCandidates) + " candidates from its list, " + std::to_string(e.numCandidates) + " from the grid");
+			}
+			else if (!isZero(a.pos - e.pos, g_steeringTolerance) || !isZero(a.facing - e.facing, g_steeringTolerance) || !isZero(a.velocity - e.velocity, g_steeringTolerance))
+			{
+				Fail(bird + " steered differently from its list");
+			}
+		}
+	}
+
+	//***************************************************************************************************************
+	void TestCompactCells(const DistributionCase& dist, const WorldSnapshot& world, TBuckets& grid, ScratchArena& arena, TRandom& rng)
+	{
+		TFlockersUpdate expected;
+		StepAll(world, grid, expected);
+
+		BuildCompactCells(grid, world, arena);
+
+		// the same entities as the full precision search, bar any within the quantisation step of the edge
+		const int numQueries = 100;
+		for (int iquery = 0; iquery < numQueries; ++iquery)
+		{
+			auto pos = ToFloat4(world.Transforms[rng() % world.Size()].Position);
+			for (auto r : g_queryRadii)
+			{
+				auto full = GridQuery(grid, world, pos, r);
+				std::set<TEntityId> compact;
+				Sphere sphere(pos, r);
+				forAllCompactWithinRadius(grid, sphere, [&world, &compact, &dist](const SpatialBucket&, const CompactFlocker& ent, TFloat4Arg decoded)
+				{
+					if (!isZero(decoded - ToFloat4(world.Transforms[ent.EntityIndex].Position), g_compactPositionTolerance))
+					{
+						Fail(std::string(dist.Name) + ": compact position for " + std::to_string(world.Ids[ent.EntityIndex]) + " is too far out");
+					}
+					compact.insert(world.Ids[ent.EntityIndex]);
+					return true;
+				});
+
+				std::vector<TEntityId> differ;
+				std::set_symmetric_difference(full.begin(), full.end(), compact.begin(), compact.end(), std::back_inserter(differ));
+				for (auto itId = differ.begin(); itId != differ.end(); ++itId)
+				{
+					float distance = mag(ToFloat4(world.Transforms[world.IndexOf(*itId)].Position) - pos);
+					if (fabsf(distance - r) > g_compactPositionTolerance)
+					{
+						Fail(std::string(dist.Name) + ": compact search disagrees about " + std::to_string(*itId) + ", " + std::to_string(distance) + " from a " + std::to_string(r) + " query");
+					}
+				}
+			}
+		}
+
+		TFlockersUpdate actual;
+		StepAll(world, grid, actual);
+		for (int ient = 0; ient < world.Size(); ++ient)
+		{
+			if (!isZero(actual[ient].pos - expected[ient].pos, g_compactStepTolerance))
+			{
+				Fail(std::string(dist.Name) + ": bird " + std::to_string(world.Ids[ient]) + " stepped too differently over the compact cells");
+			}
+		}
+	}
+	//***************************************************************************************************************
+	void TestLocalOrigin(const DistributionCase& dist, const WorldSnapshot& world, const TBuckets& grid)
+	{
+		Coordinates offset(g_farOffset[0], g_farOffset[1], g_farOffset[2]);
+		WorldSnapshot far;
+		for (int ient = 0; ient < world.Size(); ++ient)
+		{
+			auto transform = world.Transforms[ient];
+			transform.Position = offset + transform.Position;
+			far.Add(world.Ids[ient], transform, &world.Params[ient]);
+		}
+		far.Rebase(offset);
+
+		ScratchArena arena;
+		TBuckets farGrid;
+		BuildSpatialGrid(farGrid, far, arena);
+
+		// the built in bounds are anchored to the world origin and would turn the far flock round; a field that's
+		// zero everywhere stands in for them, so only the flocking itself is left to compare
+		ConfinementFieldDesc desc;
+		desc.RightTopFront = one3<Float4>() * g_gridSize;
+		desc.CellSize = g_gridSize;
+		ConfinementField noBounds;
+		noBounds.Bake(desc);
+
+		TFlockersUpdate expected;
+		TFlockersUpdate actual;
+		StepAll(world, grid, expected, nullptr, &noBounds);
+		StepAll(far, farGrid, actual, nullptr, &noBounds);
+
+		for (int islot = 0; islot < static_cast<int>(expected.size()); ++islot)
+		{
+			auto& e = expected[islot];
+			auto& a = actual[islot];
+			auto bird = std::string(dist.Name) + ": bird in slot " + std::to_string(islot);
+			if (a.numCandidates != e.numCandidates)
+			{
+				Fail(bird + " saw " + std::to_string(a.numCandidates) + " candidates far from the origin, " + std::to_string(e.numCandidates) + " near it");
+			}
+			else if (!isZero(a.pos - offset - (e.pos - zero3<Coordinates>()), g_localOriginTolerance) ||
+				!isZero(a.facing - e.facing, g_localOriginTolerance) || !isZero(a.velocity - e.velocity, g_localOriginTolerance))
+			{
+				Fail(bird + " steered differently far from the origin");
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned int seed = argc > 1 ? static_cast<unsigned int>(atoi(argv[1])) : 1;
+	printf("seed %u\n", seed);
+
+	auto cases = BuildCases();
+	for (auto itCase = cases.begin(); itCase != cases.end(); ++itCase)
+	{
+		TRandom rng(seed);
+		WorldSnapshot world;
+		BuildWorld(*itCase, rng, world);
+
+		ScratchArena arena;
+		TBuckets grid;
+		BuildSpatialGrid(grid, world, arena);
+
+		int failuresBefore = g_failures;
+		TestQueries(*itCase, world, grid, rng);
+		TestSteering(*itCase, world, grid);
+		TestFarField(*itCase, world, grid, g_defaultGridLayout, false, rng);
+		TestNeighbourLists(*itCase, world, grid);
+		TestLocalOrigin(*itCase, world, grid);
+		TestCompactCells(*itCase, world, grid, arena, rng);
+
+		for (auto itLayout = std::begin(g_otherLayouts); itLayout != std::end(g_otherLayouts); ++itLayout)
+		{
+			auto name = std::string(itCase->Name) + " in " + std::to_string(static_cast<int>(itLayout->CellSize)) + "m cells";
+			auto layoutCase = *itCase;
+			layoutCase.Name = name.c_str();
+
+			ScratchArena layoutArena;
+			TBuckets layoutGrid;
+			BuildSpatialGrid(layoutGrid, world, layoutArena, *itLayout);
+			TestQueries(layoutCase, world, layoutGrid, rng);
+			TestSteering(layoutCase, world, layoutGrid, g_otherLayoutSteeringTolerance);
+			TestFarField(layoutCase, world, layoutGrid, *itLayout, true, rng);
+		}
+		printf("%s %s (%d birds, %d buckets)\n", g_failures == failuresBefore ? "ok  " : "FAIL", itCase->Name, world.Size(), static_cast<int>(grid.size()));
+	}
+
+	if (g_failures > 0)
+	{
+		printf("%d failures\n", g_failures);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,168 @@
+// Records a local flock, then replays the recording twice with the frame budget switched off and checks the two
+// checksums match. The budget is set to degrade on every tick, so that only holds if switching it off really does
+// hold the level; a third replay with it left on has to come out different. Then recordings with impossible entity
+// and player counts have to be turned away as corrupt, rather than taken at their word.
+//   ReplayTest [scratchDir]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "localworld.h"
+#include "recording.h"
+#include "simulation.h"
+#include "testutil.h"
+
+using namespace demoteam;
+using namespace testutil;
+
+namespace
+{
+	const int g_numBirds = 512;
+	const int g_numFrames = 24;
+	const int g_headerBytes = 12;	// magic and version
+
+	//------------------------------------------
+	class RecordingWorld : public LocalWorld
+	{
+	public:
+		RecordingWorld(const LocalWorldParams& params, WorldRecorder& recorder) : LocalWorld(params), Recorder(recorder) {}
+
+		virtual void ReadWorld(WorldSnapshot& world)
+		{
+			LocalWorld::ReadWorld(world);
+			Recorder.Frame(world);
+		}
+
+		WorldRecorder& Recorder;
+	};
+
+	//***************************************************************************************************************
+	void Record(const std::string& path)
+	{
+		auto params = DefaultLocalWorldParams();
+		params.NumBirds = g_numBirds;
+		params.NumBirdCells = 1;
+
+		FlockingSimulation sim(RepeatableConfig(2));
+		WorldRecorder recorder;
+		Check(recorder.Open(path), "couldn't open " + path + " to record to");
+		RecordingWorld world(params, recorder);
+		world.SpawnBirds();
+		for (int ient = 0; ient < world.NumEntities(); ++ient)
+		{
+			recorder.AuthorityGained(world.IdAt(ient));
+		}
+		world.DelegateAll(sim);
+
+		RunSubTicks(sim, world, g_numFrames * sim.NumPhases());
+		recorder.Close();
+	}
+
+	//***************************************************************************************************************
+	// false if the replay didn't get to the end cleanly
+	bool Replay(const std::string& path, const SimulationConfig& config, unsigned long long& checksum)
+	{
+		FlockingSimulation sim(config);
+		WorldReplay replay(sim);
+		if (!replay.Open(path))
+		{
+			return false;
+		}
+
+		long long subTick = 0;
+		while (!replay.AtEnd())
+		{
+			RunSubTicks(sim, replay, sim.NumPhases(), subTick);
+		}
+		checksum = replay.UpdateChecksum();
+		return !replay.Failed() && replay.FramesRead() > 0;
+	}
+
+	//***************************************************************************************************************
+	void TestRepeatable(const std::string& path)
+	{
+		// degrades on every tick it's allowed to
+		auto config = RepeatableConfig(2);
+		config.FrameBudget.RaiseAtLoad = 0.0f;
+		config.FrameBudget.LowerAtLoad = -1.0f;
+
+		unsigned long long first = 0;
+		unsigned long long second = 0;
+		Check(Replay(path, config, first) && Replay(path, config, second), "the recording didn't replay");
+		Check(first == second, "replaying the same recording twice gave " + std::to_string(first) + " then " + std::to_string(second));
+
+		config.FrameBudget.Enabled = true;
+		unsigned long long degraded = 0;
+		Check(Replay(path, config, degraded), "the recording didn't replay with the budget on");
+		Check(degraded != first, "degrading every tick made no difference, so the test can't tell the budget is off");
+	}
+
+	//***************************************************************************************************************
+	std::vector<char> ReadFile(const std::string& path)
+	{
+		std::vector<char> bytes;
+		FILE* file = fopen(path.c_str(), "rb");
+		if (file != nullptr)
+		{
+			char buf[4096];
+			for (size_t n = fread(buf, 1, sizeof(buf), file); n > 0; n = fread(buf, 1, sizeof(buf), file))
+			{
+				bytes.insert(bytes.end(), buf, buf + n);
+			}
+			fclose(file);
+		}
+		return bytes;
+	}
+
+	//***************************************************************************************************************
+	void WriteFile(const std::string& path, const std::vector<char>& bytes)
+	{
+		FILE* file = fopen(path.c_str(), "wb");
+		if (file != nullptr)
+		{
+			fwrite(&bytes[0], 1, bytes.size(), file);
+			fclose(file);
+		}
+	}
+
+	//***************************************************************************************************************
+	// a good header, then a frame that's nothing but a count of entities and one of players
+	void TestBadCounts(const std::string& path, const std::string& scratch)
+	{
+		auto good = ReadFile(path);
+		Check(good.size() > g_headerBytes, "the recording is empty");
+
+		const std::int32_t counts[][2] = { { 0x7fffffff, 0 }, { -5, 0 }, { 0, 0x7fffffff }, { 0, -1 } };
+		for (size_t c0 = 0; c0 < sizeof(counts) / sizeof(counts[0]); ++c0)
+		{
+			std::vector<char> bytes(good.begin(), good.begin() + g_headerBytes);
+			bytes.push_back('F');
+			auto nents = reinterpret_cast<const char*>(&counts[c0][0]);
+			auto nplayers = reinterpret_cast<const char*>(&counts[c0][1]);
+			bytes.insert(bytes.end(), nents, nents + sizeof(std::int32_t));
+			bytes.insert(bytes.end(), nplayers, nplayers + sizeof(std::int32_t));
+			WriteFile(scratch, bytes);
+
+			unsigned long long checksum = 0;
+			Check(!Replay(scratch, RepeatableConfig(2), checksum), "took a frame of " + std::to_string(counts[c0][0]) + " entities and " + std::to_string(counts[c0][1]) + " players");
+		}
+		remove(scratch.c_str());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string dir = argc > 1 ? argv[1] : ".";
+	std::string path = dir + "/replay_test.rec";
+
+	Record(path);
+	TestRepeatable(path);
+	TestBadCounts(path, dir + "/replay_test_bad.rec");
+	remove(path.c_str());
+
+	return Finish();
+}
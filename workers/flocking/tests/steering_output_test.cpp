@@ -0,0 +1,171 @@
+// Runs the same flock twice in step, once sending every bird's whole transform every step and once with
+// update_mode=steering, behind a receiver that integrates the target velocities the way a client does. The two
+// simulations have to stay identical, even though the steering one's host only ever hears keyframes; every keyframe
+// has to be exactly where the other run has the bird; the receiver's integrated positions have to stay within the
+// drift tolerance; and fewer updates should go out, most of them a single vector.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+#include "localworld.h"
+#include "simulation.h"
+#include "testutil.h"
+
+using namespace demoteam;
+using namespace testutil;
+
+namespace
+{
+	const int g_numBirds = 512;
+	const int g_numFrames = 160;
+
+	//------------------------------------------
+	// keeps where each bird it heard from this sub tick was sent to
+	class TruthHost : public LocalWorld
+	{
+	public:
+		explicit TruthHost(const LocalWorldParams& params) : LocalWorld(params) {}
+
+		virtual void SendTransformUpdate(TEntityId entityId, const FlockTransformUpdate& update)
+		{
+			LocalWorld::SendTransformUpdate(entityId, update);
+			Sent.insert(std::make_pair(entityId, update.Position));
+		}
+
+		std::unordered_map<TEntityId, Coordinates> Sent;
+	};
+
+	//------------------------------------------
+	// integrates from each keyframe along the latest target velocity, as DemoPositionVisualizer does
+	class IntegratingHost : public LocalWorld
+	{
+	public:
+		explicit IntegratingHost(const LocalWorldParams& params) : LocalWorld(params), Time(0.0), NumKeyframes(0), NumTargets(0) {}
+
+		virtual void SendTransformUpdate(TEntityId entityId, const FlockTransformUpdate& update)
+		{
+			LocalWorld::SendTransformUpdate(entityId, update);
+			if (update.HasPosition)
+			{
+				++NumKeyframes;
+				Birds.erase(entityId);
+				Birds.insert(std::make_pair(entityId, Integrated(update.Position, update.Velocity, Time)));
+				Keyframes.insert(std::make_pair(entityId, update.Position));
+			}
+			if (update.HasTargetVelocity)
+			{
+				++NumTargets;
+				auto& bird = Birds.find(entityId)->second;
+				bird = Integrated(Where(entityId, Time), update.TargetVelocity, Time);
+			}
+		}
+
+		Coordinates Where(TEntityId entityId, double time) const
+		{
+			auto& bird = Birds.find(entityId)->second;
+			return bird.Position + bird.Velocity*static_cast<float>(time - bird.Time);
+		}
+
+		struct Integrated
+		{
+			Integrated(const Coordinates& position, TFloat4Arg velocity, double time) : Position(position), Velocity(velocity), Time(time) {}
+			Coordinates Position;
+			Float4 Velocity;
+			double Time;
+		};
+
+		std::unordered_map<TEntityId, Integrated> Birds;
+		// the keyframes sent this sub tick
+		std::unordered_map<TEntityId, Coordinates> Keyframes;
+		double Time;
+		long long NumKeyframes;
+		long long NumTargets;
+	};
+
+	//***************************************************************************************************************
+	SimulationConfig TestConfig(TransformUpdateMode mode)
+	{
+		auto config = RepeatableConfig(2);
+		config.UpdateMode = mode;
+		return config;
+	}
+
+	//***************************************************************************************************************
+	void TestSteering()
+	{
+		auto params = DefaultLocalWorldParams();
+		params.NumBirds = g_numBirds;
+		params.NumBirdCells = 1;
+
+		auto fullConfig = TestConfig(FullUpdates);
+		auto steeringConfig = TestConfig(SteeringUpdates);
+		FlockingSimulation fullSim(fullConfig);
+		FlockingSimulation steeringSim(steeringConfig);
+		TruthHost truth(params);
+		IntegratingHost receiver(params);
+		truth.SpawnBirds();
+		receiver.SpawnBirds();
+		truth.DelegateAll(fullSim);
+		receiver.DelegateAll(steeringSim);
+
+		const float tolerance = steeringConfig.UpdateThresholds.DeadReckoningDrift * 1.01f + 0.001f;
+		int numMismatched = 0;
+		int numDrifted = 0;
+		float worstDrift = 0.0f;
+		for (long long subTick = 0; subTick < g_numFrames * steeringSim.NumPhases(); ++subTick)
+		{
+			receiver.Time = subTick * SubTickSeconds(steeringSim);
+			truth.Sent.clear();
+			receiver.Keyframes.clear();
+			fullSim.Tick(truth, receiver.Time);
+			steeringSim.Tick(receiver, receiver.Time);
+
+			for (auto itSent = truth.Sent.begin(); itSent != truth.Sent.end(); ++itSent)
+			{
+				auto& position = itSent->second;
+				auto itKeyframe = receiver.Keyframes.find(itSent->first);
+				if (itKeyframe != receiver.Keyframes.end() && sqrMag(itKeyframe->second - position) != 0.0f)
+				{
+					++numMismatched;
+				}
+				if (receiver.Birds.count(itSent->first) == 0)
+				{
+					++numDrifted;
+					continue;
+				}
+				float drift = mag(receiver.Where(itSent->first, receiver.Time) - position);
+				worstDrift = std::max(worstDrift, drift);
+				if (drift > tolerance)
+				{
+					++numDrifted;
+				}
+			}
+		}
+
+		Check(fullSim.BirdSteps() == steeringSim.BirdSteps() && fullSim.BirdSteps() > 0, "the two runs stepped " + std::to_string(fullSim.BirdSteps()) + " and " + std::to_string(steeringSim.BirdSteps()) + " birds");
+		Check(numMismatched == 0, std::to_string(numMismatched) + " keyframes weren't where the other run had the bird");
+		Check(numDrifted == 0, std::to_string(numDrifted) + " integrated positions drifted past the tolerance; worst " + std::to_string(worstDrift) + "m");
+
+		// at most one target velocity a bird every SteeringSeconds, keyframes well short of that, and nothing else
+		long long sent = receiver.NumKeyframes + receiver.NumTargets;
+		const double seconds = g_numFrames / static_cast<double>(steeringConfig.TargetFPS);
+		const long long maxTargets = static_cast<long long>(g_numBirds * (seconds / steeringConfig.UpdateThresholds.SteeringSeconds + 1.0));
+		Check(sent == steeringSim.UpdatesSent(), "the receiver heard " + std::to_string(sent) + " updates of " + std::to_string(steeringSim.UpdatesSent()));
+		Check(receiver.NumTargets <= maxTargets, std::to_string(receiver.NumTargets) + " target velocities went out, against at most " + std::to_string(maxTargets));
+		Check(receiver.NumKeyframes * 2 < receiver.NumTargets, std::to_string(receiver.NumKeyframes) + " keyframes against " + std::to_string(receiver.NumTargets) + " target velocities");
+		Check(sent * 3 < fullSim.UpdatesSent() * 2, std::to_string(sent) + " steering updates against " + std::to_string(fullSim.UpdatesSent()) + " whole ones");
+		printf("%lld keyframes and %lld target velocities in place of %lld transforms; worst drift %.3fm\n", receiver.NumKeyframes, receiver.NumTargets, fullSim.UpdatesSent(), worstDrift);
+	}
+}
+
+int main()
+{
+	TestSteering();
+
+	return Finish();
+}
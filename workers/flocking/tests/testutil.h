@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdio.h>
+
+#include <string>
+
+#include "simulation.h"
+
+// What the tests share: a count of failed checks that Finish turns into the exit code, a config for runs that have
+// to come out the same every time, and stepping a simulation sub tick by sub tick the way the worker's loop does.
+namespace testutil
+{
+	//***************************************************************************************************************
+	inline int& Failures()
+	{
+		static int failures = 0;
+		return failures;
+	}
+
+	//***************************************************************************************************************
+	inline void Check(bool passed, const std::string& what)
+	{
+		if (!passed)
+		{
+			printf("FAIL %s\n", what.c_str());
+			++Failures();
+		}
+	}
+
+	//***************************************************************************************************************
+	// what main returns; detail goes on the end of the "ok" line
+	inline int Finish(const std::string& detail = std::string())
+	{
+		if (Failures() > 0)
+		{
+			printf("%d failures\n", Failures());
+			return 1;
+		}
+		printf(detail.empty() ? "ok\n" : "ok   %s\n", detail.c_str());
+		return 0;
+	}
+
+	//***************************************************************************************************************
+	// degradation depends on how long ticks take on the machine, so it stays off
+	inline demoteam::SimulationConfig RepeatableConfig(int numThreads)
+	{
+		auto config = demoteam::DefaultSimulationConfig();
+		config.NumThreads = numThreads;
+		config.FrameBudget.Enabled = false;
+		return config;
+	}
+
+	//***************************************************************************************************************
+	inline double SubTickSeconds(const demoteam::FlockingSimulation& sim)
+	{
+		return sim.MicrosecondsPerSubTick() / 1e6;
+	}
+
+	//***************************************************************************************************************
+	// count sub ticks on from subTick, which ends up just past them
+	inline void RunSubTicks(demoteam::FlockingSimulation& sim, demoteam::IFlockingHost& host, long long count, long long& subTick)
+	{
+		for (long long end = subTick + count; subTick < end; ++subTick)
+		{
+			sim.Tick(host, subTick * SubTickSeconds(sim));
+		}
+	}
+
+	inline void RunSubTicks(demoteam::FlockingSimulation& sim, demoteam::IFlockingHost& host, long long count)
+	{
+		long long subTick = 0;
+		RunSubTicks(sim, host, count, subTick);
+	}
+}
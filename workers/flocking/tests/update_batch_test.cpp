@@ -0,0 +1,141 @@
+// Runs the same flock behind a host that only takes updates one at a time and behind one that encodes them on the
+// pool, as the worker does, and checks the second sends exactly what the first does, in the same order: every
+// update prepared once, off the main thread, by more than one thread, and sent from the batch it was prepared in.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "localworld.h"
+#include "simulation.h"
+#include "testutil.h"
+
+using namespace demoteam;
+using namespace testutil;
+
+namespace
+{
+	const int g_numBirds = 1024;
+	const int g_numThreads = 4;
+	const int g_numFrames = 24;
+
+	//***************************************************************************************************************
+	// the update as text, which is as good as an encoding for comparing
+	std::string Encode(TEntityId entityId, const FlockTransformUpdate& update)
+	{
+		char buf[256];
+		snprintf(buf, sizeof(buf), "%lld %d%d%d%d %.17g %.17g %.17g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g",
+			static_cast<long long>(entityId), update.HasPosition, update.HasForward, update.HasVelocity, update.HasTargetVelocity,
+			update.Position.X(), update.Position.Y(), update.Position.Z(),
+			update.Forward.X(), update.Forward.Y(), update.Forward.Z(),
+			update.Velocity.X(), update.Velocity.Y(), update.Velocity.Z(),
+			update.TargetVelocity.X(), update.TargetVelocity.Y(), update.TargetVelocity.Z());
+		return buf;
+	}
+
+	//------------------------------------------
+	class OneAtATimeHost : public LocalWorld
+	{
+	public:
+		explicit OneAtATimeHost(const LocalWorldParams& params) : LocalWorld(params) {}
+
+		virtual void SendTransformUpdate(TEntityId entityId, const FlockTransformUpdate& update)
+		{
+			LocalWorld::SendTransformUpdate(entityId, update);
+			Sent.push_back(Encode(entityId, update));
+		}
+
+		std::vector<std::string> Sent;
+	};
+
+	//------------------------------------------
+	class BatchingHost : public LocalWorld
+	{
+	public:
+		explicit BatchingHost(const LocalWorldParams& params) :
+			LocalWorld(params), MainThread(std::this_thread::get_id()), Batches(g_maxSimulationThreads), NumPrepared(0), NumOnMainThread(0), NumThreadsUsed(0), NumUnprepared(0)
+		{
+		}
+
+		virtual void PrepareTransformUpdates(int threadId, const PendingTransformUpdate* updates, int count)
+		{
+			if (std::this_thread::get_id() == MainThread)
+			{
+				++NumOnMainThread;
+			}
+			auto& batch = Batches[threadId];
+			batch.clear();
+			for (int iupdate = 0; iupdate < count; ++iupdate)
+			{
+				batch.push_back(Encode(updates[iupdate].EntityId, updates[iupdate].Update));
+			}
+		}
+
+		virtual void SendPreparedTransformUpdates(int threadId, const PendingTransformUpdate* updates, int count)
+		{
+			auto& batch = Batches[threadId];
+			if (static_cast<int>(batch.size()) != count)
+			{
+				++NumUnprepared;
+			}
+			for (int iupdate = 0; iupdate < count; ++iupdate)
+			{
+				LocalWorld::SendTransformUpdate(updates[iupdate].EntityId, updates[iupdate].Update);
+			}
+			Sent.insert(Sent.end(), batch.begin(), batch.end());
+			NumPrepared += batch.size();
+			NumThreadsUsed += batch.empty() ? 0 : 1;
+			batch.clear();
+		}
+
+		std::thread::id MainThread;
+		std::vector<std::vector<std::string>> Batches;
+		std::vector<std::string> Sent;
+		long long NumPrepared;
+		int NumOnMainThread;
+		int NumThreadsUsed;
+		int NumUnprepared;
+	};
+
+	//***************************************************************************************************************
+	void TestBatches(TransformUpdateMode mode, const char* modeName)
+	{
+		auto params = DefaultLocalWorldParams();
+		params.NumBirds = g_numBirds;
+		params.NumBirdCells = 1;
+
+		auto config = RepeatableConfig(g_numThreads);
+		config.UpdateMode = mode;
+
+		FlockingSimulation plainSim(config);
+		FlockingSimulation batchingSim(config);
+		OneAtATimeHost plain(params);
+		BatchingHost batching(params);
+		plain.SpawnBirds();
+		batching.SpawnBirds();
+		plain.DelegateAll(plainSim);
+		batching.DelegateAll(batchingSim);
+
+		RunSubTicks(plainSim, plain, g_numFrames * plainSim.NumPhases());
+		RunSubTicks(batchingSim, batching, g_numFrames * batchingSim.NumPhases());
+
+		std::string prefix = std::string(modeName) + ": ";
+		Check(!plain.Sent.empty() && batching.Sent == plain.Sent, prefix + "batched " + std::to_string(batching.Sent.size()) + " updates, one at a time " + std::to_string(plain.Sent.size()) + ", or they differed");
+		Check(batching.NumPrepared == batchingSim.UpdatesSent(), prefix + std::to_string(batching.NumPrepared) + " updates prepared of " + std::to_string(batchingSim.UpdatesSent()) + " sent");
+		Check(batching.NumUnprepared == 0, prefix + std::to_string(batching.NumUnprepared) + " batches were sent that weren't the ones prepared");
+		Check(batching.NumOnMainThread == 0, prefix + std::to_string(batching.NumOnMainThread) + " batches were prepared on the main thread");
+		Check(batching.NumThreadsUsed > g_numFrames * plainSim.NumPhases(), prefix + "only " + std::to_string(batching.NumThreadsUsed) + " batches over " + std::to_string(g_numFrames * plainSim.NumPhases()) + " sub ticks");
+	}
+}
+
+int main()
+{
+	TestBatches(FullUpdates, "full");
+	TestBatches(ThresholdUpdates, "threshold");
+	TestBatches(SteeringUpdates, "steering");
+
+	return Finish();
+}
@@ -0,0 +1,277 @@
+// Warm starts a simulation from a snapshot behind a host whose view fills in a little at a time, as a restarted
+// worker's does: every bird is stepped from the first frame, nothing goes out for a bird until the view confirms
+// it, the view's entities take over from the snapshot's, and birds the view never confirms are let go. Then that
+// damaged snapshots are turned away without touching the simulation.
+//   WarmStartTest [scratchDir]
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "localworld.h"
+#include "simulation.h"
+#include "warmstart.h"
+#include "testutil.h"
+
+using namespace demoteam;
+using namespace testutil;
+
+namespace
+{
+	const int g_numBirds = 256;
+	// birds in the snapshot the old worker wasn't authoritative over
+	const int g_numOthers = 16;
+	const long long g_snapshotFrame = 123;
+
+	//------------------------------------------
+	// a view that only has the first Revealed of the live world's entities, with the warm start filling in the rest
+	class StreamingHost : public IFlockingHost
+	{
+	public:
+		StreamingHost(LocalWorld& live, FlockingSimulation& sim, WarmStart& warmStart) : Live(live), Sim(sim), Warm(warmStart), Revealed(0), LastWorldSize(0)
+		{
+		}
+
+		virtual void ReadWorld(WorldSnapshot& world)
+		{
+			All.Clear();
+			Live.ReadWorld(All);
+			for (int ient = 0; ient < std::min(Revealed, All.Size()); ++ient)
+			{
+				world.Add(All.Ids[ient], All.Transforms[ient], All.HasParams[ient] ? &All.Params[ient] : nullptr);
+			}
+			Warm.FillIn(world, Sim);
+			LastWorldSize = world.Size();
+		}
+
+		virtual void SendTransformUpdate(TEntityId entityId, const FlockTransformUpdate& update)
+		{
+			if (!Warm.Updated(entityId, update))
+			{
+				return;
+			}
+			if (FirstSent.find(entityId) == FirstSent.end())
+			{
+				FirstSent.insert(std::make_pair(entityId, update));
+			}
+			Live.SendTransformUpdate(entityId, update);
+		}
+
+		// what the view's authority op does in the worker
+		void Confirm(TEntityId entityId)
+		{
+			Sim.OnAuthorityGained(entityId);
+			Warm.AuthorityGained(entityId, Sim);
+		}
+
+		LocalWorld& Live;
+		FlockingSimulation& Sim;
+		WarmStart& Warm;
+		int Revealed;
+		int LastWorldSize;
+		WorldSnapshot All;
+		std::unordered_map<TEntityId, FlockTransformUpdate> FirstSent;
+	};
+
+	//***************************************************************************************************************
+	LocalWorldParams TestWorldParams()
+	{
+		auto params = DefaultLocalWorldParams();
+		params.NumBirds = g_numBirds;
+		params.NumBirdCells = 1;
+		return params;
+	}
+
+	//***************************************************************************************************************
+	SimulationConfig TestConfig()
+	{
+		auto config = RepeatableConfig(2);
+		config.WarmStart.GraceFrames = 8;
+		return config;
+	}
+
+	//***************************************************************************************************************
+	std::vector<char> ReadFile(const std::string& path)
+	{
+		std::vector<char> bytes;
+		FILE* file = fopen(path.c_str(), "rb");
+		if (file != nullptr)
+		{
+			char buf[4096];
+			for (size_t n = fread(buf, 1, sizeof(buf), file); n > 0; n = fread(buf, 1, sizeof(buf), file))
+			{
+				bytes.insert(bytes.end(), buf, buf + n);
+			}
+			fclose(file);
+		}
+		return bytes;
+	}
+
+	//***************************************************************************************************************
+	void WriteFile(const std::string& path, const std::vector<char>& bytes)
+	{
+		FILE* file = fopen(path.c_str(), "wb");
+		fwrite(bytes.data(), 1, bytes.size(), file);
+		fclose(file);
+	}
+
+	//***************************************************************************************************************
+	void TestSaveFromSimulation(const std::string& path)
+	{
+		auto config = TestConfig();
+		FlockingSimulation sim(config);
+		LocalWorld world(TestWorldParams());
+		world.SpawnBirds();
+		world.DelegateAll(sim);
+		long long subTick = 0;
+		RunSubTicks(sim, world, sim.NumPhases(), subTick);
+		RunSubTicks(sim, world, sim.NumPhases(), subTick);
+		Check(sim.SaveSnapshot(path), "the simulation couldn't save a snapshot");
+
+		FlockingSimulation restarted(config);
+		WarmStart warmStart(config.WarmStart);
+		Check(warmStart.Begin(path, restarted), "couldn't warm start from what the simulation saved");
+		Check(warmStart.NumProvisional() == g_numBirds && restarted.NumFlockers() == g_numBirds, "not every bird the simulation had was taken on");
+		Check(warmStart.SnapshotFrame() == sim.FrameCount(), "the snapshot has the wrong frame");
+	}
+
+	//***************************************************************************************************************
+	void TestWarmStart(const std::string& path)
+	{
+		LocalWorld live(TestWorldParams());
+		live.SpawnBirds();
+		WorldSnapshot saved;
+		live.ReadWorld(saved);
+		FlockerSet flockers;
+		for (int ient = g_numOthers; ient < saved.Size(); ++ient)
+		{
+			flockers.Add(saved.Ids[ient]);
+		}
+		Check(WriteFlockSnapshot(path, saved, flockers, g_snapshotFrame), "couldn't write a snapshot");
+
+		auto config = TestConfig();
+		FlockingSimulation sim(config);
+		WarmStart warmStart(config.WarmStart);
+		Check(warmStart.Begin(path, sim), "couldn't warm start from a good snapshot");
+		Check(warmStart.IsActive() && warmStart.SnapshotFrame() == g_snapshotFrame, "the warm start didn't take the snapshot's frame");
+		Check(warmStart.NumStandIns() == saved.Size(), "not every entity in the snapshot stands in");
+		Check(warmStart.NumProvisional() == g_numBirds - g_numOthers && sim.NumFlockers() == g_numBirds - g_numOthers, "took on the wrong birds");
+
+		// nothing in view yet: the snapshot is the whole world, every bird is stepped, and nothing goes out
+		StreamingHost host(live, sim, warmStart);
+		long long subTick = 0;
+		RunSubTicks(sim, host, sim.NumPhases(), subTick);
+		Check(host.LastWorldSize == saved.Size(), "the snapshot didn't stand in for the whole view");
+		Check(sim.BirdSteps() >= g_numBirds - g_numOthers, "birds weren't stepped on the first frame");
+		Check(host.FirstSent.empty() && live.UpdatesReceived() == 0, "sent updates for birds the view hasn't confirmed");
+
+		// half the view arrives, and with it authority over what's in it
+		host.Revealed = saved.Size() / 2;
+		std::unordered_set<TEntityId> confirmed;
+		for (int ient = g_numOthers; ient < host.Revealed; ++ient)
+		{
+			host.Confirm(saved.Ids[ient]);
+			confirmed.insert(saved.Ids[ient]);
+		}
+		RunSubTicks(sim, host, sim.NumPhases(), subTick);
+		Check(host.LastWorldSize == saved.Size(), "the view and the stand-ins together should still be the whole world");
+		Check(warmStart.NumStandIns() == saved.Size() - host.Revealed, "entities in view still have stand-ins");
+		Check(warmStart.NumProvisional() == g_numBirds - host.Revealed, "confirmed birds are still provisional");
+		Check(!host.FirstSent.empty(), "confirmed birds sent nothing");
+		for (auto itSent = host.FirstSent.begin(); itSent != host.FirstSent.end(); ++itSent)
+		{
+			Check(confirmed.count(itSent->first) > 0, "sent an update for a bird the view hasn't confirmed");
+			Check(itSent->second.HasPosition && itSent->second.HasForward && itSent->second.HasVelocity, "a confirmed bird's first update wasn't whole");
+		}
+
+		// the rest of the view never confirms; once the grace frames are up, those birds are let go
+		for (int frame = 0; frame < config.WarmStart.GraceFrames && warmStart.IsActive(); ++frame)
+		{
+			RunSubTicks(sim, host, sim.NumPhases(), subTick);
+		}
+		Check(!warmStart.IsActive(), "the warm start outlived its grace frames");
+		Check(sim.NumFlockers() == static_cast<int>(confirmed.size()), "birds the view never confirmed weren't let go");
+		RunSubTicks(sim, host, sim.NumPhases(), subTick);
+		Check(host.LastWorldSize == host.Revealed, "stand-ins outlived the warm start");
+	}
+
+	//***************************************************************************************************************
+	void TestCaughtUp(const std::string& path)
+	{
+		LocalWorld live(TestWorldParams());
+		live.SpawnBirds();
+		auto config = TestConfig();
+		config.WarmStart.GraceFrames = 1000;
+		FlockingSimulation sim(config);
+		WarmStart warmStart(config.WarmStart);
+		Check(warmStart.Begin(path, sim), "couldn't warm start a second time from the same snapshot");
+
+		StreamingHost host(live, sim, warmStart);
+		host.Revealed = live.NumEntities();
+		for (int ient = 0; ient < live.NumEntities(); ++ient)
+		{
+			host.Confirm(live.IdAt(ient));
+		}
+		long long subTick = 0;
+		RunSubTicks(sim, host, sim.NumPhases(), subTick);
+		Check(!warmStart.IsActive(), "the warm start carried on after the view had everything");
+		Check(sim.NumFlockers() == live.NumEntities(), "lost birds the view confirmed");
+	}
+
+	//***************************************************************************************************************
+	void TestDamagedSnapshots(const std::string& path, const std::string& dir)
+	{
+		auto good = ReadFile(path);
+		Check(good.size() > sizeof(FlockSnapshotHeader), "the snapshot is too small to damage");
+		std::string damagedPath = dir + "/warm_start_test_damaged.bin";
+
+		std::vector<std::vector<char>> damaged;
+		damaged.push_back(good);
+		damaged.back()[0] ^= 1;
+		damaged.push_back(good);
+		damaged.back()[offsetof(FlockSnapshotHeader, Version)] ^= 1;
+		damaged.push_back(good);
+		damaged.back()[offsetof(FlockSnapshotHeader, EntitySize)] ^= 1;
+		damaged.push_back(good);
+		damaged.back()[offsetof(FlockSnapshotHeader, NumEntities)] ^= 1;
+		damaged.push_back(std::vector<char>(good.begin(), good.end() - 1));
+		damaged.push_back(good);
+		damaged.back().push_back(0);
+		damaged.push_back(std::vector<char>(good.begin(), good.begin() + sizeof(FlockSnapshotHeader) / 2));
+
+		auto config = TestConfig();
+		for (size_t c0 = 0; c0 < damaged.size(); ++c0)
+		{
+			WriteFile(damagedPath, damaged[c0]);
+			FlockingSimulation sim(config);
+			WarmStart warmStart(config.WarmStart);
+			Check(!warmStart.Begin(damagedPath, sim), "warm started from damaged snapshot " + std::to_string(c0));
+			Check(!warmStart.IsActive() && sim.NumFlockers() == 0, "a damaged snapshot still took birds on");
+		}
+
+		FlockingSimulation sim(config);
+		WarmStart warmStart(config.WarmStart);
+		Check(!warmStart.Begin(dir + "/no_such_warm_start_test.bin", sim), "warm started from a file that isn't there");
+		remove(damagedPath.c_str());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string dir = argc > 1 ? argv[1] : ".";
+	std::string path = dir + "/warm_start_test.bin";
+
+	TestSaveFromSimulation(path);
+	TestWarmStart(path);
+	TestCaughtUp(path);
+	TestDamagedSnapshots(path, dir);
+	remove(path.c_str());
+
+	return Finish();
+}
@@ -1,13 +1,35 @@
 package behaviours.agent
 
-import demoteam.{Transform, FlockOutput}
+import demoteam.{Transform, FlockOutput, FlockStats}
 import demoteam.buildingdemo.launcher.FlockingWorkerConstraint
+import improbable.apps.{FlockingStats, FlockerCostEvent}
 import improbable.papi.entity.{EntityBehaviour, Entity}
 import improbable.papi.world.World
+import scala.concurrent.duration._
 
 class FlockBehaviour(entity:Entity, world:World) extends EntityBehaviour {
+
+  // the worker replaces the summary once a stats period; checking more often than that means none are missed
+  val checkPeriod = 1.0
+  // startTime of the last summary passed on, so each goes to FlockingStats once
+  var lastReported = -1.0
+
   override def onReady(): Unit = {
     entity.addEngineConstraint(FlockingWorkerConstraint)
     entity.delegateState[Transform](FlockingWorkerConstraint)
+    // the worker keeps each bird's latest cost summary here
+    entity.delegateState[FlockStats](FlockingWorkerConstraint)
+    // only written with update_mode=steering, in place of most of the Transform updates
+    entity.delegateState[FlockOutput](FlockingWorkerConstraint)
+
+    val wStats = entity.watch[FlockStats]
+
+    world.timing.every(checkPeriod.seconds) {
+      wStats.entityUpdateTime.flatMap(_.headOption).filter(_.startTime != lastReported).foreach {
+        summary =>
+          lastReported = summary.startTime
+          world.messaging.sendToApp(classOf[FlockingStats].getName, FlockerCostEvent(entity.entityId, summary.period, summary.duration, summary.numSteps, summary.numCandidates))
+      }
+    }
   }
 }
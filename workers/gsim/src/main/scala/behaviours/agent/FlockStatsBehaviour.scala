@@ -16,7 +16,7 @@ class FlockStatsBehaviour(entity:Entity, world:World, flockStatsWriter: FlockSta
 
   override def addStat(executionTime:Double) : Unit = {
 
-    flockStatsWriter.update.entityUpdateTime(flockStatsWriter.entityUpdateTime :+ UpdateTimeEventData(entity.entityId, 0.0, executionTime)).finishAndSend()
+    flockStatsWriter.update.entityUpdateTime(flockStatsWriter.entityUpdateTime :+ UpdateTimeEventData(entity.entityId, 0.0, executionTime, 1, 0L, 0.0)).finishAndSend()
   }
 
   override def onReady() : Unit = {
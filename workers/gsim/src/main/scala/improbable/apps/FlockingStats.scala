@@ -8,16 +8,28 @@ import improbable.papi.worldapp.WorldApp
 import scala.concurrent.duration._
 
 case class FlockerProfileEvent(entity:EntityId, period:Double, totalTime:Double, numSamples:Int) extends CustomMsg
+// a bird's FlockStats summary from the FlockingWorker: what its steps over one stats period cost
+case class FlockerCostEvent(entity:EntityId, period:Double, computeSeconds:Double, numSteps:Int, numCandidates:Long) extends CustomMsg
 
 class FlockingStats(world:AppWorld, logger:Logger) extends WorldApp {
 
   var theRecord = Map[EntityId, Double]()
   var numSamples = 0
 
+  var workerBirds = Set[EntityId]()
+  var workerSeconds = 0.0
+  var workerSteps = 0L
+  var workerCandidates = 0L
+
   world.messaging.onReceive {
     case FlockerProfileEvent(e,p,t, n) =>
       theRecord = theRecord.updated(e, t+theRecord.getOrElse(e, 0.0))
       numSamples = numSamples+n
+    case FlockerCostEvent(e, p, t, s, c) =>
+      workerBirds = workerBirds + e
+      workerSeconds = workerSeconds + t
+      workerSteps = workerSteps + s
+      workerCandidates = workerCandidates + c
   }
 
   val samplePeriod = 3.0
@@ -40,7 +52,18 @@ class FlockingStats(world:AppWorld, logger:Logger) extends WorldApp {
     val timeStamp = System.nanoTime()
     logger.info("FlockStats [" + timeStamp + "] TotalIterations: " + numSamples + "; Load: "+ load)
 
+    if (workerSteps > 0) {
+      val candidatesPerStep = workerCandidates.toDouble/workerSteps
+      val microsecondsPerStep = workerSeconds*1e6/workerSteps
+      logger.info("FlockingWorker [" + timeStamp + "] Birds: " + workerBirds.size + "; Steps: " + workerSteps +
+        "; Candidates/step: " + candidatesPerStep + "; Microseconds/step: " + microsecondsPerStep)
+    }
+
     theRecord = Map.empty
     numSamples = 0
+    workerBirds = Set.empty
+    workerSeconds = 0.0
+    workerSteps = 0L
+    workerCandidates = 0L
   }
 }
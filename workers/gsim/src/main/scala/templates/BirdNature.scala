@@ -36,6 +36,7 @@ object BirdNature extends NatureDescription {
               maxTurnDegreesPerSecond = 5.0f
           )
       ,FlockStats(Nil)
+      ,FlockOutput(Vector3f.zero)
     )
   )
 }
@@ -6,17 +6,41 @@ using Improbable.CoreLibrary.CoordinateRemapping;
 using Improbable.Unity.Common.Core.Math;
 using Improbable.Unity;
 
+// With update_mode=steering the worker sends a position only now and then, and otherwise just the target velocity in
+// FlockOutput; between positions the bird carries on along the last velocity it was given. In the other modes every
+// update is a position, so it's left where that puts it. Entities without FlockOutput only ever get positions.
 public class DemoPositionVisualizer : MonoBehaviour {
 
     [Require]
     public TransformReader Trans;
 
+    // not required: null on entities without FlockOutput
+    public FlockOutputReader Output;
+
+    private Vector3 Velocity;
+    private bool Steering;
+
 	void OnEnable () 
     {
+        Velocity = Vector3.zero;
+        Steering = false;
         Trans.PositionUpdated += Trans_PositionUpdated;
         Trans.ForwardUpdated += Trans_ForwardUpdated;
+        Trans.VelocityUpdated += Trans_VelocityUpdated;
+        if (Output != null)
+        {
+            Output.TargetVelocityUpdated += Output_TargetVelocityUpdated;
+        }
 	}
 
+    void Update()
+    {
+        if (Steering)
+        {
+            transform.position += Velocity * Time.deltaTime;
+        }
+    }
+
     void Trans_ForwardUpdated(Improbable.Math.Vector3f obj)
     {
         transform.rotation = Quaternion.LookRotation(obj.ToUnityVector());
@@ -26,4 +50,20 @@ public class DemoPositionVisualizer : MonoBehaviour {
     {
         transform.position = obj.RemapGlobalToUnityVector();
     }
+
+    void Trans_VelocityUpdated(Improbable.Math.Vector3f obj)
+    {
+        Velocity = obj.ToUnityVector();
+    }
+
+    // the worker doesn't send a facing with these: birds fly the way they're going
+    void Output_TargetVelocityUpdated(Improbable.Math.Vector3f obj)
+    {
+        Steering = true;
+        Velocity = obj.ToUnityVector();
+        if (Velocity.sqrMagnitude > 0.0f)
+        {
+            transform.rotation = Quaternion.LookRotation(Velocity);
+        }
+    }
 }